@@ -165,6 +165,7 @@
 #define POWER               1       // lower power support
 #define SD_DRIVE            0      	// SD drive
 #define DCC                 1       // Digital Command Control (model railroad)
+#define MEM_DMA             1       // memory-to-memory DMA for move and fill
 
 // Board Type
 // **********
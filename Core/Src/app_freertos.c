@@ -46,6 +46,12 @@
 #include "plex.h"
 #include "watchdog.h"
 #include "myassert.h"
+#include "log.h"
+#include "crash.h"
+#include "memory.h"
+#include "irq.h"
+#include "usclock.h"
+#include "dict.h"
 #if OLED == 1
 #include "oled.h"
 #endif
@@ -121,6 +127,14 @@ void MX_FREERTOS_Init(void) {
 	POWER_init();
 #endif
 	WATCHDOG_init();
+	LOG_init();
+	CRASH_init();
+	IRQ_init();
+	USCLOCK_init();
+	DICT_init();
+#if MEM_DMA == 1
+	MEMORY_init();
+#endif
 	BSP_init();
 	RTC_init();
 	UART_init();
@@ -205,6 +219,8 @@ void MainThread(void *argument)
 	if (osThreadFlagsWait(BLE_IS_READY, osFlagsWaitAny, 2000) == BLE_IS_READY) {
 		// sem7 is used by CPU2 to prevent CPU1 from writing/erasing data in Flash memory
 		SHCI_C2_SetFlashActivityControl(FLASH_ACTIVITY_CONTROL_SEM7);
+		// flash drive is ready for the crash dumps
+		CRASH_persist();
 //		BSP_clearSysLED(SYSLED_POWER_ON);
 		BSP_setLED2(FALSE);
 	} else {
@@ -25,6 +25,7 @@
 #include "FreeRTOS.h"
 #include "task.h"
 #include "stm32_lpm.h"
+#include "usclock.h"
 #include <limits.h>
 
 /* Private typedef -----------------------------------------------------------*/
@@ -32,6 +33,7 @@ typedef struct
 {
   uint32_t LpTimeLeftOnEntry;
   uint8_t LpTimerFreeRTOS_Id;
+  uint64_t LpSleepTime_ps;
 } LpTimerContext_t;
 
 /* Private defines -----------------------------------------------------------*/
@@ -125,6 +127,7 @@ void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime )
   }
   else
   {
+    LpTimerContext.LpSleepTime_ps = 0;
     if (xExpectedIdleTime != (~0))
     {
       /* Remove one tick to wake up before the event occurs */
@@ -133,6 +136,9 @@ void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime )
       LpTimerStart( xExpectedIdleTime );
     }
 
+    /* The DWT cycle counter of the us clock stops in low power mode */
+    USCLOCK_enterSleep( );
+
     /* Enter low power mode */
     LpEnter( );
 
@@ -146,6 +152,7 @@ void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime )
       ulCompleteTickPeriods = LpGetElapsedTime( );
       vTaskStepTick( ulCompleteTickPeriods );
     }
+    USCLOCK_exitSleep( LpTimerContext.LpSleepTime_ps );
 
     /* Restart SysTick */
     portNVIC_SYSTICK_CURRENT_VALUE_REG = 0UL;
@@ -291,6 +298,7 @@ static uint32_t LpGetElapsedTime( void )
   LpTimeLeftOnExit = HW_TS_RTC_ReadLeftTicksToCount();
   /* This cannot overflow. Max result is ~ 1.6e13 */
   time_ps = (uint64_t)((CFG_TS_TICK_VAL_PS) * (uint64_t)(LpTimerContext.LpTimeLeftOnEntry - LpTimeLeftOnExit));
+  LpTimerContext.LpSleepTime_ps = time_ps;
 
   /* time_ps can be less than 1 RTOS tick in following situations
    * a) MCU didn't go to STOP2 due to wake-up unrelated to Timer Server or woke up from STOP2 very shortly after.
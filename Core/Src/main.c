@@ -124,6 +124,7 @@
 #include "fs.h"
 #include "clock.h"
 #include "myassert.h"
+#include "crash.h"
 #if POWER == 1
 #include "power.h"
 #endif
@@ -404,6 +405,7 @@ void PeriphCommonClock_Config(void)
 /* USER CODE BEGIN 4 */
 
 void vApplicationStackOverflowHook( TaskHandle_t xTask, char *pcTaskName ) {
+	CRASH_save(ASSERT_STACK_OVERFLOW, NULL);
 	ASSERT_fatal(0, ASSERT_STACK_OVERFLOW, (uint32_t) pcTaskName);
 }
 
@@ -24,10 +24,17 @@
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
 #include "myassert.h"
+#include "crash.h"
 #include "app_conf.h"
 #if DCC == 1
 #include "dcc.h"
 #endif
+#include "irq.h"
+#include "profile.h"
+#if BUTTON == 1
+#include "cmsis_os.h"
+#include "button.h"
+#endif
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -52,7 +59,11 @@
 
 /* Private function prototypes -----------------------------------------------*/
 /* USER CODE BEGIN PFP */
-
+// no prologue before CRASH_FAULT, the MSP has to point to the exception frame
+CRASH_HANDLER(HardFault_Handler);
+CRASH_HANDLER(MemManage_Handler);
+CRASH_HANDLER(BusFault_Handler);
+CRASH_HANDLER(UsageFault_Handler);
 /* USER CODE END PFP */
 
 /* Private user code ---------------------------------------------------------*/
@@ -75,6 +86,15 @@ extern TIM_HandleTypeDef htim2;
 #if DCC == 1
 extern TIM_HandleTypeDef htim16;
 #endif
+#if MEM_DMA == 1
+extern DMA_HandleTypeDef hdma_memtomem_dma2_channel1;
+#endif
+#if DCC == 1
+extern DMA_HandleTypeDef hdma_tim16_up;
+#endif
+extern DMA_HandleTypeDef hdma_tim1_up;
+extern DMA_HandleTypeDef hdma_tim2_ch2;
+extern DMA_HandleTypeDef hdma_tim2_oc;
 extern TIM_HandleTypeDef htim17;
 extern UART_HandleTypeDef huart1;
 extern WWDG_HandleTypeDef hwwdg;
@@ -108,26 +128,8 @@ void NMI_Handler(void)
 void HardFault_Handler(void)
 {
   /* USER CODE BEGIN HardFault_IRQn 0 */
-/*
-    __asm volatile
-    (
-        " tst lr, #4                                                \n"
-        " ite eq                                                    \n"
-        " mrseq r0, msp                                             \n"
-        " mrsne r0, psp                                             \n"
-        " ldr r1, [r0, #24]                                         \n"
-        " ldr r2, handler2_address_const                            \n"
-        " bx r2                                                     \n"
-        " handler2_address_const: .word prvGetRegistersFromStack    \n"
-    );
-*/
-
-	// christmas tree
-	HAL_GPIO_WritePin(LD3_GPIO_Port, LD1_Pin, GPIO_PIN_SET);
-	HAL_GPIO_WritePin(LD3_GPIO_Port, LD2_Pin, GPIO_PIN_SET);
-	HAL_GPIO_WritePin(LD3_GPIO_Port, LD3_Pin, GPIO_PIN_SET);
-
-	ASSERT_fatal(0, ASSERT_HARD_FAULT, SCB->CFSR);
+	// crash dump, christmas tree and reset
+	CRASH_FAULT(ASSERT_HARD_FAULT);
   /* USER CODE END HardFault_IRQn 0 */
   while (1)
   {
@@ -142,7 +144,7 @@ void HardFault_Handler(void)
 void MemManage_Handler(void)
 {
   /* USER CODE BEGIN MemoryManagement_IRQn 0 */
-	ASSERT_fatal(0, ASSERT_MEM_MANAGE_FAULT, SCB->CFSR);
+	CRASH_FAULT(ASSERT_MEM_MANAGE_FAULT);
 
   /* USER CODE END MemoryManagement_IRQn 0 */
   while (1)
@@ -158,7 +160,7 @@ void MemManage_Handler(void)
 void BusFault_Handler(void)
 {
   /* USER CODE BEGIN BusFault_IRQn 0 */
-	ASSERT_fatal(0, ASSERT_BUS_FAULT, SCB->CFSR);
+	CRASH_FAULT(ASSERT_BUS_FAULT);
 
   /* USER CODE END BusFault_IRQn 0 */
   while (1)
@@ -176,7 +178,7 @@ void UsageFault_Handler(void)
   /* USER CODE BEGIN UsageFault_IRQn 0 */
 
 	/* Configurable Fault Status Registers */
-	ASSERT_fatal(0, ASSERT_USAGE_FAULT, SCB->CFSR);
+	CRASH_FAULT(ASSERT_USAGE_FAULT);
 
   /* USER CODE END UsageFault_IRQn 0 */
   while (1)
@@ -288,7 +290,7 @@ void EXTI3_IRQHandler(void)
 void EXTI4_IRQHandler(void)
 {
   /* USER CODE BEGIN EXTI4_IRQn 0 */
-
+  IRQ_ENTRY(IRQ_EXTI4);
   /* USER CODE END EXTI4_IRQn 0 */
   HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_4);
   /* USER CODE BEGIN EXTI4_IRQn 1 */
@@ -302,7 +304,7 @@ void EXTI4_IRQHandler(void)
 void EXTI9_5_IRQHandler(void)
 {
   /* USER CODE BEGIN EXTI9_5_IRQn 0 */
-
+  IRQ_ENTRY(IRQ_EXTI6);
   /* USER CODE END EXTI9_5_IRQn 0 */
 #if BUTTON == 1
   HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_5);
@@ -398,7 +400,7 @@ void TIM1_UP_TIM16_IRQHandler(void)
 //  }
   if (htim16.Instance != NULL)
   {
-	DCC_TIM16_PeriodElapsedIRQHandler();
+    HAL_TIM_IRQHandler(&htim16);
   }
   /* USER CODE BEGIN TIM1_UP_TIM16_IRQn 1 */
 
@@ -497,7 +499,8 @@ void USART1_IRQHandler(void)
 void EXTI15_10_IRQHandler(void)
 {
   /* USER CODE BEGIN EXTI15_10_IRQn 0 */
-
+  IRQ_ENTRY(IRQ_EXTI10);
+  IRQ_ENTRY(IRQ_EXTI13);
   /* USER CODE END EXTI15_10_IRQn 0 */
   HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_10);
   HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_13);
@@ -594,4 +597,66 @@ volatile uint32_t psr;// Program status register.
 }
 */
 
+#if MEM_DMA == 1
+/**
+  * @brief This function handles DMA2 channel1 global interrupt (move, fill).
+  */
+void DMA2_Channel1_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdma_memtomem_dma2_channel1);
+}
+#endif
+
+#if BUTTON == 1
+/**
+  * @brief This function handles LPTIM1 global interrupt (button scan).
+  */
+void LPTIM1_IRQHandler(void)
+{
+  BUTTON_LPTIM1_IRQHandler();
+}
+#endif
+
+#if DCC == 1
+/**
+  * @brief This function handles DMA2 channel2 global interrupt (DCC TIM16 update).
+  */
+void DMA2_Channel2_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdma_tim16_up);
+}
+#endif
+
+/**
+  * @brief This function handles DMA2 channel4 global interrupt (NeoPixels TIM1 update).
+  */
+void DMA2_Channel4_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdma_tim1_up);
+}
+
+/**
+  * @brief This function handles DMA2 channel5 global interrupt (TIM2 CH2 capture stream).
+  */
+void DMA2_Channel5_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdma_tim2_ch2);
+}
+
+/**
+  * @brief This function handles DMA2 channel6 global interrupt (TIM2 compare sequence).
+  */
+void DMA2_Channel6_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdma_tim2_oc);
+}
+
+/**
+  * @brief This function handles LPTIM2 global interrupt (sampling profiler).
+  */
+__attribute__((naked)) void LPTIM2_IRQHandler(void)
+{
+  PROFILE_SAMPLE();
+}
+
 /* USER CODE END 1 */
@@ -40,6 +40,7 @@
 #include "sd.h"
 #include "fd.h"
 #include "bsp.h"
+#include "dircache.h"
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
@@ -165,13 +166,12 @@ DRESULT USER_SD_read (
 {
   /* USER CODE BEGIN READ */
 	DRESULT res = RES_ERROR;
-	// SD drive
-	uint32_t old_pixel = BSP_getNeoPixel();
-	BSP_setNeoPixel(0x7f7f00); // set neopixel to yellow
+	// SD drive, SD_ReadBlocks() posts the activity to the system LED
 	if( SD_ReadBlocks((uint8_t*)buff, (uint32_t) (sector), count) == SD_OK) {
 		res = RES_OK;
+	} else {
+		BSP_flashSysLED(SYSLED_ERROR);
 	}
-	BSP_setNeoPixel(old_pixel);
 	return res;
   /* USER CODE END READ */
 }
@@ -195,13 +195,14 @@ DRESULT USER_SD_write (
   /* USER CODE BEGIN WRITE */
 	/* USER CODE HERE */
 	DRESULT res = RES_ERROR;
-	// SD drive
-	uint32_t old_pixel = BSP_getNeoPixel();
-	BSP_setNeoPixel(0x7f0000); // set neopixel to red
+	// cached directories of the SD drive (1:) are not valid anymore
+	DIRCACHE_invalidate(1);
+	// SD drive, SD_WriteBlocks() posts the activity to the system LED
 	if (SD_WriteBlocks((uint8_t*)buff, (uint32_t) (sector), count) == SD_OK) {
 		res = RES_OK;
+	} else {
+		BSP_flashSysLED(SYSLED_ERROR);
 	}
-	BSP_setNeoPixel(old_pixel);
 	return res;
   /* USER CODE END WRITE */
 }
@@ -325,13 +326,12 @@ DRESULT USER_FD_read (
 {
   /* USER CODE BEGIN READ */
 	DRESULT res = RES_ERROR;
-	// flash drive
-	uint32_t old_pixel = BSP_getNeoPixel();
-	BSP_setNeoPixel(0x7f7f00); // set neopixel to yellow
+	// flash drive, FD_ReadBlocks() posts the activity to the system LED
 	if( FD_ReadBlocks((uint8_t*)buff, (uint32_t) (sector), count) == SD_OK) {
 		res = RES_OK;
+	} else {
+		BSP_flashSysLED(SYSLED_ERROR);
 	}
-	BSP_setNeoPixel(old_pixel);
 	return res;
   /* USER CODE END READ */
 }
@@ -354,13 +354,15 @@ DRESULT USER_FD_write (
 {
   /* USER CODE BEGIN WRITE */
 	/* USER CODE HERE */
-	uint32_t old_pixel = BSP_getNeoPixel();
-	BSP_setNeoPixel(0x7f0000); // set neopixel to red
 	DRESULT res = RES_ERROR;
+	// cached directories of the flash drive (0:) are not valid anymore
+	DIRCACHE_invalidate(0);
+	// FD_WriteBlocks() posts the activity to the system LED
 	if (FD_WriteBlocks((uint8_t*)buff, (uint32_t) (sector), count) == SD_OK) {
 		res = RES_OK;
+	} else {
+		BSP_flashSysLED(SYSLED_ERROR);
 	}
-	BSP_setNeoPixel(old_pixel);
 	return res;
   /* USER CODE END WRITE */
 }
@@ -26,6 +26,7 @@
 
   .ifdef registerallocator
     bl init_register_allocator
+    bl peephole_init
   .endif
 
    @ Suche nach der init-Definition:
@@ -86,7 +86,7 @@ smudge:
 
 
     .ifdef flushflash
-      bl flushflash
+      bl flushflash @ Table and row buffer, the code can be inlined or executed now
     .endif
 
     pop {pc}
@@ -1000,17 +1000,49 @@ dictionarystart: @ ( -- Startadresse des aktuellen Dictionaryfadens )
 dictionarynext: @ Scans dictionary chain and returns true if end is reached.
 @ -----------------------------------------------------------------------------
   push {r0, r1, lr}
-  ldr r1, [tos]
+2:ldr r1, [tos]
   ldr r0, =erasedword
   cmp r1, r0
-  beq 1f
+  beq 3f
     ldrb r0, [r1, #6]
     cmp r0, #erasedbyte
-    beq 1f
+    beq 4f
+    .ifdef flushstage
+    adds r0, #6       @ Last byte of the name
+    adds r0, r1
+    eors r0, r1
+    lsrs r0, #9       @ 512 byte rows, the name could end in the staged row
+    beq 5f
+      movs r0, r1
+      ldrb r1, [r0, #6]
+      adds r1, #7     @ Link, Flags, length and name
+      bl readstage
+      cmp r0, #0
+      bne 2b
+      ldr r1, [tos]
+5:
+    .endif
       movs tos, r1
       pushdaconst 0
       pop {r0, r1, pc}
 
+3:.ifdef flushstage
+  movs r0, tos      @ The link could be staged
+  movs r1, #4
+  bl readstage
+  cmp r0, #0
+  bne 2b
+  .endif
+  b 1f
+
+4:.ifdef flushstage
+  adds r0, r1, #6   @ The name could be staged
+  movs r1, #1
+  bl readstage
+  cmp r0, #0
+  bne 2b
+  .endif
+
 1:pushdatos
   movs tos, #0
   mvns tos, tos
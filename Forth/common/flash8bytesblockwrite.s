@@ -28,6 +28,11 @@
 initflash: @ ( -- ) Löscht alle Einträge in der Sammeldatei
                      @ Clear the table at the beginning and in quit
 @ -----------------------------------------------------------------------------
+  push {lr}
+  .ifdef flushstage
+  bl flushstage @ Completed blocks are written, as without the row buffer
+  .endif
+
   ldr r0, =Sammeltabelle
   ldr r1, =12 * Sammelstellen
   movs r2, #0
@@ -37,7 +42,7 @@ initflash: @ ( -- ) Löscht alle Einträge in der Sammeldatei
   subs r1, #1
   bne 1b
 
-  bx lr
+  pop {pc}
 
   .ifdef debug
 @ -----------------------------------------------------------------------------
@@ -197,7 +202,11 @@ hflashstoreemulation_gefunden: @ Found !
 
     @ A 8 Byte block is finished ! Let's write !
     bl flushblock
+    .ifdef flushstage
+    bl eightflashstage @ Collected in the row buffer
+    .else
     bl eightflashstore
+    .endif
 
 hflashstoreemulation_fertig:
   pop {r4, r5, pc}
@@ -207,6 +216,16 @@ hflashstoreemulation_fertig:
   Wortbirne Flag_visible, "flushflash" @ Flushes all remaining table entries
 flushflash:
 @ -----------------------------------------------------------------------------
+  .ifdef flushstage
+  push {lr}
+  bl flushtable
+  bl flushstage
+  pop {pc}
+
+@ -----------------------------------------------------------------------------
+flushtable: @ Flushes the collection table into the row buffer only
+@ -----------------------------------------------------------------------------
+  .endif
   push {lr}
 
   ldr r0, =Sammeltabelle
@@ -216,7 +235,11 @@ flushflash:
   cmp r2, #0
   beq 3f
     bl flushblock
+    .ifdef flushstage
+    bl eightflashstage
+    .else
     bl eightflashstore
+    .endif
 
 3:adds r0, #12
   subs r1, #1
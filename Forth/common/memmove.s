@@ -0,0 +1,329 @@
+@
+@    Mecrisp-Stellaris - A native code Forth implementation for ARM-Cortex M microcontrollers
+@    Copyright (C) 2013  Matthias Koch
+@
+@    This program is free software: you can redistribute it and/or modify
+@    it under the terms of the GNU General Public License as published by
+@    the Free Software Foundation, either version 3 of the License, or
+@    (at your option) any later version.
+@
+@    This program is distributed in the hope that it will be useful,
+@    but WITHOUT ANY WARRANTY; without even the implied warranty of
+@    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+@    GNU General Public License for more details.
+@
+@    You should have received a copy of the GNU General Public License
+@    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+@
+
+@ Speicherblöcke kopieren und füllen
+@ Move and fill memory blocks
+@
+@ If source and destination have the same alignment, the bytes up to the
+@ next word boundary are copied one by one, then 16 bytes per ldm/stm, then
+@ words and the tail bytes again one by one.
+@ With MEM_DMA large copies and fills in RAM are done by a memory-to-memory
+@ DMA channel, only the calling task is blocked (see peripherals/memory.c).
+
+@------------------------------------------------------------------------------
+@ Internal: copy upwards (ascending addresses)
+@ r0 source, r1 destination, r2 count. Changes r0, r1, r2, r3, r4, r5, r12.
+@------------------------------------------------------------------------------
+move_up:
+  cmp r2, #0
+  beq 6f
+
+.if MEM_DMA == 1
+  cmp r2, #MEM_DMA_THRESHOLD
+  blo 1f
+  push {r0, r1, r2, lr}
+  bl MEMORY_dmaMove   @ uint32_t MEMORY_dmaMove(uint32_t src, uint32_t dst, uint32_t count)
+  movs r3, r0         @ Bytes moved by DMA
+  pop {r0, r1, r2, lr}
+  adds r0, r3
+  adds r1, r3
+  subs r2, r3
+  beq 6f
+1:
+.endif
+
+  eors r3, r0, r1
+  tst r3, #3
+  bne 5f              @ Different alignment, byte by byte
+
+2:tst r1, #3          @ Head bytes up to the word boundary
+  beq 3f
+  ldrb r3, [r0], #1
+  strb r3, [r1], #1
+  subs r2, #1
+  bne 2b
+  b 6f
+
+3:subs r2, #16        @ 16 bytes per ldm/stm
+  blo 4f
+  ldmia r0!, {r3, r4, r5, r12}
+  stmia r1!, {r3, r4, r5, r12}
+  b 3b
+
+4:adds r2, #16
+41:subs r2, #4         @ Words
+  blo 42f
+  ldr r3, [r0], #4
+  str r3, [r1], #4
+  b 41b
+42:adds r2, #4
+  beq 6f
+
+5:ldrb r3, [r0], #1   @ Tail bytes
+  strb r3, [r1], #1
+  subs r2, #1
+  bne 5b
+
+6:bx lr
+
+@------------------------------------------------------------------------------
+@ Internal: copy downwards (descending addresses)
+@ r0 source, r1 destination, r2 count. Changes r0, r1, r2, r3, r4, r5, r12.
+@------------------------------------------------------------------------------
+move_down:
+  cmp r2, #0
+  beq 6f
+
+  adds r0, r2         @ Start at the end
+  adds r1, r2
+
+  eors r3, r0, r1
+  tst r3, #3
+  bne 5f              @ Different alignment, byte by byte
+
+2:tst r1, #3          @ Head bytes down to the word boundary
+  beq 3f
+  ldrb r3, [r0, #-1]!
+  strb r3, [r1, #-1]!
+  subs r2, #1
+  bne 2b
+  b 6f
+
+3:subs r2, #16        @ 16 bytes per ldmdb/stmdb
+  blo 4f
+  ldmdb r0!, {r3, r4, r5, r12}
+  stmdb r1!, {r3, r4, r5, r12}
+  b 3b
+
+4:adds r2, #16
+41:subs r2, #4         @ Words
+  blo 42f
+  ldr r3, [r0, #-4]!
+  str r3, [r1, #-4]!
+  b 41b
+42:adds r2, #4
+  beq 6f
+
+5:ldrb r3, [r0, #-1]! @ Tail bytes
+  strb r3, [r1, #-1]!
+  subs r2, #1
+  bne 5b
+
+6:bx lr
+
+@------------------------------------------------------------------------------
+@ Internal: fill
+@ r1 destination, r2 count, r3 filling byte. Changes r0, r1, r2, r3, r4, r5, r12.
+@------------------------------------------------------------------------------
+fill_up:
+  cmp r2, #0
+  beq 6f
+
+  uxtb r3, r3         @ Replicate the byte into a word
+  orr r3, r3, r3, lsl #8
+  orr r3, r3, r3, lsl #16
+
+.if MEM_DMA == 1
+  cmp r2, #MEM_DMA_THRESHOLD
+  blo 1f
+  push {r1, r2, r3, lr}
+  movs r0, r1
+  movs r1, r2
+  movs r2, r3
+  bl MEMORY_dmaFill   @ uint32_t MEMORY_dmaFill(uint32_t dst, uint32_t count, uint32_t pattern), bytes filled
+  pop {r1, r2, r3, lr}
+  adds r1, r0
+  subs r2, r0
+  beq 6f
+1:
+.endif
+
+2:tst r1, #3          @ Head bytes up to the word boundary
+  beq 3f
+  strb r3, [r1], #1
+  subs r2, #1
+  bne 2b
+  b 6f
+
+3:movs r0, r3
+  movs r4, r3
+  movs r5, r3
+31:subs r2, #16        @ 16 bytes per stm
+  blo 4f
+  stmia r1!, {r0, r3, r4, r5}
+  b 31b
+
+4:adds r2, #16
+41:subs r2, #4         @ Words
+  blo 42f
+  str r3, [r1], #4
+  b 41b
+42:adds r2, #4
+  beq 6f
+
+5:strb r3, [r1], #1   @ Tail bytes
+  subs r2, #1
+  bne 5b
+
+6:bx lr
+
+
+@------------------------------------------------------------------------------
+  Wortbirne Flag_visible, "move"  @ Move some bytes around. This can cope with overlapping memory areas.
+move:  @ ( Quelladdr Zieladdr Byteanzahl -- ) ( Source Destination Count -- )
+@------------------------------------------------------------------------------
+  push {r0, r1, r2, r3, r4, r5, lr}
+  mov r3, r12
+  push {r3}
+
+  popda r2 @ Count
+  popda r1 @ Destination address
+  movs r0, tos @ Source address
+
+  @ Compare source and destination address to find out which direction to copy.
+  cmp r1, r0
+  beq 2f @ If source and destionation are the same, nothing to do.
+  blo 1f @ Destination below source --> upwards
+
+  adds r3, r0, r2 @ Destination above the end of the source --> no overlap, upwards
+  cmp r1, r3
+  bhs 1f
+
+  bl move_down
+  b 2f
+
+1:bl move_up
+
+2:drop
+  pop {r3}
+  mov r12, r3
+  pop {r0, r1, r2, r3, r4, r5, pc}
+
+@------------------------------------------------------------------------------
+  Wortbirne Flag_visible, "cmove"  @ Move bytes from lower to higher addresses.
+cmove:  @ ( c-addr1 c-addr2 u -- )
+@------------------------------------------------------------------------------
+  @ 17.6.1.0910 CMOVE STRING ( c-addr1 c-addr2 u -- ) If u is greater than zero, copy u consecutive characters
+  @ from the data space starting at c-addr1 to that starting at c-addr2, proceeding character-by-character
+  @ from lower addresses to higher addresses.
+  push {r0, r1, r2, r3, r4, r5, lr}
+  mov r3, r12
+  push {r3}
+
+  popda r2 @ Count
+  popda r1 @ Destination address
+  movs r0, tos @ Source address
+
+  cmp r1, r0
+  bls 1f @ Destination not above source --> upwards in blocks
+
+  adds r3, r0, r2
+  cmp r1, r3
+  bhs 1f @ No overlap
+
+  @ Overlap: the characters copied first are copied again (pattern fill)
+  cmp r2, #0
+  beq 2f
+3:ldrb r3, [r0], #1
+  strb r3, [r1], #1
+  subs r2, #1
+  bne 3b
+  b 2f
+
+1:bl move_up
+
+2:drop
+  pop {r3}
+  mov r12, r3
+  pop {r0, r1, r2, r3, r4, r5, pc}
+
+@------------------------------------------------------------------------------
+  Wortbirne Flag_visible, "cmove>"  @ Move bytes from higher to lower addresses.
+cmove_backward:  @ ( c-addr1 c-addr2 u -- )
+@------------------------------------------------------------------------------
+  @ 17.6.1.0920 CMOVE> STRING ( c-addr1 c-addr2 u -- ) If u is greater than zero, copy u consecutive characters
+  @ from the data space starting at c-addr1 to that starting at c-addr2, proceeding character-by-character
+  @ from higher addresses to lower addresses.
+  push {r0, r1, r2, r3, r4, r5, lr}
+  mov r3, r12
+  push {r3}
+
+  popda r2 @ Count
+  popda r1 @ Destination address
+  movs r0, tos @ Source address
+
+  cmp r1, r0
+  bhs 1f @ Destination not below source --> downwards in blocks
+
+  adds r3, r1, r2
+  cmp r3, r0
+  bls 4f @ No overlap --> upwards, DMA possible
+
+  @ Overlap: the characters copied first are copied again (pattern fill)
+  adds r0, r2
+  adds r1, r2
+  cmp r2, #0
+  beq 2f
+3:ldrb r3, [r0, #-1]!
+  strb r3, [r1, #-1]!
+  subs r2, #1
+  bne 3b
+  b 2f
+
+1:adds r3, r0, r2
+  cmp r1, r3
+  bhs 4f @ No overlap --> upwards, DMA possible
+
+  bl move_down
+  b 2f
+
+4:bl move_up
+
+2:drop
+  pop {r3}
+  mov r12, r3
+  pop {r0, r1, r2, r3, r4, r5, pc}
+
+@------------------------------------------------------------------------------
+  Wortbirne Flag_visible, "fill"  @ Fill memory with given byte.
+  @ ( Destination Count Filling -- )
+@------------------------------------------------------------------------------
+  @ 6.1.1540 FILL CORE ( c-addr u char -- ) If u is greater than zero, store char in each of u consecutive characters of memory beginning at c-addr.
+fill:
+  push {r0, r1, r2, r3, r4, r5, lr}
+  mov r3, r12
+  push {r3}
+
+  popda r3 @ Filling byte
+  popda r2 @ Count
+  movs r1, tos @ Destination
+
+  bl fill_up
+
+  drop
+  pop {r3}
+  mov r12, r3
+  pop {r0, r1, r2, r3, r4, r5, pc}
+
+@------------------------------------------------------------------------------
+  Wortbirne Flag_visible, "erase"  @ Fill memory with zero.
+erase:  @ ( addr u -- )
+@------------------------------------------------------------------------------
+  @ 6.2.1350 ERASE CORE EXT ( addr u -- ) If u is greater than zero, clear all bits in each of u consecutive address units of memory beginning at addr.
+  pushdaconst 0
+  b fill
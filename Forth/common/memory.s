@@ -20,66 +20,7 @@
 @ Memory access
 
 
-@------------------------------------------------------------------------------
-  Wortbirne Flag_visible, "move"  @ Move some bytes around. This can cope with overlapping memory areas.
-move:  @ ( Quelladdr Zieladdr Byteanzahl -- ) ( Source Destination Count -- )
-@------------------------------------------------------------------------------
-
-  push {r0, r1, r2, lr}
-
-  popda r1 @ Count
-  popda r2 @ Destination address
-  @ TOS:     Source address
-
-  @ Count > 0 ?
-  cmp r1, #0
-  beq 3f @ Nothing to do if count is zero.
-
-  @ Compare source and destination address to find out which direction to copy.
-  cmp r2, tos
-  beq 3f @ If source and destionation are the same, nothing to do.
-  blo 2f
-
-  subs tos, #1
-  subs r2, #1
-
-1:@ Source > Destination --> Backward move
-  ldrb r0, [tos, r1]
-  strb r0, [r2, r1]
-  subs r1, #1
-  bne 1b
-  b 3f
-
-2:@ Source < Destination --> Forward move
-  ldrb r0, [tos]
-  strb r0, [r2]
-  adds tos, #1
-  adds r2, #1
-  subs r1, #1
-  bne 2b
-
-3:drop
-  pop {r0, r1, r2, pc}
-
-@------------------------------------------------------------------------------
-  Wortbirne Flag_visible, "fill"  @ Fill memory with given byte.
-  @ ( Destination Count Filling -- )
-@------------------------------------------------------------------------------
-  @ 6.1.1540 FILL CORE ( c-addr u char -- ) If u is greater than zero, store char in each of u consecutive characters of memory beginning at c-addr. 
-
-  popda r0 @ Filling byte
-  popda r1 @ Count
-  @ TOS      Destination
-
-  cmp r1, #0
-  beq 2f
-
-1:subs r1, #1
-  strb r0, [tos, r1]
-  bne 1b
-
-2:drop
-  bx lr
+@ move, fill, cmove, cmove> and erase are in memmove.s
 
 @ -----------------------------------------------------------------------------
   Wortbirne Flag_inline, "@" @ ( 32-addr -- x )
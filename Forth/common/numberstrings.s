@@ -210,6 +210,7 @@ org_number:
 
   @ Zeichen wurde gemocht.  Character has been successfully converted to a digit.
 
+  .ifdef m0core
   @ Multiply old result with base:
   pushda r4 @ Low
   pushda r5 @ High
@@ -222,6 +223,11 @@ org_number:
 
   popda r5 @ High
   popda r4 @ Low
+  .else
+  @ Multiply-accumulate in registers, same result as ud* with the base:
+  umull r4, r2, r4, r3 @ Low * Base
+  mla r5, r5, r3, r2   @ High * Base + Carry
+  .endif
 
   movs r2, #0 @ For addition with Carry
   adds r4, tos
@@ -479,7 +485,57 @@ ziffer: @ ( Zahl -- Zahl )
   @ Idee dahinter: Teile durch die Basis.
   @ Bekomme einen Rest, und einen Teil, den ich im nächsten Durchlauf
   @ behandeln muss. Der Rest ist die Ziffer.
+  .ifdef m0core
   push {lr}
+  .else
+  push {r4, r5, lr}
+
+  @ Fast path with the hardware divider instead of the 64 step ud/mod.
+  ldr r1, =base
+  ldr r1, [r1]
+  cmp r1, #2
+  blo 5f       @ Base 0 and 1 as before
+  ldr r0, [psp] @ Low
+
+  cmp tos, #0
+  bne 3f       @ High part ?
+
+  cmp r1, #10
+  bne 1f
+    ldr r2, =0xCCCCCCCD @ u / 10 = u * 0xCCCCCCCD >> 35
+    umull r3, r2, r0, r2
+    lsrs r2, #3
+    b 2f
+1:udiv r2, r0, r1
+2:mls r3, r2, r1, r0  @ Remainder
+  str r2, [psp]       @ Result-Low, Result-High stays 0
+  b 4f
+
+3:@ 64/32 division in 16 bit steps, the remainders fit into 32 bits for base < 65536
+  lsrs r2, r1, #16
+  bne 5f
+  udiv r2, tos, r1       @ Result-High
+  mls r3, r2, r1, tos    @ Remainder of High
+  movs tos, r2
+  lsls r3, #16
+  orr r3, r3, r0, lsr #16
+  udiv r4, r3, r1        @ Result bits 31-16
+  mls r3, r4, r1, r3
+  lsls r3, #16
+  uxth r5, r0
+  orrs r3, r5
+  udiv r5, r3, r1        @ Result bits 15-0
+  mls r3, r5, r1, r3     @ Remainder
+  orr r5, r5, r4, lsl #16
+  str r5, [psp]          @ Result-Low
+
+4:pushda r3
+  bl digitausgeben
+  bl hold
+  pop {r4, r5, pc}
+
+5:
+  .endif
     pushdatos
     ldr tos, =base
     ldr tos, [tos] @ Base-Low
@@ -495,7 +551,11 @@ ziffer: @ ( Zahl -- Zahl )
     @ ( uL uH digit )
     bl hold
     @ ( uL uH )
+  .ifdef m0core
   pop {pc}
+  .else
+  pop {r4, r5, pc}
+  .endif
 
 
 @------------------------------------------------------------------------------
@@ -603,3 +663,124 @@ dot:
   pushdatos
   movs tos, tos, asr #31    @ s>d - Turn MSB into 0xffffffff or 0x00000000
   b.n ddot
+
+.ifndef m0core
+
+@ -----------------------------------------------------------------------------
+  Wortbirne Flag_visible, "u>str" @ ( u c-addr -- c-addr len )
+     @ Schreibt eine vorzeichenlose Zahl direkt in den Puffer.
+     @ Converts an unsigned single number in the current base into the buffer,
+     @ same digits as u. without the number buffer and the space.
+@ -----------------------------------------------------------------------------
+u_to_str:
+  push {r4, r5, lr}
+  ldr r0, [psp]  @ u
+  str tos, [psp] @ c-addr
+  movs r5, tos   @ Pointer, the digits are written backwards and reversed at the end
+
+  ldr r1, =base
+  ldr r1, [r1]
+  cmp r1, #10
+  bne 4f
+
+  @ Base 10: Two digits per step from the digit pair table, u / 100 = u * 0x51EB851F >> 37
+  ldr r3, =digitpairs
+  ldr r4, =0x51EB851F
+  movs r1, #100
+1:cmp r0, #100
+  blo 2f
+  umull r12, r2, r0, r4
+  lsrs r2, #5
+  mls r12, r2, r1, r0  @ Remainder 0..99
+  movs r0, r2
+  add r12, r3, r12, lsl #1
+  ldrb r2, [r12, #1]
+  strb r2, [r5], #1
+  ldrb r2, [r12]
+  strb r2, [r5], #1
+  b 1b
+
+2:cmp r0, #10
+  blo 3f
+  add r12, r3, r0, lsl #1
+  ldrb r2, [r12, #1]
+  strb r2, [r5], #1
+  ldrb r2, [r12]
+  strb r2, [r5], #1
+  b 8f
+3:adds r0, #48
+  strb r0, [r5], #1
+  b 8f
+
+4:cmp r1, #16
+  bne 6f
+  @ Base 16: Shift and mask
+5:and r2, r0, #15
+  cmp r2, #10
+  ite lo
+  addlo r2, #48
+  addhs r2, #55
+  strb r2, [r5], #1
+  lsrs r0, #4
+  bne 5b
+  b 8f
+
+6:cmp r1, #2
+  it lo
+  movlo r1, #10  @ Base 0 and 1 are invalid, use decimal
+7:udiv r2, r0, r1
+  mls r3, r2, r1, r0 @ Remainder
+  pushda r3
+  bl digitausgeben
+  strb tos, [r5], #1
+  drop
+  movs r0, r2
+  cmp r0, #0
+  bne 7b
+
+8:@ Reverse the digits
+  ldr r4, [psp]
+  subs tos, r5, r4 @ len
+9:subs r5, #1
+  cmp r4, r5
+  bhs 10f
+  ldrb r2, [r4]
+  ldrb r3, [r5]
+  strb r3, [r4], #1
+  strb r2, [r5]
+  b 9b
+10:
+  pop {r4, r5, pc}
+
+digitpairs: @ "00" "01" ... "99"
+  .irp tens, 0,1,2,3,4,5,6,7,8,9
+  .irp ones, 0,1,2,3,4,5,6,7,8,9
+  .ascii "\tens\ones"
+  .endr
+  .endr
+  .p2align 1
+
+@ -----------------------------------------------------------------------------
+  Wortbirne Flag_visible, "n>str" @ ( n c-addr -- c-addr len )
+     @ Schreibt eine vorzeichenbehaftete Zahl direkt in den Puffer.
+     @ Converts a signed single number in the current base into the buffer,
+     @ same digits as . without the number buffer and the space.
+@ -----------------------------------------------------------------------------
+n_to_str:
+  ldr r0, [psp]
+  cmp r0, #0
+  bpl u_to_str
+
+  push {lr}
+  rsbs r0, r0, #0
+  str r0, [psp]
+  movs r1, #45   @ Minus
+  strb r1, [tos], #1
+  bl u_to_str    @ ( c-addr+1 len )
+  adds tos, #1
+  ldr r0, [psp]
+  subs r0, #1
+  str r0, [psp]
+  pop {pc}
+
+.endif // m0core
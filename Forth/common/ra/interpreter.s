@@ -41,6 +41,10 @@ evaluate:
   bl setsource          @ Set new source
   bl interpret          @ Interpret
 
+  .ifdef flushstage
+  bl flushstage         @ include evaluates line by line, flush like quit
+  .endif
+
   ldr r0, =Pufferstand  @ Restore >in
   pop {r1}
   str r1, [r0]
@@ -254,6 +258,10 @@ quit_innenschleife:  @ Main loop of Forth system.
   bl query
   bl interpret
 
+  .ifdef flushstage
+  bl flushstage @ Compiled flash is readable in the next line
+  .endif
+
   .ifdef color
 
   @ Check state
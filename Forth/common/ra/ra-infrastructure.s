@@ -291,6 +291,7 @@ element_to_stack: @ Erwartet Zustandsvariable in r0
 tidyup_register_allocator: @ Generiert all die Opcodes, um den Stack wieder in Ordnung zu bringen
 @ -----------------------------------------------------------------------------
   push {lr}
+  bl peephole_stm
   bl tidyup_register_allocator_5os
   bl tidyup_register_allocator_4os
   bl tidyup_register_allocator_3os
@@ -354,7 +355,18 @@ tidyup_register_allocator_tos:
 
   cmp r1, #unknown
   bne 1f
-    @ TOS = unknown    --> Register vom Stack nachladen
+    ldr r2, [r0, #offset_peephole_push]
+    cmp r2, #0
+    beq 4f
+      @ Die eingefügte Definition beginnt mit pushdatos: Nachladen und pushdatos ergeben ldr r6, [r7]
+      @ The inlined definition starts with pushdatos: reload and pushdatos give ldr r6, [r7]
+      movs r2, #2
+      str r2, [r0, #offset_peephole_push]
+      pushdaconstw 0x683E @ ldr r6, [r7, #0]
+      bl hkomma
+      b.n tidyup_finish
+
+4:  @ TOS = unknown    --> Register vom Stack nachladen
     pushdaconstw 0xCF00 | 1 << 6 @ ldm r7!, {r6}
     bl hkomma
     b.n tidyup_finish
@@ -411,5 +423,6 @@ init_register_allocator:
 
   movs r1, #0
   str r1, [r0, #offset_sprungtrampolin]
+  str r1, [r0, #offset_peephole_offset]
 
   bx lr
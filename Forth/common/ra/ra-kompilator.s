@@ -183,7 +183,9 @@ kompilator:
       pushda r1
       bl add_to_inline_cache
 
+  bl peephole_push_probe       @ Kann das Nachladen von TOS mit pushdatos verschmelzen ?
   bl tidyup_register_allocator @ Alle Registerbewegungen opcodieren
+  bl peephole_push_skip
   bl konstantenfaltungszeiger_loeschen
 
 @ -----------------------------------------------------------------------------
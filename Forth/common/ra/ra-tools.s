@@ -42,9 +42,19 @@ generiere_adresskonstante: @ Gleiche Schnittstelle, doch bevorzugt in r0.
   bne 1f
     ldr r1, [r0, #offset_constant_r0]
     cmp r1, r3
-    bne 1f
+    bne 2f
       movs r3, #0 @ Wenn ja, fein ! Register melden, Rücksprung.
       pop {r0, r1, r2, pc}
+
+2:  @ Peephole: Liegt die Konstante knapp über der in r0 ? Dann reicht ein 12-Bit-Offset im Opcode.
+    @ Is the constant a little above the one in r0 ? speicherzugriffkomma adds the difference as 12 bit offset.
+    subs r1, r3, r1
+    movw r2, #4095 - 124 @ Der 5-Bit-Offset aus dem kurzen Opcode kommt noch hinzu.  Room for the short opcode offset.
+    cmp r1, r2
+    bhi 1f
+      str r1, [r0, #offset_peephole_offset]
+      movs r3, #0
+      pop {r0, r1, r2, pc}
 1:
 
   @ Ist r0 frei ?
@@ -401,3 +411,202 @@ push_lr_nachholen:
       bl hkomma
 
 1:pop {r0, pc}
+
+
+@ -----------------------------------------------------------------------------
+speicherzugriffkomma: @ ( Opcode -- ) Schreibt einen ldr/str-Opcode mit 5-Bit-Offset.
+                      @ Writes a ldr/str opcode with 5 bit offset. If generiere_adresskonstante
+                      @ left an additional offset relative to r0, the long opcode with 12 bit
+                      @ offset is generated instead: ldr.w r0, [r0, #imm12]
+@ -----------------------------------------------------------------------------
+  push {r0, r1, r2, r3, lr}
+  ldr r0, =allocator_base
+  ldr r1, [r0, #offset_peephole_offset]
+  cmp r1, #0
+  bne 1f
+    bl hkomma
+    pop {r0, r1, r2, r3, pc}
+
+1:movs r2, #0
+  str r2, [r0, #offset_peephole_offset]
+
+  lsrs r2, tos, #11     @ Opcodeklasse: 0x0C str, 0x0D ldr, 0x0E strb, 0x0F ldrb, 0x10 strh, 0x11 ldrh
+  ubfx r3, tos, #6, #5  @ imm5
+
+  cmp r2, #0x10
+  bhs 3f
+  cmp r2, #0x0E
+  bhs 2f
+    lsls r3, #2         @ str/ldr: Offset in Worten   Word offset
+    movw r0, #0xF8C0    @ str.w
+    b 4f
+2:  movw r0, #0xF880    @ strb.w
+    b 4f
+3:  lsls r3, #1         @ strh/ldrh: Offset in Halbworten  Halfword offset
+    movw r0, #0xF8A0    @ strh.w
+
+4:tst r2, #1            @ Load-Bit
+  beq 5f
+    orrs r0, #0x10
+5:
+  adds r3, r1           @ imm12
+  ubfx r2, tos, #3, #3  @ Rn
+  orrs r0, r2
+  lsls r0, #16
+  orrs r0, r3
+  ands r2, tos, #7      @ Rt
+  orrs r0, r0, r2, lsl #12
+
+  movs tos, r0
+  bl reversekomma
+
+  ldr r0, =allocator_base
+  ldr r1, [r0, #offset_peephole_ldr]
+  adds r1, #1
+  str r1, [r0, #offset_peephole_ldr]
+  pop {r0, r1, r2, r3, pc}
+
+@ -----------------------------------------------------------------------------
+peephole_stm: @ Schreibt die Elemente in Registern mit einem einzigen stmdb, falls die Reihenfolge passt.
+              @ Push all elements held in registers with one stmdb, if the register order allows it.
+@ -----------------------------------------------------------------------------
+  push {r0, r1, r2, r3, r4, r5, lr}
+  ldr r0, =allocator_base
+  movs r2, #0                 @ Registermaske  Register list
+  movs r3, #0                 @ Anzahl         Count
+  movs r4, #offset_state_5os
+  movs r5, #8                 @ Zuletzt gesehener Register  Last register seen
+
+1:ldr r1, [r0, r4]
+  cmp r1, #unknown
+  bne 2f
+    cmp r3, #0                @ Lücke im Stackmodell ? Dann nichts tun.  Gap in the model ?
+    bne 9f
+    b 3f
+
+2:cmp r1, r5                  @ Der tiefere Element muss den höheren Register haben, Konstanten sind >= 8.
+  bhs 9f                      @ Deeper elements need higher registers, constants are >= 8.
+  movs r5, r1
+  movs r1, #1
+  lsls r1, r5
+  orrs r2, r1
+  adds r3, #1
+
+3:subs r4, #offset_state_nos - offset_state_tos
+  cmp r4, #offset_state_nos
+  bhs 1b
+
+  cmp r3, #2
+  blo 9f
+
+    pushdatos
+    ldr tos, =0xE9270000      @ stmdb r7!, { ... }
+    orrs tos, r2
+    bl reversekomma
+
+    movs r1, #unknown
+    str r1, [r0, #offset_state_5os]
+    str r1, [r0, #offset_state_4os]
+    str r1, [r0, #offset_state_3os]
+    str r1, [r0, #offset_state_nos]
+
+    ldr r1, [r0, #offset_peephole_stm]
+    adds r1, #1
+    str r1, [r0, #offset_peephole_stm]
+
+9:pop {r0, r1, r2, r3, r4, r5, pc}
+
+@ -----------------------------------------------------------------------------
+peephole_push_probe: @ Beginnt die einzufügende Definition mit pushdatos ?
+                     @ Does the definition to be inlined start with pushdatos ?
+                     @ r1: Flags, r2: Einsprungadresse  Flags and entry point
+@ -----------------------------------------------------------------------------
+  push {r0, r1, r3, lr}
+
+  ands r1, #(Flag_immediate | Flag_inline) & ~Flag_visible
+  cmp r1, #Flag_inline & ~Flag_visible
+  bne 1f
+
+  movs r0, r2
+  ldrh r3, [r0]
+  cmp r3, #0xB500 @ push {lr} wird von inline, übersprungen  push {lr} is skipped by inline,
+  bne 2f
+    adds r0, #2
+
+2:ldrh r3, [r0]
+  movw r1, #0xF847 @ str tos, [psp, #-4]!
+  cmp r3, r1
+  bne 1f
+  ldrh r3, [r0, #2]
+  movw r1, #0x6D04
+  cmp r3, r1
+  bne 1f
+    ldr r0, =allocator_base
+    movs r1, #1
+    str r1, [r0, #offset_peephole_push]
+
+1:pop {r0, r1, r3, pc}
+
+@ -----------------------------------------------------------------------------
+peephole_push_skip: @ Hat tidyup das Nachladen von TOS mit pushdatos zu ldr r6, [r7] verschmolzen ?
+                    @ Did tidyup fuse the TOS reload with pushdatos ? Then skip pushdatos.
+                    @ r2: Einsprungadresse, wird angepasst  Entry point, adjusted
+@ -----------------------------------------------------------------------------
+  push {r0, r1, lr}
+  ldr r0, =allocator_base
+  ldr r1, [r0, #offset_peephole_push]
+  cmp r1, #2
+  bne 1f
+    ldrh r1, [r2]
+    cmp r1, #0xB500 @ push {lr}
+    bne 2f
+      adds r2, #2
+2:  adds r2, #4     @ pushdatos überspringen  Skip pushdatos
+
+    ldr r1, [r0, #offset_peephole_reload]
+    adds r1, #1
+    str r1, [r0, #offset_peephole_reload]
+
+1:movs r1, #0
+  str r1, [r0, #offset_peephole_push]
+  pop {r0, r1, pc}
+
+@ -----------------------------------------------------------------------------
+peephole_init: @ Statistik löschen  Clear statistics
+@ -----------------------------------------------------------------------------
+  ldr r0, =allocator_base
+  movs r1, #0
+  str r1, [r0, #offset_peephole_offset]
+  str r1, [r0, #offset_peephole_push]
+  str r1, [r0, #offset_peephole_stm]
+  str r1, [r0, #offset_peephole_ldr]
+  str r1, [r0, #offset_peephole_reload]
+  bx lr
+
+@ -----------------------------------------------------------------------------
+  Wortbirne Flag_visible, ".peephole" @ ( -- )
+  @ Gibt aus, was der Peephole-Optimierer bisher getan hat.
+  @ Prints what the peephole optimizer did since reset.
+@ -----------------------------------------------------------------------------
+  push {r0, lr}
+  ldr r0, =allocator_base
+
+  write "stmdb pushes: "
+  pushdatos
+  ldr tos, [r0, #offset_peephole_stm]
+  bl udot
+
+  write " ldr offsets: "
+  pushdatos
+  ldr tos, [r0, #offset_peephole_ldr]
+  bl udot
+
+  write " drop dup: "
+  pushdatos
+  ldr tos, [r0, #offset_peephole_reload]
+  bl udot
+
+  writeln ""
+  pop {r0, pc}
+
+  .ltorg
@@ -65,7 +65,23 @@ compare:                             @ ( c-addr1 len-1 c-addr2 len-2 -- f )
 
   bne 2f @ Exit in case of unequal lengths.
 
-   @ Lengths are equal. Compare characters.
+   @ Lengths are equal. Compare word by word if both strings are aligned,
+   @ the characters of unequal words are compared case-insensitive below.
+   orrs r2, r1, tos
+   tst r2, #3
+   bne 1f
+4: cmp r0, #4
+   blo 1f
+     ldr r2, [r1]
+     ldr r3, [tos]
+     cmp r2, r3
+     bne 1f
+     adds r1, #4
+     adds tos, #4
+     subs r0, #4
+     b 4b
+
+   @ Compare characters.
    @ How many characters to compare left ?
 1: cmp r0, #0
    beq 3f
@@ -566,6 +566,94 @@ ICwait:
 	pop		{pc}
 
 
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "OCsequence"
+OCsequence:
+.type OCsequence, %function
+		@ ( addr u a -- ) Plays u compare values from table addr on pin a by DMA
+// void BSP_startSequenceOC(int pin_number, uint32_t *table, uint32_t len);
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	movs	r0, tos		// pin_number
+	drop
+	movs	r2, tos		// len
+	drop
+	movs	r1, tos		// table
+	drop
+	bl		BSP_startSequenceOC
+	pop		{pc}
+
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "ICstream"
+ICstream:
+.type ICstream, %function
+		@ ( u -- )    Starts input capture stream u: 0 rising edge, 1 falling edge, 2 both edges
+// void BSP_startStreamIC(uint32_t mode);
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	movs	r0, tos		// mode
+	drop
+	bl		BSP_startStreamIC
+	pop		{pc}
+
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "ICstreamstop"
+ICstreamstop:
+.type ICstreamstop, %function
+		@ ( -- )      Stops input capture stream
+// void BSP_stopStreamIC(void);
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	bl		BSP_stopStreamIC
+	pop		{pc}
+
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "ICstream?"
+ICstream_q:
+.type ICstream_q, %function
+		@ ( -- u )    Number of timestamps in the input capture stream
+// uint32_t BSP_getStreamIC(void);
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	pushdatos
+	bl		BSP_getStreamIC
+	movs	tos, r0		// return value
+	pop		{pc}
+
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "ICstream>"
+ICstream_to:
+.type ICstream_to, %function
+		@ ( addr u1 -- u2 ) Reads max. u1 timestamps to addr, returns count u2
+// uint32_t BSP_readStreamIC(uint32_t *buffer, uint32_t len);
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	movs	r1, tos		// len
+	drop
+	movs	r0, tos		// buffer
+	bl		BSP_readStreamIC
+	movs	tos, r0		// return value
+	pop		{pc}
+
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "ICstreamlost"
+ICstreamlost:
+.type ICstreamlost, %function
+		@ ( -- u )    Timestamps lost since the start of the stream
+// uint32_t BSP_getLostStreamIC(void);
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	pushdatos
+	bl		BSP_getLostStreamIC
+	movs	tos, r0		// return value
+	pop		{pc}
+
+
 @ -----------------------------------------------------------------------------
 		Wortbirne Flag_visible, "EXTImod"
 		@ ( u a --  )    Sets for pin a the EXTI mode u: 0 rising edge, 1 falling edge, 2 both edges, 3 none
@@ -772,6 +860,64 @@ get_watchdog_adr:
 	movs	tos, r0			// address
 	pop		{pc}
 
+@ -----------------------------------------------------------------------------
+	Wortbirne Flag_visible, "watchdog-register"
+watchdog_register:
+.type watchdog_register, %function
+	@ ( c-addr len u -- n )  Register the calling task, it has to check in at least every u ms
+// int WATCHDOG_register(const char *name, int len, uint32_t timeout);
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	movs	r2, tos		// u -> timeout
+	drop
+	movs	r1, tos		// len
+	drop
+	movs	r0, tos		// c-addr -> name
+	bl		WATCHDOG_register
+	movs	tos, r0		// client id, -1 if the table is full
+	pop		{pc}
+
+@ -----------------------------------------------------------------------------
+	Wortbirne Flag_visible, "watchdog-unregister"
+watchdog_unregister:
+.type watchdog_unregister, %function
+	@ ( n -- )      Unregister the task n
+// void WATCHDOG_unregister(int id);
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	movs	r0, tos		// id
+	drop
+	bl		WATCHDOG_unregister
+	pop		{pc}
+
+@ -----------------------------------------------------------------------------
+	Wortbirne Flag_visible, "watchdog-checkin"
+watchdog_checkin:
+.type watchdog_checkin, %function
+	@ ( n -- )      Task n is alive
+// void WATCHDOG_checkin(int id);
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	movs	r0, tos		// id
+	drop
+	bl		WATCHDOG_checkin
+	pop		{pc}
+
+@ -----------------------------------------------------------------------------
+	Wortbirne Flag_visible, ".watchdog"
+print_watchdog:
+.type print_watchdog, %function
+	@ ( -- )      Print the registered tasks, timeout, time since the last check-in
+// uint64_t WATCHDOG_print(uint64_t forth_stack);
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	movs	r0, tos		// get tos
+	movs	r1, psp		// get psp
+	bl		WATCHDOG_print
+	movs	tos, r0		// update tos
+	movs	psp, r1		// update psp
+	pop		{pc}
+
 
 @ -----------------------------------------------------------------------------
 	Wortbirne Flag_visible, "assert"
@@ -850,6 +996,370 @@ print_assert:
 	pop		{pc}
 
 
+@ -----------------------------------------------------------------------------
+	Wortbirne Flag_visible, ".log"
+print_log:
+.type print_log, %function
+	@ ( --  )      Print the records in the log RAM ring
+// uint64_t LOG_print(uint64_t forth_stack);
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	movs	r0, tos		// get tos
+	movs	r1, psp		// get psp
+	bl		LOG_print
+	movs	tos, r0		// update tos
+	movs	psp, r1		// update psp
+	pop		{pc}
+
+@ -----------------------------------------------------------------------------
+	Wortbirne Flag_visible, ".crashlog"
+print_crashlog:
+.type print_crashlog, %function
+	@ ( --  )      Print the crash dumps (registers, Forth stacks, trace)
+// uint64_t CRASH_print(uint64_t forth_stack);
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	movs	r0, tos		// get tos
+	movs	r1, psp		// get psp
+	bl		CRASH_print
+	movs	tos, r0		// update tos
+	movs	psp, r1		// update psp
+	pop		{pc}
+
+@ -----------------------------------------------------------------------------
+	Wortbirne Flag_visible, "profile-start"
+profile_start:
+.type profile_start, %function
+	@ ( u --  )      Start the sampling profiler with u Hz, 0 for 997 Hz
+// void PROFILE_start(uint32_t hz);
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	movs	r0, tos		// hz
+	drop
+	bl		PROFILE_start
+	pop		{pc}
+
+@ -----------------------------------------------------------------------------
+	Wortbirne Flag_visible, "profile-stop"
+profile_stop:
+.type profile_stop, %function
+	@ ( --  )      Stop the sampling profiler, the samples are kept
+// void PROFILE_stop(void);
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	bl		PROFILE_stop
+	pop		{pc}
+
+@ -----------------------------------------------------------------------------
+	Wortbirne Flag_visible, "profile-clear"
+profile_clear:
+.type profile_clear, %function
+	@ ( --  )      Clear the samples
+// void PROFILE_clear(void);
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	bl		PROFILE_clear
+	pop		{pc}
+
+@ -----------------------------------------------------------------------------
+	Wortbirne Flag_visible, ".profile"
+print_profile:
+.type print_profile, %function
+	@ ( --  )      Print the words and C code with the most samples
+// uint64_t PROFILE_print(uint64_t forth_stack, uint32_t dictionary);
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	bl		dictionarystart
+	movs	r2, tos		// dictionary
+	drop
+	movs	r0, tos		// get tos
+	movs	r1, psp		// get psp
+	bl		PROFILE_print
+	movs	tos, r0		// update tos
+	movs	psp, r1		// update psp
+	pop		{pc}
+
+@ -----------------------------------------------------------------------------
+	Wortbirne Flag_visible, "addr>header"
+addr_header:
+.type addr_header, %function
+	@ ( addr -- a-header ) Header of the word the code address belongs to, 0 for none
+// uint32_t DICT_addrToHeader(uint32_t addr, uint32_t dictionary);
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	bl		dictionarystart
+	movs	r1, tos		// dictionary
+	drop
+	movs	r0, tos		// addr
+	bl		DICT_addrToHeader
+	movs	tos, r0
+	pop		{pc}
+
+@ -----------------------------------------------------------------------------
+	Wortbirne Flag_visible, "addr>name"
+addr_name:
+.type addr_name, %function
+	@ ( addr -- c-addr len ) Name of the word the code address belongs to, len 0 for none
+// uint32_t DICT_addrToHeader(uint32_t addr, uint32_t dictionary);
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	bl		addr_header
+	movs	r0, tos
+	cmp		r0, #0
+	beq		1f
+	adds	r0, #6		// name (counted string)
+	ldrb	r1, [r0]
+	adds	r0, #1
+	movs	tos, r0		// c-addr
+	pushdatos
+	movs	tos, r1		// len
+	pop		{pc}
+1:
+	pushdaconst 0
+	pop		{pc}
+
+@ -----------------------------------------------------------------------------
+	Wortbirne Flag_visible, "wordlist"
+wordlist:
+.type wordlist, %function
+	@ ( -- wid ) Create a new empty wordlist
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	bl		align4komma
+	bl		here
+	pushdaconst 0
+	bl		komma
+	pop		{pc}
+
+@ -----------------------------------------------------------------------------
+	Wortbirne Flag_visible, "init-wordlists"
+init_wordlists:
+.type init_wordlists, %function
+	@ ( wid1 wid2 -- ) Register FORTH-WORDLIST wid1 and ROOT-WORDLIST wid2, default search order
+// void DICT_initWordlists(uint32_t forth, uint32_t root);
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	movs	r1, tos		// root
+	drop
+	movs	r0, tos		// forth
+	drop
+	bl		DICT_initWordlists
+	pop		{pc}
+
+@ -----------------------------------------------------------------------------
+	Wortbirne Flag_visible, "search-wordlist"
+search_wordlist:
+.type search_wordlist, %function
+	@ ( c-addr len wid -- 0 | xt 1 | xt -1 ) Find the word in the wordlist, 1 immediate (Forth-2012)
+// uint32_t DICT_searchWordlist(const uint8_t *str, uint32_t count, uint32_t wid, uint32_t dictionary);
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	bl		find_in_wordlist
+	movs	r0, tos		// flags
+	drop
+	cmp		tos, #0
+	beq		1f			// not found
+	pushdatos
+	movs	tos, #1
+	lsls	r0, #27		// immediate flag 0x0010 to N
+	bmi		1f
+	rsbs	tos, tos, #0
+1:
+	pop		{pc}
+
+@ -----------------------------------------------------------------------------
+	Wortbirne Flag_visible, "find-in-wordlist"
+find_in_wordlist:
+.type find_in_wordlist, %function
+	@ ( c-addr len wid -- xt|0 flags ) Find the word in the wordlist, flags like find
+// uint32_t DICT_searchWordlist(const uint8_t *str, uint32_t count, uint32_t wid, uint32_t dictionary);
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	bl		search_in_wordlist
+	bl		header_xt_flags
+	pop		{pc}
+
+@ -----------------------------------------------------------------------------
+	Wortbirne Flag_visible, "search-in-wordlist"
+search_in_wordlist:
+.type search_in_wordlist, %function
+	@ ( c-addr len wid -- a-header|0 ) Find the word in the wordlist, header address
+// uint32_t DICT_searchWordlist(const uint8_t *str, uint32_t count, uint32_t wid, uint32_t dictionary);
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	bl		dictionarystart
+	movs	r3, tos		// dictionary
+	drop
+	movs	r2, tos		// wid
+	drop
+	movs	r1, tos		// count
+	drop
+	movs	r0, tos		// str
+	bl		DICT_searchWordlist
+	movs	tos, r0
+	pop		{pc}
+
+@ -----------------------------------------------------------------------------
+	Wortbirne Flag_visible, "find-in-order"
+find_in_order:
+.type find_in_order, %function
+	@ ( c-addr len -- xt|0 flags ) Find the word in the search order (for hook-find)
+// uint32_t DICT_findInOrder(const uint8_t *str, uint32_t count, uint32_t dictionary);
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	bl		dictionarystart
+	movs	r2, tos		// dictionary
+	drop
+	movs	r1, tos		// count
+	drop
+	movs	r0, tos		// str
+	bl		DICT_findInOrder
+	movs	tos, r0
+	bl		header_xt_flags
+	pop		{pc}
+
+@ -----------------------------------------------------------------------------
+header_xt_flags:
+	@ ( a-header|0 -- xt|0 flags ) Code start and flags of the header
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	movs	r0, tos
+	cmp		r0, #0
+	beq		1f
+	ldrh	r1, [r0, #4]	// flags
+	adds	r0, #6		// name
+	bl		skipstring
+	movs	tos, r0		// xt
+	pushdatos
+	movs	tos, r1		// flags
+	pop		{pc}
+1:
+	pushdaconst 0
+	pop		{pc}
+
+@ -----------------------------------------------------------------------------
+	Wortbirne Flag_visible, "context"
+context:
+.type context, %function
+	@ ( -- a-addr ) Search order of the compile mode, 0 terminated
+// uint32_t *DICT_context(void);
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	bl		DICT_context
+	pushdatos
+	movs	tos, r0
+	pop		{pc}
+
+@ -----------------------------------------------------------------------------
+	Wortbirne Flag_visible, "get-order"
+get_order:
+.type get_order, %function
+	@ ( -- widn ... wid1 n ) Search order of the compile mode, wid1 is searched first
+// uint32_t *DICT_context(void);
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	bl		DICT_context
+	movs	r3, r0
+	movs	r2, #0
+1:
+	ldr		r1, [r3, r2, lsl #2]
+	cmp		r1, #0
+	beq		2f
+	adds	r2, #1
+	b		1b
+2:
+	movs	r0, r2		// n
+3:
+	cmp		r2, #0
+	beq		4f
+	subs	r2, #1
+	pushdatos
+	ldr		tos, [r3, r2, lsl #2]
+	b		3b
+4:
+	pushdatos
+	movs	tos, r0
+	pop		{pc}
+
+@ -----------------------------------------------------------------------------
+	Wortbirne Flag_visible, "set-order"
+set_order:
+.type set_order, %function
+	@ ( widn ... wid1 n | -1 -- ) Set the search order of the compile mode, -1 default order
+// int DICT_setOrder(int n, const uint32_t *wid);
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	movs	r0, tos		// n
+	movs	r1, psp		// wid1 ... widn
+	bl		DICT_setOrder
+	cmp		r0, #0
+	bge		1f
+	Fehler_Quit " order overflow"
+1:
+	lsls	r0, #2
+	adds	psp, r0		// drop the wids
+	drop
+	pop		{pc}
+
+@ -----------------------------------------------------------------------------
+	Wortbirne Flag_visible, "logfile"
+logfile:
+.type logfile, %function
+	@ ( c-addr len -- ior ) Set the log file, len 0 switches the log file off
+// int LOG_setFile(uint8_t *str, int count);
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	movs	r1, tos		// len -> count
+	drop
+	movs	r0, tos		// c-addr -> str
+	bl		LOG_setFile
+	movs	tos, r0		// ior, -1 path too long
+	pop		{pc}
+
+@ -----------------------------------------------------------------------------
+	Wortbirne Flag_visible, ">log"
+to_log:
+.type to_log, %function
+	@ ( u1 u2 u3 c-addr -- ) Log the 0-terminated format string with 3 args
+// int LOG_writeUser(const char *fmt, uint32_t a0, uint32_t a1, uint32_t a2);
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	movs	r0, tos		// c-addr -> fmt
+	drop
+	movs	r3, tos		// u3 -> a2
+	drop
+	movs	r2, tos		// u2 -> a1
+	drop
+	movs	r1, tos		// u1 -> a0
+	drop
+	bl		LOG_writeUser
+	pop		{pc}
+
+@ -----------------------------------------------------------------------------
+	Wortbirne Flag_visible, "logflush"
+logflush:
+.type logflush, %function
+	@ ( -- ) Write the pending log records to the log file
+// void LOG_flush(void);
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	bl		LOG_flush
+	pop		{pc}
+
+@ -----------------------------------------------------------------------------
+	Wortbirne Flag_visible, "log#"
+get_log_lost:
+.type get_log_lost, %function
+	@ ( -- u )      How many log records are lost since startup?
+// int LOG_getLost(void);
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	pushdatos
+	bl		LOG_getLost
+	movs	tos, r0			// count
+	pop		{pc}
+
+
 @ -----------------------------------------------------------------------------
     Wortbirne Flag_visible, "FusVersion"
 FusVersion:
@@ -1142,5 +1652,20 @@ store_dccaccessory:
 	pop		{pc}
 
 
+@ -----------------------------------------------------------------------------
+	Wortbirne Flag_visible, "DCCstats"
+print_dccstats:
+	@ ( -- ) print packets/s, track load, and queue latency
+// uint64_t DCC_printStats(uint64_t forth_stack);
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	movs	r0, tos		// get tos
+	movs	r1, psp		// get psp
+	bl		DCC_printStats
+	movs	tos, r0		// update tos
+	movs	psp, r1		// update psp
+	pop		{pc}
+
+
 .endif // DCC
 
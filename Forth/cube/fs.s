@@ -1325,7 +1325,7 @@ fs_f_opendir:
 	movs	r1, tos		// path
 	drop
 	movs	r0, tos		// dp
-	bl		f_opendir
+	bl		DIRCACHE_opendir
 	movs	tos, r0
 	pop		{pc}
 
@@ -1340,7 +1340,7 @@ fs_f_opendir:
 fs_f_closedir:
 	push	{lr}
 	movs	r0, tos		// dp
-	bl		f_closedir
+	bl		DIRCACHE_closedir
 	movs	tos, r0
 	pop		{pc}
 
@@ -1358,7 +1358,7 @@ fs_f_readdir:
 	movs	r1, tos		// fno
 	drop
 	movs	r0, tos		// dp
-	bl		f_readdir
+	bl		DIRCACHE_readdir
 	movs	tos, r0
 	pop		{pc}
 
@@ -1382,7 +1382,7 @@ fs_f_findfirst:
 	movs	r1, tos		// fno
 	drop
 	movs	r0, tos		// dp
-	bl		f_findfirst
+	bl		DIRCACHE_findfirst
 	movs	tos, r0
 	pop		{pc}
 
@@ -1400,7 +1400,28 @@ fs_f_findnext:
 	movs	r1, tos		// fno
 	drop
 	movs	r0, tos		// dp
-	bl		f_findnext
+	bl		DIRCACHE_findnext
+	movs	tos, r0
+	pop		{pc}
+
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "dir-entries"
+		@  ( dp adr n -- u )  Read the next n items (matched) into a FILINFO array
+// int DIRCACHE_entries(
+//   DIR* dp,              /* [IN] Pointer to the open directory object */
+//   FILINFO* fno,         /* [OUT] Pointer to the FILINFO array */
+//   int n                 /* [IN] Number of FILINFO structures */
+// );
+@ -----------------------------------------------------------------------------
+fs_dir_entries:
+	push	{lr}
+	movs	r2, tos		// n
+	drop
+	movs	r1, tos		// fno
+	drop
+	movs	r0, tos		// dp
+	bl		DIRCACHE_entries
 	movs	tos, r0
 	pop		{pc}
 
@@ -1421,7 +1442,7 @@ fs_f_stat:
 	movs	r1, tos		// fno
 	drop
 	movs	r0, tos		// path
-	bl		f_stat
+	bl		DIRCACHE_stat
 	movs	tos, r0
 	pop		{pc}
 
@@ -1705,6 +1726,94 @@ fs_get_fattime:
 	pop		{pc}
 
 
+// Data Logging Files
+// ******************
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "/DATALOG"
+		@ ( -- u ) Gets the data logging file structure size
+// int DATALOG_size(void)
+@ -----------------------------------------------------------------------------
+slashDATALOG:
+	push	{lr}
+	pushdatos
+	bl		DATALOG_size
+	movs	tos, r0
+	pop		{pc}
+
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "datalog-create"
+		@  ( dl adr u -- u )  Create a contiguous pre-allocated file of size u
+// FRESULT DATALOG_create(
+//   DATALOG_t *dl,        /* [OUT] Pointer to the data logging file object */
+//   const TCHAR *path,    /* [IN] File name */
+//   FSIZE_t size          /* [IN] Pre-allocated file size */
+// );
+@ -----------------------------------------------------------------------------
+fs_datalog_create:
+	push	{lr}
+	movs	r2, tos		// size
+	drop
+	movs	r1, tos		// path
+	drop
+	movs	r0, tos		// dl
+	bl		DATALOG_create
+	movs	tos, r0
+	pop		{pc}
+
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "datalog-write"
+		@  ( dl adr u -- u )  Append data, raw multi-block writes
+// FRESULT DATALOG_write(
+//   DATALOG_t *dl,        /* [IN] Pointer to the data logging file object */
+//   const void *buff,     /* [IN] Pointer to the data to be written */
+//   UINT btw              /* [IN] Number of bytes to write */
+// );
+@ -----------------------------------------------------------------------------
+fs_datalog_write:
+	push	{lr}
+	movs	r2, tos		// btw
+	drop
+	movs	r1, tos		// buff
+	drop
+	movs	r0, tos		// dl
+	bl		DATALOG_write
+	movs	tos, r0
+	pop		{pc}
+
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "datalog-sync"
+		@  ( dl -- u )  Write buffered data and update the directory entry
+// FRESULT DATALOG_sync(
+//   DATALOG_t *dl         /* [IN] Pointer to the data logging file object */
+// );
+@ -----------------------------------------------------------------------------
+fs_datalog_sync:
+	push	{lr}
+	movs	r0, tos		// dl
+	bl		DATALOG_sync
+	movs	tos, r0
+	pop		{pc}
+
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "datalog-close"
+		@  ( dl -- u )  Sync, release the clusters not used and close the file
+// FRESULT DATALOG_close(
+//   DATALOG_t *dl         /* [IN] Pointer to the data logging file object */
+// );
+@ -----------------------------------------------------------------------------
+fs_datalog_close:
+	push	{lr}
+	movs	r0, tos		// dl
+	bl		DATALOG_close
+	movs	tos, r0
+	pop		{pc}
+
+
 // C String Functions
 // ******************
 
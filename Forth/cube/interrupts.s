@@ -37,4 +37,55 @@
 // interrupt tim4
 
 @------------------------------------------------------------------------------
+@ Forth words as hooks for the C interrupt service routines (see irq.c)
+@ The C ISR calls IRQ_forth with the XT and a private data stack.
+@------------------------------------------------------------------------------
+
+.global IRQ_forth
+.type IRQ_forth, %function
+// void IRQ_forth(uint32_t xt, uint32_t *stack)
+IRQ_forth:
+	push	{r4, r5, r6, r7, r8, lr}	// r8 for 8 byte stack alignment
+	movs	psp, r1		// private data stack
+	movs	tos, #0
+	orrs	r0, #1		// thumb
+	blx		r0
+	pop		{r4, r5, r6, r7, r8, pc}
+
+
+.macro irqhook Name, Index
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "irq-\Name"
+		@ ( -- a )    Hook for the Forth ISR, 0 for none
+@ -----------------------------------------------------------------------------
+	pushdatos
+	ldr		tos, =IRQ_hook + 4*\Index
+	bx		lr
+
+.endm
+
+irqhook exti4, 0	// D10
+irqhook exti6, 1	// D2
+irqhook exti10, 2	// D4
+irqhook exti13, 3	// D7
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, ".irqstats"
+print_irqstats:
+.type print_irqstats, %function
+	@ ( -- )      Print the latency and duration of the Forth ISRs in CPU cycles
+// uint64_t IRQ_print(uint64_t forth_stack);
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	movs	r0, tos		// get tos
+	movs	r1, psp		// get psp
+	bl		IRQ_print
+	movs	tos, r0		// update tos
+	movs	psp, r1		// update psp
+	pop		{pc}
+
+@------------------------------------------------------------------------------
+
 
+.ltorg
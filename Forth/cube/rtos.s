@@ -721,6 +721,59 @@ rtos_osDelayUntil:
 	movs	tos, r0
 	pop		{pc}
 
+
+//  ==== Microsecond Clock ====
+
+// -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "us@"
+		@ ( -- ud ) Monotonic clock in us since the start (64 bit).
+// uint64_t USCLOCK_get(void);
+// -----------------------------------------------------------------------------
+us_fetch:
+	push	{lr}
+	pushdatos
+	bl		USCLOCK_get
+	movs	tos, r0		// low
+	pushdatos
+	movs	tos, r1		// high
+	pop		{pc}
+
+// -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "us-delay"
+		@ ( u -- ) Waits u us, sleeps the whole ticks and busy-waits the rest.
+// void USCLOCK_delay(uint32_t us);
+// -----------------------------------------------------------------------------
+us_delay:
+	push	{lr}
+	movs	r0, tos		// us
+	drop
+	bl		USCLOCK_delay
+	pop		{pc}
+
+// -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "deadline-wait"
+		@ ( ud -- ) Waits till the us clock reaches the deadline ud.
+// void USCLOCK_waitUntil(uint64_t deadline);
+// -----------------------------------------------------------------------------
+deadline_wait:
+	push	{lr}
+	movs	r1, tos		// high
+	drop
+	movs	r0, tos		// low
+	drop
+	bl		USCLOCK_waitUntil
+	pop		{pc}
+
+// -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "cycles"
+		@ ( -- u ) DWT cycle counter in CPU clock cycles, wraps after 134 s.
+// -----------------------------------------------------------------------------
+cycles:
+	pushdatos
+	ldr		tos, =0xE0001004	// DWT->CYCCNT
+	ldr		tos, [tos]
+	bx		lr
+
 .ltorg
 
 // Thread Management
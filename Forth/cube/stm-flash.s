@@ -43,6 +43,38 @@ eightflashstore: @ ( x1 x2 addr -- ) x1 contains LSB of those 64 bits.
 	pop		{r0-r3, pc}
 
 
+@ -----------------------------------------------------------------------------
+eightflashstage: @ ( x1 x2 addr -- ) Stages 8 Bytes in the row buffer
+	@ The row is written on the next row, with flushstage or when complete.
+@ -----------------------------------------------------------------------------
+	push	{r0-r3, lr}
+	movs	r0, tos		// set Address
+	drop
+	movs	r2, tos		// set word2
+	drop
+	movs	r1, tos		// set word1
+	drop
+	bl		FLASH_stageDouble
+	pop		{r0-r3, pc}
+
+
+@ -----------------------------------------------------------------------------
+flushstage: @ ( -- ) Writes the staged row buffer into Flash.
+@ -----------------------------------------------------------------------------
+	push	{r0-r3, lr}
+	bl		FLASH_flushStage
+	pop		{r0-r3, pc}
+
+
+@ -----------------------------------------------------------------------------
+readstage: @ r0 address, r1 length -- r0 true if the row buffer was written
+	@ The dictionary search reads erased flash, the range could be staged.
+@ -----------------------------------------------------------------------------
+	push	{r1-r3, lr}
+	bl		FLASH_readStage
+	pop		{r1-r3, pc}
+
+
 @ -----------------------------------------------------------------------------
 	Wortbirne Flag_visible, "flashpageerase" @ ( Addr -- )
 	@ Deletes one 4 KiB Flash page
@@ -65,6 +65,32 @@ neopixels:
 	bl		BSP_setNeoPixels
 	pop		{pc}
 
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "neopixels-start"
+neopixels_start:
+		@ ( addr len --  ) start neopixels (DMA, returns before the transfer is done)
+// void BSP_startNeoPixels(uint32_t *buffer, unit32_t len)
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	movs	r1, tos		// len
+	drop
+	movs	r0, tos		// buffer
+	drop
+	bl		BSP_startNeoPixels
+	pop		{pc}
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "neopixels?"
+neopixels_q:
+		@ (  --  flag ) neopixels transfer done, buffer can be reused
+// int BSP_getNeoPixelsReady(void)
+@ -----------------------------------------------------------------------------
+	push	{lr}
+	pushdatos
+	bl		BSP_getNeoPixelsReady
+	movs	tos, r0
+	pop		{pc}
+
 
 /*
 	void BSP_neopixelDataTx(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin, uint32_t rgb);
@@ -122,68 +148,6 @@ bit_loop:
 	pop		{r4-r6, pc}
 
 
-/*
-	void BSP_neopixelBufferTx(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin, uint32_t *buffer, uint32_t len);
-	                                      R0              R1             R2 rgb           R3
-
-	Cycle = 1 / 168 MHz = 6 ns
-	R0 GPIOx
-	R1 GPIO_Pin set
-	R2 *buffer
-	R3 pixels
-	R4 high time
-	R5 low time
-	R6 bit count
-	R7 bits
-	R8 GPIO_Pin reset
-*/
-
-
-.global		BSP_neopixelBufferTx
-.type 		BSP_neopixelBufferTx, %function
-BSP_neopixelBufferTx:
-	push	{r4-r8, lr}
-	lsl		r8, r1, #16			// clear port pin for BSRR
-
-pixel_loop:
-	ldr		r7, [r2]			// r7 = 00rrggbb
-	lsl		r7, r7, #8			// r7 = rrggbb00
-	mov		r6, r7				// r6 = rrggbb00
-	bfc		r6, #16, #16		// r6 = 0000bb00
-	rev16	r7, r7				// r7 = ggrr00bb
-	bfc		r7, #0, #16			// r7 = ggrr0000
-	add		r7, r7, r6			// r7 = ggrrbb00
-	mov		r6, #24				// 24 bits
-
-bit_loop2:
-	lsls	r7, r7, #1			// get the next bit -> set the carry bit
-	ittee	cs
-	movcs	r4, #T1H
-	movcs	r5, #T1L
-	movcc	r4, #T0H
-	movcc	r5, #T0L
-
-
-	// set DOUT pin high
-	str		r1, [r0, #GPIO_BSRR]
-1:	subs	r4, r4, #1
-	bne		1b
-
-	// set DOUT pin low
-	str		r8, [r0, #GPIO_BSRR]
-2:	subs	r5, r5, #1
-	bne		2b
-
-	subs	r6, r6, #1
-	bne		bit_loop2
-
-	add		r2, r2, #4
-	subs	r3, r3, #1
-	bne		pixel_loop
-
-	pop		{r4-r8, pc}
-
-
 // PLEX words only if needed
 .if PLEX == 1
 
@@ -83,6 +83,8 @@
 .equ	POWER,				1
 .equ	SD_DRIVE,			0
 .equ	DCC,				1
+.equ	MEM_DMA,			1
+.equ	MEM_DMA_THRESHOLD,	1024	// move/fill with DMA from this size on
 
 @ -----------------------------------------------------------------------------
 @ Start with some essential macro definitions
@@ -211,6 +213,12 @@ RAM_SHARED (xrw)           : ORIGIN = 0x20030000, LENGTH = 10K
 
 	ramallot 	inline_cache_count, 4
 
+	ramallot	peephole_offset, 4
+	ramallot	peephole_push, 4
+	ramallot	peephole_stm, 4
+	ramallot	peephole_ldr, 4
+	ramallot	peephole_reload, 4
+
 
 .equ allocator_base, state_tos
 
@@ -231,6 +239,12 @@ RAM_SHARED (xrw)           : ORIGIN = 0x20030000, LENGTH = 10K
 .equ	offset_constant_r0,		12 * 4
 .equ	offset_inline_cache_count,	13 * 4
 
+.equ	offset_peephole_offset,	14 * 4		@ Pending 12 bit offset relative to r0
+.equ	offset_peephole_push,	15 * 4		@ Next inlined code starts with pushdatos
+.equ	offset_peephole_stm,	16 * 4		@ Statistics for .peephole
+.equ	offset_peephole_ldr,	17 * 4
+.equ	offset_peephole_reload,	18 * 4
+
 
 .equ	rawinlinelength,		10 @ How many opcodes long may definitions be for direct inlining ?
 .equ	inline_cache_length,	6 @ For optimisation across inlined definitions, how many compilation steps should be buffered at most ?
@@ -327,6 +341,7 @@ CoreDictionaryAnfang: @ Dictionary-Einsprungpunkt setzen
 .include "ra/comparisions.s"
 .ltorg
 .include "ra/memory.s"
+.include "memmove.s"
 .include "stm-flash.s"
 .ltorg
 
@@ -387,6 +402,7 @@ CoreDictionaryAnfang: @ Dictionary-Einsprungpunkt setzen
 .include "comparisions.s"
 .ltorg
 .include "memory.s"
+.include "memmove.s"
 .include "stm-flash.s"
 .ltorg
 
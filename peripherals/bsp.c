@@ -8,8 +8,8 @@
  *        - Analog port pins A0 to A5 (Dongle: A2, A3)
  *        - PWM: D3 TIM1CH3, D6 TIM1CH1, D9 TIM1CH2 (Dongle: D6)
  *        - SPI: D11 MOSI, D12 MISO, D13 SCK (display, memory)
- *        - Timer Capture/Compare
- *        - NeoPixel D8 (Dongle D6)
+ *        - Timer Capture/Compare, capture stream and compare sequence by DMA
+ *        - NeoPixel D8 (Dongle D6), NeoPixel chain D6 TIM1CH1 DMA
  *        - 8 Buttons D2 A, D3 B, D4 C, D5 D, D6 E, D7 F, D8 G, D9 H or Button matrix 5x7
  *
  *      Forth TRUE is -1, C TRUE is 1.
@@ -51,12 +51,26 @@
 #include "main.h"
 #include "bsp.h"
 #include "button.h"
+#include "irq.h"
 #include "stm32_lpm.h"
 
 
 // Private function prototypes
 // ***************************
-static void update_sysled(void);
+static void SysLED_Thread(void *argument);
+static uint32_t sysled_color(uint32_t status);
+static void sysled_notify(void);
+static void atomic_or(volatile uint32_t *adr, uint32_t bits);
+static uint32_t atomic_swap(volatile uint32_t *adr, uint32_t value);
+static void neopixels_wait(void);
+static void neopixels_fill(int half);
+static void neopixels_stop(void);
+static void neopixels_half(DMA_HandleTypeDef *hdma);
+static void neopixels_complete(DMA_HandleTypeDef *hdma);
+static int ic_polarity(uint32_t mode);
+static uint32_t ic_written(void);
+static void ic_lap(DMA_HandleTypeDef *hdma);
+static void oc_sequence_complete(DMA_HandleTypeDef *hdma);
 
 // Global Variables
 // ****************
@@ -66,10 +80,21 @@ extern TIM_HandleTypeDef htim2;
 // Hardware resources
 // ******************
 extern TIM_HandleTypeDef htim1;
+DMA_HandleTypeDef hdma_tim1_up;
+DMA_HandleTypeDef hdma_tim2_ch2;
+DMA_HandleTypeDef hdma_tim2_oc;
 
 // RTOS resources
 // **************
 
+// Definitions for the system LED thread
+static osThreadId_t SysLED_ThreadId = NULL;
+static const osThreadAttr_t SysLED_ThreadAttr = {
+		.name = "SysLED",
+		.priority = (osPriority_t) osPriorityLow,
+		.stack_size = 128 * 4
+};
+
 static osMutexId_t DigitalPort_MutexID;
 static const osMutexAttr_t DigitalPort_MutexAttr = {
 		NULL,				// no name required
@@ -98,6 +123,8 @@ static osSemaphoreId_t EXTI_4_SemaphoreID;
 static osSemaphoreId_t EXTI_9_5_SemaphoreID;
 static osSemaphoreId_t EXTI_15_10_SemaphoreID;
 
+static osSemaphoreId_t NeoPixels_SemaphoreID;
+
 
 // Private Variables
 // *****************
@@ -106,8 +133,43 @@ extern ADC_HandleTypeDef hadc1;
 uint32_t neo_pixel = 0;
 
 static uint32_t adc_calibration;
-//static int sys_led_status = SYSLED_ACTIVATE;
-static int sys_led_status = 0;
+
+// NeoPixel chain: TIM1 CH1 PWM, the DMA writes CCR1 on every update (bit)
+#define NEOPIXEL_PERIOD		40		// 1.25 us @ 32 MHz
+#define NEOPIXEL_T0H		13		// 0.4 us
+#define NEOPIXEL_T1H		26		// 0.8 us
+#define NEOPIXEL_CHUNK		8		// pixels per half buffer (240 us)
+#define NEOPIXEL_BITS		24
+#define NEOPIXEL_RESET		2		// half buffers low (480 us), WS2812B V5 needs 280 us
+
+static uint16_t neopixels_buffer[2 * NEOPIXEL_CHUNK * NEOPIXEL_BITS];
+static uint32_t *neopixels_pixels;
+static uint32_t neopixels_count;
+static int neopixels_zeros;			// half buffers filled with the reset (low)
+static int neopixels_latch[2];		// last half buffer of the reset
+static uint32_t neopixels_psc, neopixels_arr, neopixels_ccr1, neopixels_ccr2, neopixels_ccr3;
+static uint32_t neopixels_moder, neopixels_afr;
+
+// Input capture stream (A2 TIM2 CH2), the DMA writes every capture into the ring
+#define IC_STREAM_SIZE		256		// timestamps, power of 2
+#define IC_STREAM_GUARD		16		// timestamps the reader keeps away from the DMA
+
+static uint32_t ic_stream[IC_STREAM_SIZE];
+static volatile uint32_t ic_laps;	// DMA ring wrap arounds
+static uint32_t ic_read;			// timestamps read since start
+static uint32_t ic_lost;			// timestamps overwritten before read
+static int ic_streaming = FALSE;
+
+// Output compare sequence, one pin at a time
+static int oc_sequence_pin = -1;
+static uint32_t oc_sequence_channel;
+// system LED, set and cleared lock-free, the SysLED thread renders it
+#define SYSLED_UPDATE		0x01	// thread flag
+#define SYSLED_PERIOD		50		// ms, max. update rate
+
+//static volatile uint32_t sys_led_status = SYSLED_ACTIVATE;
+static volatile uint32_t sys_led_status = 0;
+static volatile uint32_t sys_led_events = 0;	// shown for at least one period
 
 
 // Public Functions
@@ -167,6 +229,70 @@ void BSP_init(void) {
 		Error_Handler();
 	}
 
+	NeoPixels_SemaphoreID = osSemaphoreNew(1, 1, NULL);
+	if (NeoPixels_SemaphoreID == NULL) {
+		Error_Handler();
+	}
+
+	SysLED_ThreadId = osThreadNew(SysLED_Thread, NULL, &SysLED_ThreadAttr);
+	if (SysLED_ThreadId == NULL) {
+		Error_Handler();
+	}
+
+	// NeoPixel chain TIM1 update -> CCR1
+	__HAL_RCC_DMA2_CLK_ENABLE();
+	__HAL_RCC_DMAMUX1_CLK_ENABLE();
+	hdma_tim1_up.Instance = DMA2_Channel4;
+	hdma_tim1_up.Init.Request = DMA_REQUEST_TIM1_UP;
+	hdma_tim1_up.Init.Direction = DMA_MEMORY_TO_PERIPH;
+	hdma_tim1_up.Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma_tim1_up.Init.MemInc = DMA_MINC_ENABLE;
+	hdma_tim1_up.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+	hdma_tim1_up.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+	hdma_tim1_up.Init.Mode = DMA_CIRCULAR;
+	hdma_tim1_up.Init.Priority = DMA_PRIORITY_HIGH;
+	if (HAL_DMA_Init(&hdma_tim1_up) != HAL_OK) {
+		Error_Handler();
+	}
+	hdma_tim1_up.XferHalfCpltCallback = neopixels_half;
+	hdma_tim1_up.XferCpltCallback = neopixels_complete;
+	HAL_NVIC_SetPriority(DMA2_Channel4_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(DMA2_Channel4_IRQn);
+
+	// input capture stream TIM2 CH2 -> ring buffer
+	hdma_tim2_ch2.Instance = DMA2_Channel5;
+	hdma_tim2_ch2.Init.Request = DMA_REQUEST_TIM2_CH2;
+	hdma_tim2_ch2.Init.Direction = DMA_PERIPH_TO_MEMORY;
+	hdma_tim2_ch2.Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma_tim2_ch2.Init.MemInc = DMA_MINC_ENABLE;
+	hdma_tim2_ch2.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+	hdma_tim2_ch2.Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
+	hdma_tim2_ch2.Init.Mode = DMA_CIRCULAR;
+	hdma_tim2_ch2.Init.Priority = DMA_PRIORITY_MEDIUM;
+	if (HAL_DMA_Init(&hdma_tim2_ch2) != HAL_OK) {
+		Error_Handler();
+	}
+	hdma_tim2_ch2.XferCpltCallback = ic_lap;
+	HAL_NVIC_SetPriority(DMA2_Channel5_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(DMA2_Channel5_IRQn);
+
+	// output compare sequence table -> TIM2 CCRx, request set by BSP_startSequenceOC()
+	hdma_tim2_oc.Instance = DMA2_Channel6;
+	hdma_tim2_oc.Init.Request = DMA_REQUEST_TIM2_CH1;
+	hdma_tim2_oc.Init.Direction = DMA_MEMORY_TO_PERIPH;
+	hdma_tim2_oc.Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma_tim2_oc.Init.MemInc = DMA_MINC_ENABLE;
+	hdma_tim2_oc.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+	hdma_tim2_oc.Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
+	hdma_tim2_oc.Init.Mode = DMA_NORMAL;
+	hdma_tim2_oc.Init.Priority = DMA_PRIORITY_MEDIUM;
+	if (HAL_DMA_Init(&hdma_tim2_oc) != HAL_OK) {
+		Error_Handler();
+	}
+	hdma_tim2_oc.XferCpltCallback = oc_sequence_complete;
+	HAL_NVIC_SetPriority(DMA2_Channel6_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(DMA2_Channel6_IRQn);
+
 	// ADC calibration
 	HAL_ADCEx_Calibration_Start(&hadc1, ADC_SINGLE_ENDED);
 	adc_calibration = HAL_ADCEx_Calibration_GetValue(&hadc1, ADC_SINGLE_ENDED);
@@ -844,7 +970,8 @@ void BSP_setDigitalPinMode(int pin_number, int mode) {
 void BSP_setPwmPin(int pin_number, int value) {
 	// only one thread is allowed to use the digital port
 	osMutexAcquire(DigitalPort_MutexID, osWaitForever);
-
+	// TIM1 is borrowed by the NeoPixel chain
+	neopixels_wait();
 
 	switch (pin_number) {
 	case 3:
@@ -878,6 +1005,7 @@ void BSP_setPwmPin(int pin_number, int value) {
 void BSP_setPwmPrescale(uint16_t value) {
 	// only one thread is allowed to use the digital port
 	osMutexAcquire(DigitalPort_MutexID, osWaitForever);
+	neopixels_wait();
 
 	__HAL_TIM_SET_PRESCALER(&htim1, ++value);
 
@@ -1068,6 +1196,12 @@ void BSP_startOC(int pin_number, uint32_t pulse) {
  *      none
  */
 void BSP_stopOC(int pin_number) {
+	if (pin_number == oc_sequence_pin) {
+		__HAL_TIM_DISABLE_DMA(&htim2, TIM_DMA_CC1 << (oc_sequence_channel >> 2));
+		HAL_DMA_Abort(&hdma_tim2_oc);
+		oc_sequence_pin = -1;
+	}
+
 	switch (pin_number) {
 	case 0:
 		HAL_TIM_OC_Stop_IT(&htim2, TIM_CHANNEL_4);
@@ -1091,19 +1225,9 @@ void BSP_stopOC(int pin_number) {
  *      none
  */
 void BSP_startIC(uint32_t mode) {
-	switch(mode) {
-	case 0:
-		__HAL_TIM_SET_CAPTUREPOLARITY(&htim2, TIM_CHANNEL_2, TIM_INPUTCHANNELPOLARITY_RISING);
-		break;
-	case 1:
-		__HAL_TIM_SET_CAPTUREPOLARITY(&htim2, TIM_CHANNEL_2, TIM_INPUTCHANNELPOLARITY_FALLING);
-		break;
-	case 2:
-		__HAL_TIM_SET_CAPTUREPOLARITY(&htim2, TIM_CHANNEL_2, TIM_INPUTCHANNELPOLARITY_BOTHEDGE);
-		break;
-	default:
+	BSP_stopStreamIC();
+	if (! ic_polarity(mode)) {
 		return;
-
 	}
 	osSemaphoreAcquire(ICOC_CH2_SemaphoreID, 0);
 	HAL_TIM_IC_Start_IT(&htim2, TIM_CHANNEL_2);
@@ -1172,6 +1296,185 @@ void BSP_waitOC(int pin_number) {
 }
 
 
+/**
+ *  @brief
+ *	    Starts an Output Compare sequence.
+ *
+ *	    The first compare value is set at once, every match loads the next
+ *	    value from the table by DMA. Use toggle mode (OCmod 3) for pulse
+ *	    trains. OCwait returns after the match of the last value, the
+ *	    last two values must be more than the interrupt latency apart.
+ *	    The table must not be changed till the end of the sequence.
+ *	@param[in]
+ *	    pin_number  port pin 0 D0, 1 D1, or 5 D5
+ *	@param[in]
+ *	    table       compare values (absolute counter values)
+ *	@param[in]
+ *	    len         number of compare values
+ *  @return
+ *      none
+ */
+void BSP_startSequenceOC(int pin_number, uint32_t *table, uint32_t len) {
+	uint32_t ch, request;
+
+	switch (pin_number) {
+	case 0:
+		ch = TIM_CHANNEL_4;
+		request = DMA_REQUEST_TIM2_CH4;
+		osSemaphoreAcquire(ICOC_CH4_SemaphoreID, 0);
+		break;
+	case 1:
+		ch = TIM_CHANNEL_3;
+		request = DMA_REQUEST_TIM2_CH3;
+		osSemaphoreAcquire(ICOC_CH3_SemaphoreID, 0);
+		break;
+	case 5:
+		ch = TIM_CHANNEL_1;
+		request = DMA_REQUEST_TIM2_CH1;
+		osSemaphoreAcquire(ICOC_CH1_SemaphoreID, 0);
+		break;
+	default:
+		return;
+	}
+	if (len == 0) {
+		return;
+	}
+
+	// only one sequence at a time
+	if (oc_sequence_pin >= 0) {
+		BSP_stopOC(oc_sequence_pin);
+	}
+	BSP_stopOC(pin_number);
+
+	__HAL_TIM_SET_COMPARE(&htim2, ch, table[0]);
+	if (len == 1) {
+		HAL_TIM_OC_Start_IT(&htim2, ch);
+		return;
+	}
+
+	hdma_tim2_oc.Init.Request = request;
+	if (HAL_DMA_Init(&hdma_tim2_oc) != HAL_OK) {
+		Error_Handler();
+	}
+	oc_sequence_pin = pin_number;
+	oc_sequence_channel = ch;
+	// CCR1 .. CCR4 are consecutive, TIM_CHANNEL_x is the offset
+	HAL_DMA_Start_IT(&hdma_tim2_oc, (uint32_t)&table[1], (uint32_t)&TIM2->CCR1 + ch, len - 1);
+	__HAL_TIM_ENABLE_DMA(&htim2, TIM_DMA_CC1 << (ch >> 2));
+	TIM_CCxChannelCmd(TIM2, ch, TIM_CCx_ENABLE);
+	__HAL_TIM_ENABLE(&htim2);
+}
+
+
+/**
+ *  @brief
+ *	    Starts the Input Capture stream on A2.
+ *
+ *	    Every edge is written by DMA into a ring buffer of 256 timestamps,
+ *	    no interrupt per edge. The timestamps are the 32 bit TIMER2 counter
+ *	    values. If the ring is not read in time, the oldest timestamps are
+ *	    lost and counted.
+ *	@param[in]
+ *      mode  0 rising edge, 1 falling edge, 2 both edges
+ *  @return
+ *      none
+ */
+void BSP_startStreamIC(uint32_t mode) {
+	BSP_stopIC();
+	BSP_stopStreamIC();
+	if (! ic_polarity(mode)) {
+		return;
+	}
+
+	ic_laps = 0;
+	ic_read = 0;
+	ic_lost = 0;
+	HAL_DMA_Start_IT(&hdma_tim2_ch2, (uint32_t)&TIM2->CCR2, (uint32_t)ic_stream, IC_STREAM_SIZE);
+	__HAL_TIM_ENABLE_DMA(&htim2, TIM_DMA_CC2);
+	TIM_CCxChannelCmd(TIM2, TIM_CHANNEL_2, TIM_CCx_ENABLE);
+	__HAL_TIM_ENABLE(&htim2);
+	ic_streaming = TRUE;
+}
+
+
+/**
+ *  @brief
+ *	    Stops the Input Capture stream.
+ *  @return
+ *      none
+ */
+void BSP_stopStreamIC(void) {
+	if (! ic_streaming) {
+		return;
+	}
+	TIM_CCxChannelCmd(TIM2, TIM_CHANNEL_2, TIM_CCx_DISABLE);
+	__HAL_TIM_DISABLE_DMA(&htim2, TIM_DMA_CC2);
+	HAL_DMA_Abort(&hdma_tim2_ch2);
+	ic_streaming = FALSE;
+}
+
+
+/**
+ *  @brief
+ *	    Number of timestamps in the Input Capture stream.
+ *
+ *	    Timestamps the DMA is about to overwrite are dropped and counted
+ *	    as lost.
+ *  @return
+ *      number of timestamps ready to read
+ */
+uint32_t BSP_getStreamIC(void) {
+	uint32_t count;
+
+	if (! ic_streaming) {
+		return 0;
+	}
+	count = ic_written() - ic_read;
+	if (count > IC_STREAM_SIZE - IC_STREAM_GUARD) {
+		ic_lost += count - (IC_STREAM_SIZE - IC_STREAM_GUARD);
+		ic_read += count - (IC_STREAM_SIZE - IC_STREAM_GUARD);
+		count = IC_STREAM_SIZE - IC_STREAM_GUARD;
+	}
+	return count;
+}
+
+
+/**
+ *  @brief
+ *	    Reads timestamps from the Input Capture stream.
+ *	@param[in]
+ *      buffer  for the timestamps
+ *	@param[in]
+ *      len     max. number of timestamps
+ *  @return
+ *      number of timestamps read
+ */
+uint32_t BSP_readStreamIC(uint32_t *buffer, uint32_t len) {
+	uint32_t count = BSP_getStreamIC();
+	uint32_t i;
+
+	if (len < count) {
+		count = len;
+	}
+	for (i = 0; i < count; i++) {
+		buffer[i] = ic_stream[(ic_read + i) & (IC_STREAM_SIZE - 1)];
+	}
+	ic_read += count;
+	return count;
+}
+
+
+/**
+ *  @brief
+ *	    Timestamps lost since the start of the Input Capture stream.
+ *  @return
+ *      number of lost timestamps
+ */
+uint32_t BSP_getLostStreamIC(void) {
+	return ic_lost;
+}
+
+
 // EXTI
 // ****
 
@@ -1274,9 +1577,313 @@ int BSP_waitEXTI(int pin_number, int32_t timeout) {
 // Private Functions
 // *****************
 
+/**
+ *  @brief
+ *	    System LED thread, renders the status at a bounded rate.
+ *
+ *	    Disk operations post their activity without waiting for the
+ *	    NeoPixel (30 us with interrupts disabled and osDelay(1)).
+ *	    The disk activity is always shown (yellow read, red write), if the
+ *	    system LED is not activated the user color is restored afterwards.
+ *	@param[in]
+ *      argument  not used
+ *  @return
+ *      none
+ */
+static void SysLED_Thread(void *argument) {
+	uint32_t events;
+	uint32_t rgb;
+	uint32_t last = 0xFFFFFFFF;		// no valid color
+	uint32_t user_rgb = 0;
+	int disk_shown = FALSE;			// user color saved
+
+	for (;;) {
+		osThreadFlagsWait(SYSLED_UPDATE, osFlagsWaitAny, osWaitForever);
+		do {
+			events = atomic_swap(&sys_led_events, 0);
+			if (sys_led_status & SYSLED_ACTIVATE) {
+				rgb = sysled_color(sys_led_status | events);
+				if (rgb != last) {
+					BSP_setNeoPixel(rgb);
+					last = rgb;
+				}
+				disk_shown = FALSE;
+			} else if ((sys_led_status | events)
+					& (SYSLED_DISK_READ_OPERATION | SYSLED_DISK_WRITE_OPERATION)) {
+				// the LED belongs to the user, but the disk activity is shown
+				if (!disk_shown) {
+					user_rgb = BSP_getNeoPixel();
+					disk_shown = TRUE;
+				}
+				if ((sys_led_status | events) & SYSLED_DISK_WRITE_OPERATION) {
+					rgb = 0x7F0000;		// red
+				} else {
+					rgb = 0x7F7F00;		// yellow
+				}
+				if (rgb != last) {
+					BSP_setNeoPixel(rgb);
+					last = rgb;
+				}
+			} else {
+				// the LED belongs to the user
+				if (disk_shown) {
+					BSP_setNeoPixel(user_rgb);
+					disk_shown = FALSE;
+				}
+				last = 0xFFFFFFFF;
+			}
+			osDelay(SYSLED_PERIOD);
+			// show the status after the events too
+		} while (events != 0);
+	}
+}
+
+
+/**
+ *  @brief
+ *	    Wakes up the SysLED thread.
+ *  @return
+ *      none
+ */
+static void sysled_notify(void) {
+	if (SysLED_ThreadId != NULL) {
+		osThreadFlagsSet(SysLED_ThreadId, SYSLED_UPDATE);
+	}
+}
+
+
+/**
+ *  @brief
+ *	    Sets bits without a lock (LDREX/STREX).
+ *	@param[in]
+ *      adr   address of the word
+ *	@param[in]
+ *      bits  to set
+ *  @return
+ *      none
+ */
+static void atomic_or(volatile uint32_t *adr, uint32_t bits) {
+	uint32_t old;
+
+	do {
+		old = __LDREXW(adr);
+	} while (__STREXW(old | bits, adr));
+}
+
+
+/**
+ *  @brief
+ *	    Exchanges a word without a lock (LDREX/STREX).
+ *	@param[in]
+ *      adr    address of the word
+ *	@param[in]
+ *      value  new value
+ *  @return
+ *      old value
+ */
+static uint32_t atomic_swap(volatile uint32_t *adr, uint32_t value) {
+	uint32_t old;
+
+	do {
+		old = __LDREXW(adr);
+	} while (__STREXW(value, adr));
+	return old;
+}
+
+/**
+ *  @brief
+ *	    Sets the Input Capture polarity.
+ *	@param[in]
+ *      mode  0 rising edge, 1 falling edge, 2 both edges
+ *  @return
+ *      FALSE for an invalid mode
+ */
+static int ic_polarity(uint32_t mode) {
+	switch(mode) {
+	case 0:
+		__HAL_TIM_SET_CAPTUREPOLARITY(&htim2, TIM_CHANNEL_2, TIM_INPUTCHANNELPOLARITY_RISING);
+		break;
+	case 1:
+		__HAL_TIM_SET_CAPTUREPOLARITY(&htim2, TIM_CHANNEL_2, TIM_INPUTCHANNELPOLARITY_FALLING);
+		break;
+	case 2:
+		__HAL_TIM_SET_CAPTUREPOLARITY(&htim2, TIM_CHANNEL_2, TIM_INPUTCHANNELPOLARITY_BOTHEDGE);
+		break;
+	default:
+		return FALSE;
+	}
+	return TRUE;
+}
+
+
+/**
+ *  @brief
+ *	    Timestamps written by the DMA since the start of the stream.
+ *
+ *	    A wrap around not yet counted by the interrupt is recognized by the
+ *	    pending transfer complete flag.
+ *  @return
+ *      number of timestamps
+ */
+static uint32_t ic_written(void) {
+	uint32_t laps, pos;
+
+	BACKUP_PRIMASK();
+	DISABLE_IRQ();
+	pos = IC_STREAM_SIZE - __HAL_DMA_GET_COUNTER(&hdma_tim2_ch2);
+	laps = ic_laps;
+	if (__HAL_DMA_GET_FLAG(&hdma_tim2_ch2, DMA_FLAG_TC5) && pos < IC_STREAM_SIZE / 2) {
+		laps++;
+	}
+	RESTORE_PRIMASK();
+
+	return laps * IC_STREAM_SIZE + pos;
+}
+
+
+/**
+ *  @brief
+ *	    Waits till the NeoPixel chain has given back TIM1.
+ *  @return
+ *      none
+ */
+static void neopixels_wait(void) {
+	osSemaphoreAcquire(NeoPixels_SemaphoreID, osWaitForever);
+	osSemaphoreRelease(NeoPixels_SemaphoreID);
+}
+
+
+/**
+ *  @brief
+ *	    Encodes the next pixels into a half buffer.
+ *
+ *	    Pixel 00rrggbb is sent G R B, MSB first. A compare value 0 keeps
+ *	    the line low (reset at the end of the chain, NEOPIXEL_RESET half
+ *	    buffers).
+ *	@param[in]
+ *      half    0 first half, 1 second half
+ *  @return
+ *      none
+ */
+static void neopixels_fill(int half) {
+	uint16_t *p = &neopixels_buffer[half * NEOPIXEL_CHUNK * NEOPIXEL_BITS];
+	uint32_t grb;
+	int i, bit;
+
+	if (neopixels_count == 0) {
+		neopixels_zeros++;
+	}
+	neopixels_latch[half] = (neopixels_zeros >= NEOPIXEL_RESET);
+	for (i = 0; i < NEOPIXEL_CHUNK; i++) {
+		if (neopixels_count == 0) {
+			for (bit = 0; bit < NEOPIXEL_BITS; bit++) {
+				*p++ = 0;
+			}
+			continue;
+		}
+		grb = *neopixels_pixels++;
+		neopixels_count--;
+		grb = ((grb & 0x00FF00) << 8) | ((grb & 0xFF0000) >> 8) | (grb & 0x0000FF);
+		for (bit = NEOPIXEL_BITS - 1; bit >= 0; bit--) {
+			*p++ = (grb & (1 << bit)) ? NEOPIXEL_T1H : NEOPIXEL_T0H;
+		}
+	}
+}
+
+
+/**
+ *  @brief
+ *	    Gives back TIM1 and D6 after the reset time.
+ *  @return
+ *      none
+ */
+static void neopixels_stop(void) {
+	TIM1->DIER &= ~TIM_DIER_UDE;
+	HAL_DMA_Abort_IT(&hdma_tim1_up);
+
+	TIM1->CR1 &= ~TIM_CR1_CEN;
+	D6_GPIO_Port->MODER = neopixels_moder;
+	D6_GPIO_Port->AFR[POSITION_VAL(D6_Pin) >> 3] = neopixels_afr;
+	TIM1->PSC = neopixels_psc;
+	TIM1->ARR = neopixels_arr;
+	TIM1->CCR1 = neopixels_ccr1;
+	TIM1->CCR2 = neopixels_ccr2;
+	TIM1->CCR3 = neopixels_ccr3;
+	TIM1->EGR = TIM_EGR_UG;
+	TIM1->CR1 |= TIM_CR1_CEN;
+
+	osSemaphoreRelease(NeoPixels_SemaphoreID);
+}
+
+
 // Callbacks
 // *********
 
+/**
+ *  @brief
+ *	    The Input Capture DMA wrapped around the ring.
+ *	@param[in]
+ *      hdma    DMA handle
+ *  @return
+ *      none
+ */
+static void ic_lap(DMA_HandleTypeDef *hdma) {
+	ic_laps++;
+}
+
+
+/**
+ *  @brief
+ *	    The last compare value of the sequence is loaded.
+ *
+ *	    The compare interrupt signals the last match to OCwait.
+ *	@param[in]
+ *      hdma    DMA handle
+ *  @return
+ *      none
+ */
+static void oc_sequence_complete(DMA_HandleTypeDef *hdma) {
+	__HAL_TIM_DISABLE_DMA(&htim2, TIM_DMA_CC1 << (oc_sequence_channel >> 2));
+	__HAL_TIM_CLEAR_IT(&htim2, TIM_IT_CC1 << (oc_sequence_channel >> 2));
+	HAL_TIM_OC_Start_IT(&htim2, oc_sequence_channel);
+	oc_sequence_pin = -1;
+}
+
+
+/**
+ *  @brief
+ *	    First half of the NeoPixel buffer sent.
+ *	@param[in]
+ *      hdma    DMA handle
+ *  @return
+ *      none
+ */
+static void neopixels_half(DMA_HandleTypeDef *hdma) {
+	if (neopixels_latch[0]) {
+		neopixels_stop();
+	} else {
+		neopixels_fill(0);
+	}
+}
+
+
+/**
+ *  @brief
+ *	    Second half of the NeoPixel buffer sent.
+ *	@param[in]
+ *      hdma    DMA handle
+ *  @return
+ *      none
+ */
+static void neopixels_complete(DMA_HandleTypeDef *hdma) {
+	if (neopixels_latch[1]) {
+		neopixels_stop();
+	} else {
+		neopixels_fill(1);
+	}
+}
+
+
 /**
   * @brief  Conversion complete callback in non-blocking mode.
   * @param hadc ADC handle
@@ -1374,31 +1981,35 @@ void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin) {
 	switch (GPIO_Pin) {
 #if BUTTON_MATRIX == 1
 	case GPIO_PIN_0:  // column 0 button
-		osSemaphoreRelease(BUTTON_SemaphoreID);
+		BUTTON_wakeup();
 		break;
 	case GPIO_PIN_1:  // column 1 button
-		osSemaphoreRelease(BUTTON_SemaphoreID);
+		BUTTON_wakeup();
 		break;
 	case GPIO_PIN_2:  // column 2 button
-		osSemaphoreRelease(BUTTON_SemaphoreID);
+		BUTTON_wakeup();
 		break;
 	case GPIO_PIN_3:  // column 3 button
-		osSemaphoreRelease(BUTTON_SemaphoreID);
+		BUTTON_wakeup();
 		break;
 	case GPIO_PIN_5:
-		osSemaphoreRelease(BUTTON_SemaphoreID);
+		BUTTON_wakeup();
 		break;
 #endif
 	case GPIO_PIN_4:  // D10
+		IRQ_dispatch(IRQ_EXTI4);
 		osSemaphoreRelease(EXTI_4_SemaphoreID);
 		break;
 	case GPIO_PIN_6:  // D2
+		IRQ_dispatch(IRQ_EXTI6);
 		osSemaphoreRelease(EXTI_9_5_SemaphoreID);
 		break;
 	case GPIO_PIN_10: // D4
+		IRQ_dispatch(IRQ_EXTI10);
 		osSemaphoreRelease(EXTI_15_10_SemaphoreID);
 		break;
 	case GPIO_PIN_13: // D7
+		IRQ_dispatch(IRQ_EXTI13);
 		// already released with GPIO_PIN_10
 		break;
 
@@ -1422,6 +2033,8 @@ void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin) {
 void BSP_setNeoPixel(uint32_t rgb) {
 	// only one thread is allowed to use the digital port
 	osMutexAcquire(DigitalPort_MutexID, osWaitForever);
+	// the dongle has the NeoPixel on D6 too
+	neopixels_wait();
 
 	// do not disturb, it takes about 1.25 us * 24 = 30 us
 	BACKUP_PRIMASK();
@@ -1458,8 +2071,10 @@ int BSP_getNeoPixel(void) {
 
 /**
  *  @brief
- *	    Sets the NeoPixel RGB LEDs.
+ *	    Sets the NeoPixel RGB LEDs on D6.
  *
+ *	    Returns after the transfer, the buffer can be changed again.
+ *	    See BSP_startNeoPixels().
  *	@param[in]
  *      buffer    array of pixels
  *	@param[in]
@@ -1469,20 +2084,92 @@ int BSP_getNeoPixel(void) {
  *
  */
 void BSP_setNeoPixels(uint32_t *buffer, uint32_t len) {
+	BSP_startNeoPixels(buffer, len);
+	neopixels_wait();
+}
 
-	// only one thread is allowed to use the digital port
-	osMutexAcquire(DigitalPort_MutexID, osWaitForever);
 
-	// do not disturb, it takes about 1.25 us * 24 = 30 us
-	BACKUP_PRIMASK();
-	DISABLE_IRQ();
+/**
+ *  @brief
+ *	    Starts the transfer to the NeoPixel RGB LEDs on D6.
+ *
+ *	    TIM1 CH1 generates the bits by PWM, the DMA feeds the compare values
+ *	    from a double buffer. The DMA interrupt encodes the next pixels into
+ *	    the free half, the interrupts are not disabled. Returns as soon as
+ *	    the transfer is started, the buffer must not be changed till
+ *	    BSP_getNeoPixelsReady() is true. Waits for the previous transfer.
+ *	    During the transfer (30 us per pixel and 480 us reset) D3 and D9
+ *	    (TIM1 CH3, CH2) are low, the PWM is paused.
+ *	@param[in]
+ *      buffer    array of pixels
+ *	@param[in]
+ *      len       array length
+ *  @return
+ *      none
+ *
+ */
+void BSP_startNeoPixels(uint32_t *buffer, uint32_t len) {
+	uint32_t pin = POSITION_VAL(D6_Pin);
 
-	BSP_neopixelBufferTx(D6_GPIO_Port, D6_Pin, buffer, len);
+	if (len == 0) {
+		return;
+	}
 
-	RESTORE_PRIMASK();
+	// only one thread is allowed to use the digital port
+	osMutexAcquire(DigitalPort_MutexID, osWaitForever);
+	osSemaphoreAcquire(NeoPixels_SemaphoreID, osWaitForever);
+
+	neopixels_pixels = buffer;
+	neopixels_count = len;
+	neopixels_zeros = 0;
+	neopixels_fill(0);
+	neopixels_fill(1);
+
+	// borrow TIM1, 800 kHz
+	neopixels_psc = TIM1->PSC;
+	neopixels_arr = TIM1->ARR;
+	neopixels_ccr1 = TIM1->CCR1;
+	neopixels_ccr2 = TIM1->CCR2;
+	neopixels_ccr3 = TIM1->CCR3;
+	TIM1->CR1 &= ~TIM_CR1_CEN;
+	TIM1->PSC = 0;
+	TIM1->ARR = NEOPIXEL_PERIOD - 1;
+	TIM1->CCR1 = 0;
+	// D3 and D9 inactive (low), the compare values (up to 1000) exceed the ARR
+	TIM1->CCR2 = 0;
+	TIM1->CCR3 = 0;
+	TIM1->EGR = TIM_EGR_UG;
+
+	// D6 TIM1CH1 (AF1)
+	neopixels_moder = D6_GPIO_Port->MODER;
+	neopixels_afr = D6_GPIO_Port->AFR[pin >> 3];
+	D6_GPIO_Port->AFR[pin >> 3] = (neopixels_afr & ~(0xFUL << ((pin & 7) * 4)))
+			| (GPIO_AF1_TIM1 << ((pin & 7) * 4));
+	D6_GPIO_Port->MODER = (neopixels_moder & ~(3UL << (pin * 2))) | (2UL << (pin * 2)); // AF
+
+	HAL_DMA_Start_IT(&hdma_tim1_up, (uint32_t)neopixels_buffer, (uint32_t)&TIM1->CCR1,
+			2 * NEOPIXEL_CHUNK * NEOPIXEL_BITS);
+	TIM1->DIER |= TIM_DIER_UDE;
+	TIM1->CR1 |= TIM_CR1_CEN;
 
 	osMutexRelease(DigitalPort_MutexID);
-	osDelay(1);
+}
+
+
+/**
+ *  @brief
+ *	    Is the NeoPixel chain transfer done?
+ *
+ *  @return
+ *      -1 if the buffer can be reused, FALSE during the transfer
+ *
+ */
+int BSP_getNeoPixelsReady(void) {
+	if (osSemaphoreGetCount(NeoPixels_SemaphoreID) != 0) {
+		return -1;
+	} else {
+		return FALSE;
+	}
 }
 
 
@@ -1490,6 +2177,10 @@ void BSP_setNeoPixels(uint32_t *buffer, uint32_t len) {
  *  @brief
  *	    Set the system LED.
  *
+ *	    Does not block, the SysLED thread renders the LED (max. every 50 ms).
+ *	    A status set for a shorter time is shown for one period.
+ *	    Can be called from an ISR.
+ *
  *		SYSLED_ACTIVATE 			= 1 << 0,
  *		SYSLED_DISK_READ_OPERATION 	= 1 << 1, yellow
  *		SYSLED_DISK_WRITE_OPERATION = 1 << 2, red
@@ -1503,8 +2194,9 @@ void BSP_setNeoPixels(uint32_t *buffer, uint32_t len) {
  *
  */
 void BSP_setSysLED(BSP_sysled_t status) {
-	sys_led_status |= status;
-	update_sysled();
+	atomic_or(&sys_led_status, status);
+	atomic_or(&sys_led_events, status);
+	sysled_notify();
 }
 
 /**
@@ -1524,37 +2216,67 @@ void BSP_setSysLED(BSP_sysled_t status) {
  *
  */
 void BSP_clearSysLED(BSP_sysled_t status) {
-	sys_led_status &= ~status;
-	update_sysled();
+	uint32_t old;
+
+	do {
+		old = __LDREXW(&sys_led_status);
+	} while (__STREXW(old & ~status, &sys_led_status));
+	sysled_notify();
+}
+
+
+/**
+ *  @brief
+ *	    Flash the system LED for one period, e.g. for an I/O error.
+ *
+ *	    Does not block, can be called from an ISR.
+ *	@param[in]
+ *      status  event
+ *  @return
+ *      none
+ *
+ */
+void BSP_flashSysLED(BSP_sysled_t status) {
+	atomic_or(&sys_led_events, status);
+	sysled_notify();
 }
 
-static void update_sysled(void) {
+
+/**
+ *  @brief
+ *	    Color of the system LED.
+ *	@param[in]
+ *      status  SYSLED_ flags
+ *  @return
+ *      rgb
+ */
+static uint32_t sysled_color(uint32_t status) {
 	uint32_t rgb = 0;
-	if (sys_led_status & SYSLED_ACTIVATE) {
-		if (sys_led_status & SYSLED_DISK_READ_OPERATION) {
+	if (status & SYSLED_ACTIVATE) {
+		if (status & SYSLED_DISK_READ_OPERATION) {
 			// bright green
 			rgb = 0x00FF00;
-		} else if (sys_led_status & SYSLED_DISK_WRITE_OPERATION) {
+		} else if (status & SYSLED_DISK_WRITE_OPERATION) {
 			// bright yellow
 			rgb = 0xFFFF00;
-		} else if (sys_led_status & SYSLED_CHARGING) {
+		} else if (status & SYSLED_CHARGING) {
 			// red
 			rgb = 0x200000;
-		} else if (sys_led_status & SYSLED_FULLY_CHARGED) {
+		} else if (status & SYSLED_FULLY_CHARGED) {
 			// green
 			rgb = 0x002000;
-		} else if (sys_led_status & SYSLED_POWER_ON) {
+		} else if (status & SYSLED_POWER_ON) {
 			// white
 			rgb = 0x404040;
-		} else if (sys_led_status & SYSLED_ERROR) {
+		} else if (status & SYSLED_ERROR) {
 			// red
 			rgb = 0x400000;
 		}
-		if (sys_led_status & SYSLED_BLE_CONNECTED) {
+		if (status & SYSLED_BLE_CONNECTED) {
 			// add some blue
 			rgb |= 0x000020;
 		}
-		BSP_setNeoPixel(rgb);
 	}
+	return rgb;
 }
 
@@ -81,15 +81,23 @@ void BSP_stopIC(void);
 void BSP_waitPeriod(void);
 uint32_t BSP_waitIC(uint32_t timeout);
 void BSP_waitOC(int pin_number);
+void BSP_startSequenceOC(int pin_number, uint32_t *table, uint32_t len);
+void BSP_startStreamIC(uint32_t mode);
+void BSP_stopStreamIC(void);
+uint32_t BSP_getStreamIC(void);
+uint32_t BSP_readStreamIC(uint32_t *buffer, uint32_t len);
+uint32_t BSP_getLostStreamIC(void);
 
 void BSP_neopixelDataTx(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin, uint32_t GRBx);
-void BSP_neopixelBufferTx(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin, uint32_t *buffer, uint32_t len);
 void BSP_setNeoPixel(uint32_t rgb);
 int BSP_getNeoPixel(void);
 void BSP_setNeoPixels(uint32_t *buffer, uint32_t len);
+void BSP_startNeoPixels(uint32_t *buffer, uint32_t len);
+int BSP_getNeoPixelsReady(void);
 
 void BSP_setSysLED(BSP_sysled_t status);
 void BSP_clearSysLED(BSP_sysled_t status);
+void BSP_flashSysLED(BSP_sysled_t status);
 
 
 #endif /* INC_BSP_H_ */
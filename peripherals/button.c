@@ -13,6 +13,17 @@
  *      Columns are input ports with pull up resistors and interrupts,
  *      rows are open drain output ports.
  *
+ *      Scanning
+ *      The buttons are sampled in the LPTIM1 ISR (LSE clock, runs also in
+ *      stop mode), the matrix one row per 1 ms, the simple buttons every
+ *      5 ms while a button is active, otherwise every 20 ms. No delays in
+ *      the thread. An integrator debounces each button,
+ *      press, release, and auto-repeat events with a time stamp go into a
+ *      lock-free FIFO (single producer ISR, single consumer thread). The
+ *      thread consumes all pending events at once.
+ *      The matrix is only scanned after a column interrupt till all buttons
+ *      are released.
+ *
  *          C0       C1       C2       C3       C4
  *      +--------+--------+--------+--------+--------+
  *      | Pi     | 1/x    | x^2    | LOG    | LN     |
@@ -96,6 +107,33 @@
 
 #if BUTTON == 1
 
+#define BUTTON_EVENT_COUNT	32			// FIFO, power of 2
+#define BUTTON_REPEAT_DELAY	500			// ms till the first repetition
+#define BUTTON_REPEAT_RATE	100			// ms between repetitions
+
+#define BUTTON_EVENT		0x01		// thread flag, new events in the FIFO
+#define BUTTON_WAKEUP		0x02		// thread flag, start the matrix scan
+
+typedef enum {
+	BUTTON_PRESS,
+	BUTTON_RELEASE,
+	BUTTON_REPEAT
+} event_t;
+
+typedef struct {
+	uint8_t		button;
+	uint8_t		type;		// event_t
+	uint32_t	time;		// ticks (ms)
+} BUTTON_Event_t;
+
+// scanner, common for the matrix and simple buttons
+static void scan_start(void);
+static void scan_stop(void);
+static int sample(uint32_t now);
+static int debounce(int button, int active, uint32_t now);
+static void put_event(int button, event_t type, uint32_t time);
+static int get_event(BUTTON_Event_t *event);
+
 #if BUTTON_MATRIX == 1
 
 
@@ -108,7 +146,8 @@
 #define BUTTON_PRESSED		GPIO_PIN_RESET
 #define BUTTON_RELEASED		GPIO_PIN_SET
 
-#define DEBOUNCE_TIME		20							// 20 ms
+#define BUTTON_SCAN_PERIOD	(33-1)		// LSE cycles, about 1 ms per row
+#define BUTTON_INTEGRATOR	3			// samples, 7 ms apart -> about 20 ms
 
 #define BUTTON_COLUMN_COUNT	5
 #define BUTTON_ROW_COUNT	7
@@ -137,6 +176,7 @@ enum float_format {FIX, ENG, SCI} ;
 // ***************************
 static void BUTTON_Thread(void *argument);
 static void put_key_string(uint8_t c);
+static void column_interrupts(int enable);
 
 // Global Variables
 // ****************
@@ -382,7 +422,10 @@ static const char* keyboard_int_f[BUTTON_COUNT] = {
 		"", 				// r6, c4
 };
 
-uint8_t button_state[BUTTON_COUNT];
+static int scan_row;
+static int scan_active;
+static volatile int scanning = FALSE;
+static int scan_allowed = TRUE;
 
 // Public Functions
 // ****************
@@ -425,6 +468,13 @@ void BUTTON_init(void) {
 		Error_Handler();
 	}
 
+	// LPTIM1 for the scanner, LSE
+	__HAL_RCC_LPTIM1_CONFIG(RCC_LPTIM1CLKSOURCE_LSE);
+	__HAL_RCC_LPTIM1_CLK_ENABLE();
+	LPTIM1->IER = LPTIM_IER_ARRMIE;		// only if disabled
+	HAL_NVIC_SetPriority(LPTIM1_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(LPTIM1_IRQn);
+
 	// Create the queue(s)
 	// creation of  buttonQueue
 	BUTTON_QueueId = osMessageQueueNew(BUTTON_BUFFER_LENGTH, sizeof(uint8_t),
@@ -515,11 +565,32 @@ int BUTTON_putkey(const char c) {
 }
 
 
-/**	uint8_t startup = TRUE;
+/**
+ *  @brief
+ *      Column interrupt, a button is pressed.
  *
+ *      Called from the EXTI ISR. Starts the scan (in the thread) and wakes
+ *      up BUTTON_OnOff().
+ *  @return
+ *      None
+ */
+void BUTTON_wakeup(void) {
+	osSemaphoreRelease(BUTTON_SemaphoreID);
+	if (scan_allowed && !scanning) {
+		// the scan toggles the rows -> no column interrupts
+		column_interrupts(FALSE);
+		osThreadFlagsSet(BUTTON_ThreadId, BUTTON_WAKEUP);
+	}
+}
+
+
+/**
  *  @brief
  *      Go into stop mode till on-button is pressed
- *#endif
+ *
+ *      Only the column 0 interrupt (ON button) is enabled while off.
+ *      Manual check: press OFF while an other button is held down (the
+ *      scan is running), release both, then C ON has to switch on again.
  *  @return
  *      None
  */
@@ -529,6 +600,12 @@ void BUTTON_OnOff(void) {
 	OLED_off();
 
 	osMutexAcquire(BUTTON_MutexID, 100);
+	scan_allowed = FALSE;
+	if (scanning) {
+		HAL_NVIC_DisableIRQ(LPTIM1_IRQn);
+		scan_stop();
+		HAL_NVIC_EnableIRQ(LPTIM1_IRQn);
+	}
 //	HAL_NVIC_DisableIRQ(COL0_IRQ);
 	HAL_NVIC_DisableIRQ(COL1_IRQ);
 	HAL_NVIC_DisableIRQ(COL2_IRQ);
@@ -548,6 +625,11 @@ void BUTTON_OnOff(void) {
 	}
 	osDelay(10);
 
+	// the scan disables all column interrupts, the ON button has to wake up
+	__HAL_GPIO_EXTI_CLEAR_IT(PortPinColumn_a[0].pin);
+	HAL_NVIC_ClearPendingIRQ(COL0_IRQ);
+	HAL_NVIC_EnableIRQ(COL0_IRQ);
+
 	// wait for button event
 	if (osSemaphoreGetCount(BUTTON_SemaphoreID)) {
 		osSemaphoreAcquire(BUTTON_SemaphoreID, osWaitForever);
@@ -572,6 +654,7 @@ void BUTTON_OnOff(void) {
 	HAL_NVIC_EnableIRQ(COL3_IRQ);
 	HAL_NVIC_EnableIRQ(COL4_IRQ);
 
+	scan_allowed = TRUE;
 	osMutexRelease(BUTTON_MutexID);
 
 }
@@ -589,13 +672,9 @@ void BUTTON_OnOff(void) {
   * 	NoneBUTTON_FLOAT
   */
 static void BUTTON_Thread(void *argument) {
-	int button;
-	int column, row;
-	uint8_t new_state;
-
-	for (button=0; button < BUTTON_COUNT; button++) {
-		button_state[button] = BUTTON_RELEASED;
-	}
+	int row;
+	uint32_t flags;
+	BUTTON_Event_t event;
 
 	// activate all rows
 	osMutexAcquire(BUTTON_MutexID, osWaitForever);
@@ -606,50 +685,137 @@ static void BUTTON_Thread(void *argument) {
 
 	// Infinite loop
 	for(;;) {
-
-		// wait for button event
-		osSemaphoreAcquire(BUTTON_SemaphoreID, osWaitForever);
-		osDelay(10);	// wait for debouncing
+		// wait for button events or a column interrupt
+		flags = osThreadFlagsWait(BUTTON_EVENT | BUTTON_WAKEUP, osFlagsWaitAny, osWaitForever);
 
 		osMutexAcquire(BUTTON_MutexID, osWaitForever);
 
-		// deactivate all rows
-		for (row=0; row<BUTTON_ROW_COUNT; row++) {
-			HAL_GPIO_WritePin(PortPinRow_a[row].port, PortPinRow_a[row].pin, GPIO_PIN_SET);
+		if ((flags & BUTTON_WAKEUP) && scan_allowed && !scanning) {
+			scan_start();
 		}
 
-		button = 0;
-		for (row=0; row < BUTTON_ROW_COUNT; row++) {
-			// set a row
-			HAL_GPIO_WritePin(PortPinRow_a[row].port, PortPinRow_a[row].pin, GPIO_PIN_RESET);
-			osDelay(1);
-			for (column=0; column < BUTTON_COLUMN_COUNT; column++) {
-				// read column
-				new_state = HAL_GPIO_ReadPin(PortPinColumn_a[column].port,  PortPinColumn_a[column].pin);
-				if (new_state != button_state[button]) {
-					// button state has been changed
-					if (new_state == BUTTON_PRESSED) {
-						put_key_string(button);
-					}
-					button_state[button] = new_state;
-				}
-				button++;
+		// all pending events
+		while (get_event(&event)) {
+			if (event.type == BUTTON_PRESS) {
+				put_key_string(event.button);
+			} else if (event.type == BUTTON_REPEAT && strlen(keyboard[event.button]) == 1) {
+				// repeat only single characters like digits and BS
+				put_key_string(event.button);
 			}
-
-			HAL_GPIO_WritePin(PortPinRow_a[row].port, PortPinRow_a[row].pin, GPIO_PIN_SET);
 		}
 
-		// activate all rows
-		for (row=0; row<BUTTON_ROW_COUNT; row++) {
-			HAL_GPIO_WritePin(PortPinRow_a[row].port, PortPinRow_a[row].pin, GPIO_PIN_RESET);
-		}
-		osDelay(1);
+		osMutexRelease(BUTTON_MutexID);
+	}
+}
+
 
-		if (osSemaphoreGetCount(BUTTON_SemaphoreID)) {
-			osSemaphoreAcquire(BUTTON_SemaphoreID, osWaitForever);
+/**
+  * @brief
+  * 	Samples the columns of the active row, activates the next row.
+  *
+  * 	Called from the LPTIM1 ISR every 1 ms, the row has 1 ms to settle.
+  * @param[in]
+  * 	now  tick count
+  * @retval
+  * 	FALSE if all buttons were released for a whole scan
+  */
+static int sample(uint32_t now) {
+	int column;
+	int button;
+	int active = TRUE;
+
+	button = scan_row * BUTTON_COLUMN_COUNT;
+	for (column=0; column < BUTTON_COLUMN_COUNT; column++) {
+		if (debounce(button + column,
+				HAL_GPIO_ReadPin(PortPinColumn_a[column].port,
+						PortPinColumn_a[column].pin) == BUTTON_PRESSED, now)) {
+			scan_active = TRUE;
 		}
-		osMutexRelease(BUTTON_MutexID);
+	}
+
+	HAL_GPIO_WritePin(PortPinRow_a[scan_row].port, PortPinRow_a[scan_row].pin, GPIO_PIN_SET);
+	if (++scan_row >= BUTTON_ROW_COUNT) {
+		// whole matrix scanned
+		scan_row = 0;
+		active = scan_active;
+		scan_active = FALSE;
+	}
+	HAL_GPIO_WritePin(PortPinRow_a[scan_row].port, PortPinRow_a[scan_row].pin, GPIO_PIN_RESET);
+
+	if (! active) {
+		scan_stop();
+	}
+	return active;
+}
+
+
+/**
+  * @brief
+  * 	Starts the scan with the first row.
+  * @retval
+  * 	None
+  */
+static void scan_start(void) {
+	int row;
+
+	for (row=1; row<BUTTON_ROW_COUNT; row++) {
+		HAL_GPIO_WritePin(PortPinRow_a[row].port, PortPinRow_a[row].pin, GPIO_PIN_SET);
+	}
+	HAL_GPIO_WritePin(PortPinRow_a[0].port, PortPinRow_a[0].pin, GPIO_PIN_RESET);
+	scan_row = 0;
+	scan_active = FALSE;
+	scanning = TRUE;
+
+	// ARR can only be written if enabled, the LPTIM needs 2 LSE cycles
+	LPTIM1->CR = LPTIM_CR_ENABLE;
+	LPTIM1->ARR = BUTTON_SCAN_PERIOD;
+	while (! (LPTIM1->ISR & LPTIM_ISR_ARROK)) {
+		;
+	}
+	LPTIM1->ICR = LPTIM_ICR_ARROKCF;
+	LPTIM1->CR = LPTIM_CR_ENABLE | LPTIM_CR_CNTSTRT;
+}
+
+
+/**
+  * @brief
+  * 	Stops the scan, activates all rows and the column interrupts.
+  * @retval
+  * 	None
+  */
+static void scan_stop(void) {
+	int row;
 
+	LPTIM1->CR = 0;
+	scanning = FALSE;
+	for (row=0; row<BUTTON_ROW_COUNT; row++) {
+		HAL_GPIO_WritePin(PortPinRow_a[row].port, PortPinRow_a[row].pin, GPIO_PIN_RESET);
+	}
+	if (scan_allowed) {
+		column_interrupts(TRUE);
+	}
+}
+
+
+/**
+  * @brief
+  * 	Enables or disables the column interrupts.
+  * @param[in]
+  * 	enable  FALSE disable, TRUE clear pending and enable
+  * @retval
+  * 	None
+  */
+static void column_interrupts(int enable) {
+	int column;
+
+	for (column=0; column < BUTTON_COLUMN_COUNT; column++) {
+		if (enable) {
+			__HAL_GPIO_EXTI_CLEAR_IT(PortPinColumn_a[column].pin);
+			HAL_NVIC_ClearPendingIRQ(PortPinColumn_a[column].irq);
+			HAL_NVIC_EnableIRQ(PortPinColumn_a[column].irq);
+		} else {
+			HAL_NVIC_DisableIRQ(PortPinColumn_a[column].irq);
+		}
 	}
 }
 
@@ -750,7 +916,9 @@ static void put_key_string(uint8_t c) {
 #define BUTTON_PRESSED		GPIO_PIN_RESET
 #define BUTTON_RELEASED		GPIO_PIN_SET
 
-#define DEBOUNCE_TIME		20							// 20 ms
+#define BUTTON_SCAN_PERIOD	(164-1)		// LSE cycles, about 5 ms
+#define BUTTON_IDLE_PERIOD	(656-1)		// LSE cycles, about 20 ms
+#define BUTTON_INTEGRATOR	4			// samples, 5 ms apart -> 20 ms
 
 // Private function prototypes
 // ***************************
@@ -829,7 +997,8 @@ static const osMessageQueueAttr_t button_Queue_attributes = {
 
 // Private Variables
 // *****************
-static uint8_t button_state[BUTTON_COUNT];
+static int scan_fast = FALSE;
+
 
 // Public Functions
 // ****************
@@ -857,6 +1026,13 @@ void BUTTON_init(void) {
 			&button_Queue_attributes);
 	ASSERT_fatal(BUTTON_QueueId != NULL, ASSERT_QUEUE_CREATION, __get_PC());
 
+	// LPTIM1 for the scanner, LSE
+	__HAL_RCC_LPTIM1_CONFIG(RCC_LPTIM1CLKSOURCE_LSE);
+	__HAL_RCC_LPTIM1_CLK_ENABLE();
+	LPTIM1->IER = LPTIM_IER_ARRMIE;		// only if disabled
+	HAL_NVIC_SetPriority(LPTIM1_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(LPTIM1_IRQn);
+
 	// creation of BUTTON_Thread
 	BUTTON_ThreadId = osThreadNew(BUTTON_Thread, NULL, &BUTTON_ThreadAttr);
 	ASSERT_fatal(BUTTON_ThreadId != NULL, ASSERT_THREAD_CREATION, __get_PC());
@@ -987,40 +1163,216 @@ void BUTTON_OnOff(void) {
   */
 static void BUTTON_Thread(void *argument) {
 	osStatus_t status;
-	int button;
-	int new_state;
+	BUTTON_Event_t event;
 	char c;
 
-	for (button=0; button < BUTTON_COUNT; button++) {
-		button_state[button] = BUTTON_RELEASED;
-	}
+	scan_start();
 
 	// Infinite loop
 	for(;;) {
-		osDelay(DEBOUNCE_TIME);
-
-		for (button=0; button < BUTTON_COUNT; button++) {
-			new_state = HAL_GPIO_ReadPin(PortPin_a[button].port,  PortPin_a[button].pin);
-			if (button_state[button] != new_state) {
-				// state has changed
-				if (new_state == BUTTON_PRESSED) {
-					// button pressed
-					c = char_a[button];
-					status = osMessageQueuePut(BUTTON_QueueId, &c, 0, 100);
-					if (status != osOK) {
-						// can't put char into queue -> flush the queue
-						BUTTON_reset();
-					}
-				} else {
-					// button released
-				}
-				button_state[button] = new_state;
+		osThreadFlagsWait(BUTTON_EVENT, osFlagsWaitAny, osWaitForever);
+
+		// all pending events
+		while (get_event(&event)) {
+			if (event.type == BUTTON_RELEASE) {
+				continue;
 			}
+			// button pressed or repeated
+			c = char_a[event.button];
+			status = osMessageQueuePut(BUTTON_QueueId, &c, 0, 100);
+			if (status != osOK) {
+				// can't put char into queue -> flush the queue
+				BUTTON_reset();
+			}
+		}
+	}
+}
+
 
+/**
+  * @brief
+  * 	Samples all buttons.
+  *
+  * 	Called from the LPTIM1 ISR every 5 ms while a button is pressed or
+  * 	bouncing, otherwise every 20 ms. D3 and D4 share the EXTI line 10, the
+  * 	buttons can not wake up by interrupts, the scan goes on slowly.
+  * @param[in]
+  * 	now  tick count
+  * @retval
+  * 	TRUE, the simple buttons are scanned all the time
+  */
+static int sample(uint32_t now) {
+	int button;
+	int active = FALSE;
+
+	for (button=0; button < BUTTON_COUNT; button++) {
+		if (debounce(button, HAL_GPIO_ReadPin(PortPin_a[button].port,
+				PortPin_a[button].pin) == BUTTON_PRESSED, now)) {
+			active = TRUE;
 		}
 	}
+
+	if (active != scan_fast) {
+		// the last ARR write is done (ARROK), it was min. 5 ms ago
+		scan_fast = active;
+		LPTIM1->ICR = LPTIM_ICR_ARROKCF;
+		LPTIM1->ARR = active ? BUTTON_SCAN_PERIOD : BUTTON_IDLE_PERIOD;
+	}
+	return TRUE;
 }
 
-#endif
-#endif
+
+/**
+  * @brief
+  * 	Starts the scan.
+  * @retval
+  * 	None
+  */
+static void scan_start(void) {
+	// ARR can only be written if enabled, the LPTIM needs 2 LSE cycles
+	LPTIM1->CR = LPTIM_CR_ENABLE;
+	LPTIM1->ARR = BUTTON_IDLE_PERIOD;
+	while (! (LPTIM1->ISR & LPTIM_ISR_ARROK)) {
+		;
+	}
+	LPTIM1->ICR = LPTIM_ICR_ARROKCF;
+	scan_fast = FALSE;
+	LPTIM1->CR = LPTIM_CR_ENABLE | LPTIM_CR_CNTSTRT;
+}
+
+
+/**
+  * @brief
+  * 	Stops the scan.
+  * @retval
+  * 	None
+  */
+static void scan_stop(void) {
+	LPTIM1->CR = 0;
+}
+
+#endif // BUTTON_MATRIX
+
+
+// Scanner, common for the matrix and simple buttons
+// *************************************************
+
+static BUTTON_Event_t events[BUTTON_EVENT_COUNT];
+static volatile uint32_t event_head;	// written by the ISR only
+static volatile uint32_t event_tail;	// written by the thread only
+
+static uint8_t integrator[BUTTON_COUNT];
+static uint8_t pressed[BUTTON_COUNT];
+static uint32_t repeat_time[BUTTON_COUNT];
+
+
+/**
+  * @brief
+  * 	LPTIM1 ISR, samples the buttons.
+  * @retval
+  * 	None
+  */
+void BUTTON_LPTIM1_IRQHandler(void) {
+	uint32_t head;
+
+	LPTIM1->ICR = LPTIM_ICR_ARRMCF;
+
+	head = event_head;
+	sample(osKernelGetTickCount());
+	if (event_head != head) {
+		osThreadFlagsSet(BUTTON_ThreadId, BUTTON_EVENT);
+	}
+}
+
+
+/**
+  * @brief
+  * 	Integrator debouncer, generates the events.
+  *
+  * 	The integrator counts up while the button is active, down while
+  * 	inactive. Pressed at BUTTON_INTEGRATOR, released at 0.
+  * @param[in]
+  * 	button  button number
+  * @param[in]
+  * 	active  TRUE if the contact is closed
+  * @param[in]
+  * 	now     tick count
+  * @retval
+  * 	TRUE if the button is pressed or bouncing
+  */
+static int debounce(int button, int active, uint32_t now) {
+	if (active) {
+		if (integrator[button] < BUTTON_INTEGRATOR) {
+			integrator[button]++;
+		}
+	} else if (integrator[button] > 0) {
+		integrator[button]--;
+	}
+
+	if (pressed[button]) {
+		if (integrator[button] == 0) {
+			pressed[button] = FALSE;
+			put_event(button, BUTTON_RELEASE, now);
+		} else if ((int32_t)(now - repeat_time[button]) >= 0) {
+			put_event(button, BUTTON_REPEAT, now);
+			repeat_time[button] += BUTTON_REPEAT_RATE;
+		}
+	} else if (integrator[button] == BUTTON_INTEGRATOR) {
+		pressed[button] = TRUE;
+		put_event(button, BUTTON_PRESS, now);
+		repeat_time[button] = now + BUTTON_REPEAT_DELAY;
+	}
+
+	return pressed[button] || integrator[button];
+}
+
+
+/**
+  * @brief
+  * 	Puts an event into the FIFO (ISR).
+  * @param[in]
+  * 	button  button number
+  * @param[in]
+  * 	type    press, release, or repeat
+  * @param[in]
+  * 	time    tick count
+  * @retval
+  * 	None
+  */
+static void put_event(int button, event_t type, uint32_t time) {
+	BUTTON_Event_t *event;
+
+	if (event_head - event_tail >= BUTTON_EVENT_COUNT) {
+		// FIFO full, event lost
+		return;
+	}
+	event = &events[event_head % BUTTON_EVENT_COUNT];
+	event->button = button;
+	event->type = type;
+	event->time = time;
+	__DMB();
+	event_head++;
+}
+
+
+/**
+  * @brief
+  * 	Gets an event from the FIFO (thread).
+  * @param[out]
+  * 	event  the oldest event
+  * @retval
+  * 	FALSE if the FIFO is empty
+  */
+static int get_event(BUTTON_Event_t *event) {
+	if (event_tail == event_head) {
+		return FALSE;
+	}
+	__DMB();
+	*event = events[event_tail % BUTTON_EVENT_COUNT];
+	__DMB();
+	event_tail++;
+	return TRUE;
+}
+
+#endif // BUTTON
 
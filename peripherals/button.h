@@ -48,11 +48,14 @@ int BUTTON_getc(void);
 int BUTTON_Ready(void);
 int BUTTON_putkey(const char c);
 void BUTTON_OnOff(void);
+void BUTTON_LPTIM1_IRQHandler(void);
 
 #if BUTTON == 1
 #if BUTTON_MATRIX == 1
 extern osSemaphoreId_t BUTTON_SemaphoreID;
 
+void BUTTON_wakeup(void);
+
 #define COL0_Pin 		A0_Pin
 #define COL0_GPIO_Port 	A0_GPIO_Port
 #define COL1_Pin 		A1_Pin
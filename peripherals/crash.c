@@ -0,0 +1,585 @@
+/**
+ *  @brief
+ *      Crash dump.
+ *
+ *      The fault handlers (hard, memory management, bus and usage fault),
+ *      the stack overflow hook and the watchdog supervisor save a crash
+ *      dump into a ring in the no-init RAM (section .noinit), which is not
+ *      cleared by the startup code and survives the reset:
+ *      - registers r0 .. r12, sp, lr, pc, xPSR and the fault status
+ *        registers
+ *      - top of the Forth data stack (TOS is r6, psp is r7) and return
+ *        stack (the task stack)
+ *      - name of the running task
+ *      - the latest records of the log ring as trace
+ *
+ *      After the restart the CRASH thread appends the new dumps to
+ *      CRASH_FILE on the flash drive. .crashlog prints the dumps in RAM.
+ *  @file
+ *      crash.c
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-18
+ *  @remark
+ *      Language: C, STM32CubeIDE GCC
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ *
+ *      Mecrsip-Cube is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with Mecrsip-Cube. If not, see http://www.gnu.org/licenses/.
+ */
+
+// System include files
+// ********************
+#include "cmsis_os.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <stdio.h>
+#include <string.h>
+
+// Application include files
+// *************************
+#include "app_common.h"
+#include "main.h"
+#include "ff.h"
+#include "fs.h"
+#include "myassert.h"
+#include "log.h"
+#include "crash.h"
+
+#define CRASH_PERSIST		0x01			// thread flag
+#define CRASH_LINE_LENGTH	128
+#define CRASH_RAM_START		0x20000000
+#define CRASH_RAM_END		0x20030000
+#define CRASH_FLASH_START	0x08000000		// C image with the format strings
+#define CRASH_FLASH_END		0x08040000
+#define CRASH_FRAME_BASIC	8				// words in the exception stack frame
+#define CRASH_FRAME_FPU		26				// words with FPU context
+
+/** Dump ring in the no-init RAM */
+typedef struct {
+	uint32_t		magic;
+	/** crashes since the ring was initialized */
+	uint32_t		seq;
+	CRASH_Dump_t	dump[CRASH_DUMPS];
+} CRASH_Ring_t;
+
+// Private function prototypes
+// ***************************
+static void CRASH_Thread(void *argument);
+static CRASH_Dump_t* new_dump(uint32_t id);
+static void save_context(CRASH_Dump_t *dump, TaskHandle_t task);
+static void save_frame(CRASH_Dump_t *dump, uint32_t *frame,
+		uint32_t exc_return, uint32_t *r4_r11);
+static int in_ram(uint32_t adr, uint32_t size);
+static uint32_t checksum(CRASH_Dump_t *dump);
+static int valid_dump(CRASH_Dump_t *dump);
+static int format_line(CRASH_Dump_t *dump, int line, char *str, int size);
+static void write_file(void);
+
+// Global Variables
+// ****************
+
+// Hardware resources
+// ******************
+
+// RTOS resources
+// **************
+
+// Definitions for CRASH thread
+static osThreadId_t CRASH_ThreadId = NULL;
+static const osThreadAttr_t CRASH_ThreadAttr = {
+		.name = "CRASH",
+		.priority = (osPriority_t) osPriorityLow,
+		.stack_size = 128 * 8
+};
+
+
+// Private Variables
+// *****************
+static CRASH_Ring_t crash_ring __attribute__((section(".noinit")));
+
+
+// Public Functions
+// ****************
+
+/**
+ *  @brief
+ *      Initializes the crash dump ring.
+ *
+ *      Validates the dumps in the no-init RAM (garbage after power on) and
+ *      starts the CRASH thread if there are dumps not yet written to the
+ *      flash drive.
+ *  @return
+ *      None
+ */
+void CRASH_init(void) {
+	int i;
+	int unsaved = FALSE;
+
+	if (crash_ring.magic != CRASH_MAGIC) {
+		// power on
+		memset(&crash_ring, 0, sizeof(crash_ring));
+		crash_ring.magic = CRASH_MAGIC;
+		return;
+	}
+	for (i = 0; i < CRASH_DUMPS; i++) {
+		if (crash_ring.dump[i].magic != CRASH_MAGIC) {
+			continue;
+		}
+		if (crash_ring.dump[i].checksum != checksum(&crash_ring.dump[i])) {
+			crash_ring.dump[i].magic = 0;
+			continue;
+		}
+		if (!crash_ring.dump[i].saved) {
+			unsaved = TRUE;
+		}
+	}
+
+	if (unsaved) {
+		// creation of CRASH_Thread
+		CRASH_ThreadId = osThreadNew(CRASH_Thread, NULL, &CRASH_ThreadAttr);
+		ASSERT_fatal(CRASH_ThreadId != NULL, ASSERT_THREAD_CREATION, __get_PC());
+	}
+}
+
+
+/**
+ *  @brief
+ *      The flash drive is ready, the CRASH thread can write the new dumps.
+ *  @return
+ *      None
+ */
+void CRASH_persist(void) {
+	if (CRASH_ThreadId != NULL) {
+		osThreadFlagsSet(CRASH_ThreadId, CRASH_PERSIST);
+	}
+}
+
+
+/**
+ *  @brief
+ *      Saves a crash dump, used in the stack overflow hook and the watchdog.
+ *
+ *      The context of a blocked task is on its stack, as it is for the
+ *      running task in the PendSV handler (stack overflow hook). For the
+ *      running task in thread mode lr is the caller of CRASH_save().
+ *  @param[in]
+ *      id    assert id e.g. ASSERT_STACK_OVERFLOW
+ *  @param[in]
+ *      task  task handle of a blocked task, NULL for the running task
+ *  @return
+ *      pc of the task
+ */
+uint32_t CRASH_save(uint32_t id, void *task) {
+	CRASH_Dump_t *dump;
+
+	dump = new_dump(id);
+	if (task != NULL && task != xTaskGetCurrentTaskHandle()) {
+		memset(dump->task, 0, CRASH_TASK_NAME);
+		strncpy(dump->task, pcTaskGetName(task), CRASH_TASK_NAME - 1);
+		save_context(dump, task);
+	} else if (__get_IPSR() == PendSV_IRQn + 16
+			&& xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED) {
+		save_context(dump, xTaskGetCurrentTaskHandle());
+	} else {
+		dump->lr = (uint32_t) __builtin_return_address(0);
+	}
+	LOG2("crash %u pc %x", id, dump->pc);
+	dump->trace_cnt = LOG_getRecent(dump->trace, CRASH_TRACE);
+	dump->checksum = checksum(dump);
+	return dump->pc;
+}
+
+
+/**
+ *  @brief
+ *      Saves a crash dump and resets, called by CRASH_faultEntry().
+ *  @param[in]
+ *      id          assert id e.g. ASSERT_HARD_FAULT
+ *  @param[in]
+ *      frame       exception stack frame
+ *  @param[in]
+ *      exc_return  EXC_RETURN (lr at exception entry)
+ *  @param[in]
+ *      r4_r11      registers r4 .. r11 at exception entry
+ *  @return
+ *      None
+ */
+void CRASH_fault(uint32_t id, uint32_t *frame, uint32_t exc_return, uint32_t *r4_r11) {
+	CRASH_Dump_t *dump;
+
+	dump = new_dump(id);
+	save_frame(dump, frame, exc_return, r4_r11);
+	LOG3("fault %u pc %x cfsr %x", id, dump->pc, dump->cfsr);
+	dump->trace_cnt = LOG_getRecent(dump->trace, CRASH_TRACE);
+	dump->checksum = checksum(dump);
+
+	if (id == ASSERT_HARD_FAULT) {
+		// christmas tree
+		HAL_GPIO_WritePin(LD3_GPIO_Port, LD1_Pin, GPIO_PIN_SET);
+		HAL_GPIO_WritePin(LD3_GPIO_Port, LD2_Pin, GPIO_PIN_SET);
+		HAL_GPIO_WritePin(LD3_GPIO_Port, LD3_Pin, GPIO_PIN_SET);
+	}
+
+	ASSERT_fatal(0, id, dump->cfsr);
+	while (1) {
+	}
+}
+
+
+/**
+ *  @brief
+ *      Fault handler entry, pushes r4 .. r11 and calls CRASH_fault().
+ *
+ *      r0 id, r1 exception stack frame, r2 EXC_RETURN (see CRASH_FAULT).
+ *  @return
+ *      None
+ */
+__attribute__((naked)) void CRASH_faultEntry(void) {
+	__asm volatile (
+		" push {r4-r11}                 \n"
+		" mov r3, sp                    \n"
+		" b CRASH_fault                 \n"
+	);
+}
+
+
+/**
+ *  @brief
+ *      Prints the crash dumps in the no-init RAM, the oldest first.
+ *  @param[in]
+ *      forth_stack   TOS (lower word) and SPS (higher word)
+ *  @return
+ *      TOS (lower word) and SPS (higher word)
+ */
+uint64_t CRASH_print(uint64_t forth_stack) {
+	uint64_t stack;
+	char line[CRASH_LINE_LENGTH];
+	CRASH_Dump_t *dump;
+	int i, n;
+
+	stack = forth_stack;
+	for (i = 0; i < CRASH_DUMPS; i++) {
+		dump = &crash_ring.dump[(crash_ring.seq + i) % CRASH_DUMPS];
+		if (!valid_dump(dump)) {
+			continue;
+		}
+		for (n = 0; format_line(dump, n, line, sizeof(line)) > 0; n++) {
+			stack = FS_type(stack, (uint8_t*)line, strlen(line));
+		}
+	}
+	return stack;
+}
+
+
+// Private Functions
+// *****************
+
+/**
+  * @brief
+  * 	Function implementing the CRASH thread.
+  *
+  * 	Waits for the flash drive, writes the new dumps and terminates.
+  * @param
+  * 	argument: Not used
+  * @retval
+  * 	None
+  */
+static void CRASH_Thread(void *argument) {
+	osThreadFlagsWait(CRASH_PERSIST, osFlagsWaitAny, osWaitForever);
+	write_file();
+	CRASH_ThreadId = NULL;
+	osThreadExit();
+}
+
+
+/**
+  * @brief
+  * 	Gets the next dump slot and saves the registers common for all
+  * 	crashes.
+  * @param[in]
+  * 	id    assert id
+  * @retval
+  * 	dump
+  */
+static CRASH_Dump_t* new_dump(uint32_t id) {
+	CRASH_Dump_t *dump;
+
+	if (crash_ring.magic != CRASH_MAGIC) {
+		// crash before CRASH_init()
+		memset(&crash_ring, 0, sizeof(crash_ring));
+		crash_ring.magic = CRASH_MAGIC;
+	}
+	dump = &crash_ring.dump[crash_ring.seq % CRASH_DUMPS];
+	memset(dump, 0, sizeof(CRASH_Dump_t));
+	dump->magic = CRASH_MAGIC;
+	dump->seq = crash_ring.seq++;
+	dump->id = id;
+	dump->tick = osKernelGetTickCount();
+	dump->cfsr = SCB->CFSR;
+	dump->hfsr = SCB->HFSR;
+	dump->mmfar = SCB->MMFAR;
+	dump->bfar = SCB->BFAR;
+	if (xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED) {
+		strncpy(dump->task, pcTaskGetName(NULL), CRASH_TASK_NAME - 1);
+	}
+	dump->trace_cnt = LOG_getRecent(dump->trace, CRASH_TRACE);
+	return dump;
+}
+
+
+/**
+  * @brief
+  * 	Saves the context of a task which is not running.
+  *
+  * 	pxTopOfStack is the first member of the TCB, the context on the
+  * 	stack is r4 .. r11, EXC_RETURN, [s16 .. s31], exception stack frame.
+  * @param[in]
+  * 	dump
+  * @param[in]
+  * 	task
+  * @retval
+  * 	None
+  */
+static void save_context(CRASH_Dump_t *dump, TaskHandle_t task) {
+	uint32_t *top;
+
+	top = *(uint32_t**) task;
+	if (in_ram((uint32_t)top, 9 * 4)) {
+		save_frame(dump, top + 9 + ((top[8] & 0x10) ? 0 : 16), top[8], top);
+	}
+}
+
+
+/**
+  * @brief
+  * 	Saves the registers from the exception stack frame and the top of
+  * 	the Forth stacks.
+  * @param[in]
+  * 	dump
+  * @param[in]
+  * 	frame       exception stack frame
+  * @param[in]
+  * 	exc_return  EXC_RETURN, bit 4 cleared if the frame has FPU context
+  * @param[in]
+  * 	r4_r11      registers r4 .. r11, NULL if not available
+  * @retval
+  * 	None
+  */
+static void save_frame(CRASH_Dump_t *dump, uint32_t *frame,
+		uint32_t exc_return, uint32_t *r4_r11) {
+	uint32_t *sp;
+	int i;
+
+	dump->exc_return = exc_return;
+	if (r4_r11 != NULL) {
+		for (i = 0; i < 8; i++) {
+			dump->r[4 + i] = r4_r11[i];
+		}
+	}
+	if (!in_ram((uint32_t)frame, CRASH_FRAME_BASIC * 4)) {
+		// stack pointer corrupted
+		dump->sp = (uint32_t)frame;
+		return;
+	}
+	for (i = 0; i < 4; i++) {
+		dump->r[i] = frame[i];
+	}
+	dump->r[12] = frame[4];
+	dump->lr = frame[5];
+	dump->pc = frame[6];
+	dump->psr = frame[7];
+
+	// stack pointer before the exception, xPSR bit 9 for the alignment word
+	sp = frame + ((exc_return & 0x10) ? CRASH_FRAME_BASIC : CRASH_FRAME_FPU);
+	if (dump->psr & (1 << 9)) {
+		sp++;
+	}
+	dump->sp = (uint32_t)sp;
+
+	// the Forth return stack is the task stack
+	if (in_ram((uint32_t)sp, CRASH_STACK_DEPTH * 4)) {
+		for (i = 0; i < CRASH_STACK_DEPTH; i++) {
+			dump->return_stack[i] = sp[i];
+		}
+	}
+
+	// the Forth data stack, TOS in r6, psp in r7
+	if (r4_r11 != NULL) {
+		dump->data_stack[0] = dump->r[6];
+		if (in_ram(dump->r[7], (CRASH_STACK_DEPTH - 1) * 4)) {
+			for (i = 1; i < CRASH_STACK_DEPTH; i++) {
+				dump->data_stack[i] = ((uint32_t*)dump->r[7])[i - 1];
+			}
+		}
+	}
+}
+
+
+/**
+  * @brief
+  * 	Is the word aligned memory block in the SRAM?
+  * @param[in]
+  * 	adr
+  * @param[in]
+  * 	size  in bytes
+  * @retval
+  * 	TRUE if it is in the SRAM
+  */
+static int in_ram(uint32_t adr, uint32_t size) {
+	return (adr & 3) == 0 && adr >= CRASH_RAM_START && adr + size <= CRASH_RAM_END;
+}
+
+
+/**
+  * @brief
+  * 	Checksum of the dump, without the checksum field.
+  * @param[in]
+  * 	dump
+  * @retval
+  * 	checksum
+  */
+static uint32_t checksum(CRASH_Dump_t *dump) {
+	uint32_t *p = (uint32_t*) dump;
+	uint32_t sum = CRASH_MAGIC;
+
+	while (p < &dump->checksum) {
+		sum = (sum << 1 | sum >> 31) ^ *p++;
+	}
+	return sum;
+}
+
+
+/**
+  * @brief
+  * 	Is it a complete dump?
+  * @param[in]
+  * 	dump
+  * @retval
+  * 	TRUE if valid
+  */
+static int valid_dump(CRASH_Dump_t *dump) {
+	return dump->magic == CRASH_MAGIC && dump->checksum == checksum(dump);
+}
+
+
+/**
+  * @brief
+  * 	Formats a line of the dump.
+  * @param[in]
+  * 	dump
+  * @param[in]
+  * 	line  line number
+  * @param[out]
+  * 	str   buffer for the line
+  * @param[in]
+  * 	size  buffer size
+  * @retval
+  * 	line length, 0 after the last line
+  */
+static int format_line(CRASH_Dump_t *dump, int line, char *str, int size) {
+	uint32_t *cell;
+	LOG_Record_t *rec;
+	int i, n;
+
+	switch (line) {
+	case 0:
+		snprintf(str, size, "crash %lu: %s (%lu) at %lu ms, task \"%.*s\"\n",
+				dump->seq, ASSERT_getMsg(dump->id), dump->id, dump->tick,
+				CRASH_TASK_NAME, dump->task);
+		break;
+	case 1:
+		snprintf(str, size, "pc  %08lx lr  %08lx sp  %08lx psr %08lx\n",
+				dump->pc, dump->lr, dump->sp, dump->psr);
+		break;
+	case 2:
+	case 3:
+	case 4:
+		i = (line - 2) * 4;
+		snprintf(str, size, "r%-2i %08lx r%-2i %08lx r%-2i %08lx r%-2i %08lx\n",
+				i, dump->r[i], i+1, dump->r[i+1], i+2, dump->r[i+2], i+3, dump->r[i+3]);
+		break;
+	case 5:
+		snprintf(str, size, "r12 %08lx exc %08lx cfsr %08lx hfsr %08lx\n",
+				dump->r[12], dump->exc_return, dump->cfsr, dump->hfsr);
+		break;
+	case 6:
+		snprintf(str, size, "mmfar %08lx bfar %08lx\n", dump->mmfar, dump->bfar);
+		break;
+	case 7:
+	case 8:
+		cell = (line == 7) ? dump->data_stack : dump->return_stack;
+		n = snprintf(str, size, "%s", (line == 7) ? "data  " : "return");
+		for (i = 0; i < CRASH_STACK_DEPTH && n < size; i++) {
+			n += snprintf(str + n, size - n, " %08lx", cell[i]);
+		}
+		if (n < size - 1) {
+			strcat(str, "\n");
+		}
+		break;
+	default:
+		i = line - 9;
+		if (i >= (int)dump->trace_cnt || i >= CRASH_TRACE) {
+			str[0] = 0;
+			break;
+		}
+		rec = &dump->trace[i];
+		n = snprintf(str, size, "%10lu ", rec->timestamp);
+		if ((uint32_t)rec->fmt >= CRASH_FLASH_START && (uint32_t)rec->fmt < CRASH_FLASH_END) {
+			// the format string is only valid for the same firmware image
+			snprintf(str + n, size - n - 1, rec->fmt, rec->arg[0], rec->arg[1], rec->arg[2]);
+		} else {
+			snprintf(str + n, size - n - 1, "<%08lx> %08lx %08lx %08lx",
+					(uint32_t)rec->fmt, rec->arg[0], rec->arg[1], rec->arg[2]);
+		}
+		strcat(str, "\n");
+		break;
+	}
+	return strlen(str);
+}
+
+
+/**
+  * @brief
+  * 	Appends the dumps not yet saved to the crash file.
+  * @retval
+  * 	None
+  */
+static void write_file(void) {
+	FIL fil;
+	UINT bw;
+	char line[CRASH_LINE_LENGTH];
+	CRASH_Dump_t *dump;
+	int i, n, len;
+
+	if (f_open(&fil, CRASH_FILE, FA_OPEN_APPEND | FA_WRITE) != FR_OK) {
+		return;
+	}
+	for (i = 0; i < CRASH_DUMPS; i++) {
+		dump = &crash_ring.dump[(crash_ring.seq + i) % CRASH_DUMPS];
+		if (!valid_dump(dump) || dump->saved) {
+			continue;
+		}
+		for (n = 0; (len = format_line(dump, n, line, sizeof(line))) > 0; n++) {
+			if (f_write(&fil, line, len, &bw) != FR_OK || bw != (UINT)len) {
+				f_close(&fil);
+				return;
+			}
+		}
+		dump->saved = TRUE;
+		dump->checksum = checksum(dump);
+	}
+	f_close(&fil);
+}
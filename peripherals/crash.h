@@ -0,0 +1,120 @@
+/**
+ *  @brief
+ *      Crash dump.
+ *
+ *      The fault handlers, the stack overflow hook and the watchdog early
+ *      wakeup save the registers, the Forth stacks, the task name and the
+ *      latest log records into a no-init RAM ring which survives the reset.
+ *  @file
+ *      crash.h
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-18
+ *  @remark
+ *      Language: C, STM32CubeIDE GCC
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ *
+ *      Mecrsip-Cube is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with Mecrsip-Cube. If not, see http://www.gnu.org/licenses/.
+ */
+
+
+
+#ifndef INC_CRASH_H_
+#define INC_CRASH_H_
+
+#include "log.h"
+
+#define CRASH_DUMPS			4				// no-init RAM ring
+#define CRASH_MAGIC			0x48535243		// "CRSH"
+#define CRASH_STACK_DEPTH	8				// Forth stack cells
+#define CRASH_TRACE			4				// log records
+#define CRASH_TASK_NAME		16				// configMAX_TASK_NAME_LEN
+#define CRASH_FILE			"0:/crash.log"
+
+/** Crash dump in the no-init RAM */
+typedef struct {
+	uint32_t		magic;
+	/** crash number since the ring was initialized */
+	uint32_t		seq;
+	/** assert id e.g. ASSERT_HARD_FAULT */
+	uint32_t		id;
+	/** kernel ticks (ms) */
+	uint32_t		tick;
+	/** r0 .. r12 */
+	uint32_t		r[13];
+	uint32_t		sp;
+	uint32_t		lr;
+	uint32_t		pc;
+	uint32_t		psr;
+	uint32_t		exc_return;
+	/** SCB fault status and address registers */
+	uint32_t		cfsr;
+	uint32_t		hfsr;
+	uint32_t		mmfar;
+	uint32_t		bfar;
+	char			task[CRASH_TASK_NAME];
+	/** Forth data stack, TOS is r6, psp is r7 */
+	uint32_t		data_stack[CRASH_STACK_DEPTH];
+	/** Forth return stack is the task stack */
+	uint32_t		return_stack[CRASH_STACK_DEPTH];
+	LOG_Record_t	trace[CRASH_TRACE];
+	uint32_t		trace_cnt;
+	/** written to CRASH_FILE */
+	uint32_t		saved;
+	uint32_t		checksum;
+} CRASH_Dump_t;
+
+void CRASH_init(void);
+void CRASH_persist(void);
+uint32_t CRASH_save(uint32_t id, void *task);
+void CRASH_fault(uint32_t id, uint32_t *frame, uint32_t exc_return, uint32_t *r4_r11);
+void CRASH_faultEntry(void);
+uint64_t CRASH_print(uint64_t forth_stack);
+
+/**
+ *  @brief
+ *      Crash dump and reset, the only statement in a fault handler.
+ *
+ *      Passes the exception stack frame (MSP or PSP) and EXC_RETURN to
+ *      CRASH_faultEntry() before the compiler touches r4 .. r11. The
+ *      handler has to be naked (see CRASH_HANDLER), otherwise the prologue
+ *      (e.g. push {r7, lr} at -O0) moves the MSP away from the frame.
+ *      Basic asm only, as required in naked functions.
+ *  @param[in]
+ *  	id    assert id e.g. ASSERT_HARD_FAULT (a number macro)
+ */
+#define CRASH_FAULT(id)                                 \
+  __asm volatile (                                      \
+	" tst lr, #4                    \n"                 \
+	" ite eq                        \n"                 \
+	" mrseq r1, msp                 \n"                 \
+	" mrsne r1, psp                 \n"                 \
+	" mov r2, lr                    \n"                 \
+	" mov r0, #" CRASH_STR(id) "    \n"                 \
+	" b CRASH_faultEntry            \n"                 \
+	);                                                  \
+  __builtin_unreachable()
+
+#define CRASH_STR(x)		CRASH_STR_(x)
+#define CRASH_STR_(x)		#x
+
+/**
+ *  @brief
+ *      Declares a fault handler naked (no prologue) for CRASH_FAULT.
+ */
+#define CRASH_HANDLER(handler)	void handler(void) __attribute__((naked))
+
+#endif /* INC_CRASH_H_ */
@@ -0,0 +1,326 @@
+/**
+ *  @brief
+ *      Data logging files for high-rate data capture.
+ *
+ *      The file is pre-allocated with f_expand() as one contiguous cluster
+ *      block and the cluster link map table (CLMT, fast seek) is built once.
+ *      The appended data is written directly to the sectors by raw
+ *      multi-block writes (disk_write), the FAT is not accessed anymore. The
+ *      directory entry (file size) is updated only by DATALOG_sync() and
+ *      DATALOG_close(), the close releases the clusters not used.
+ *
+ *      After a power loss the file has the size of the last sync, the
+ *      clusters not used are lost till the next check disk.
+ *  @file
+ *      datalog.c
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-19
+ *  @remark
+ *      Language: C, STM32CubeIDE GCC
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ *
+ *      Mecrsip-Cube is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with Mecrsip-Cube. If not, see http://www.gnu.org/licenses/.
+ */
+
+// System include files
+// ********************
+#include "cmsis_os.h"
+#include <string.h>
+
+// Application include files
+// *************************
+#include "app_common.h"
+#include "main.h"
+#include "diskio.h"
+#include "datalog.h"
+
+
+// Defines
+// *******
+#define SECTOR_SIZE			_MIN_SS		// _MIN_SS == _MAX_SS
+#define MAX_BLOCKS			128			// sectors per disk_write
+#define FA_MODIFIED			0x40		// see ff.c, the directory entry is updated by f_sync()
+
+
+// Private typedefs
+// ****************
+
+
+// Private function prototypes
+// ***************************
+static DWORD map(const DATALOG_t *dl, FSIZE_t ofs, UINT *run);
+static FRESULT write_buf(DATALOG_t *dl);
+
+// Global Variables
+// ****************
+
+// Hardware resources
+// ******************
+
+// RTOS resources
+// **************
+
+
+// Private Variables
+// *****************
+
+
+// Public Functions
+// ****************
+
+/**
+ *  @brief
+ *      Size of the data logging file object.
+ *
+ *      /DATALOG ( -- u )
+ *  @return
+ *      size in bytes
+ */
+int DATALOG_size(void) {
+	return(sizeof(DATALOG_t));
+}
+
+
+/**
+ *  @brief
+ *      Creates the file, pre-allocates a contiguous block and builds the
+ *      link map table. An existing file is overwritten.
+ *  @param[in]
+ *      dl      data logging file object
+ *  @param[in]
+ *      path    file name
+ *  @param[in]
+ *      size    maximum file size
+ *  @return
+ *      FRESULT, FR_DENIED no contiguous block
+ */
+FRESULT DATALOG_create(DATALOG_t *dl, const TCHAR *path, FSIZE_t size) {
+	FRESULT fr;
+
+	memset(dl, 0, sizeof(DATALOG_t));
+	fr = f_open(&dl->fil, path, FA_CREATE_ALWAYS | FA_WRITE);
+	if (fr != FR_OK) {
+		return fr;
+	}
+
+	fr = f_expand(&dl->fil, size, 1);
+	if (fr == FR_OK) {
+		dl->size = size;
+		dl->clmt[0] = DATALOG_CLMT;
+		dl->fil.cltbl = dl->clmt;
+		fr = f_lseek(&dl->fil, CREATE_LINKMAP);
+	}
+	if (fr != FR_OK) {
+		f_close(&dl->fil);
+		f_unlink(path);
+		return fr;
+	}
+
+	// the directory entry has the clusters but the size 0
+	return DATALOG_sync(dl);
+}
+
+
+/**
+ *  @brief
+ *      Appends the data. The complete sectors are written directly, the
+ *      rest is buffered.
+ *  @param[in]
+ *      dl      data logging file object
+ *  @param[in]
+ *      buff    data
+ *  @param[in]
+ *      btw     number of bytes
+ *  @return
+ *      FRESULT, FR_DENIED pre-allocated size exceeded (nothing written)
+ */
+FRESULT DATALOG_write(DATALOG_t *dl, const void *buff, UINT btw) {
+	const BYTE *data = buff;
+	DWORD sect;
+	UINT ofs, n, run;
+	FRESULT fr;
+
+	if (dl->fil.obj.fs == NULL) {
+		return FR_INVALID_OBJECT;
+	}
+	if (btw > dl->size - dl->pos) {
+		return FR_DENIED;
+	}
+
+	// fill up the buffered sector
+	ofs = dl->pos % SECTOR_SIZE;
+	if (ofs != 0) {
+		n = SECTOR_SIZE - ofs;
+		if (n > btw) {
+			n = btw;
+		}
+		memcpy(&dl->buf[ofs], data, n);
+		dl->pos += n;
+		data += n;
+		btw -= n;
+		if (dl->pos % SECTOR_SIZE == 0) {
+			fr = write_buf(dl);
+			if (fr != FR_OK) {
+				return fr;
+			}
+		}
+	}
+
+	// complete sectors
+	while (btw >= SECTOR_SIZE) {
+		sect = map(dl, dl->pos, &run);
+		if (sect == 0) {
+			return FR_INT_ERR;
+		}
+		n = btw / SECTOR_SIZE;
+		if (n > run) {
+			n = run;
+		}
+		if (n > MAX_BLOCKS) {
+			n = MAX_BLOCKS;
+		}
+		if (disk_write(dl->fil.obj.fs->drv, data, sect, n) != RES_OK) {
+			return FR_DISK_ERR;
+		}
+		dl->pos += n * SECTOR_SIZE;
+		data += n * SECTOR_SIZE;
+		btw -= n * SECTOR_SIZE;
+	}
+
+	// rest
+	if (btw > 0) {
+		memcpy(dl->buf, data, btw);
+		dl->pos += btw;
+	}
+	return FR_OK;
+}
+
+
+/**
+ *  @brief
+ *      Writes the buffered sector and updates the directory entry (size
+ *      and time stamp).
+ *  @param[in]
+ *      dl      data logging file object
+ *  @return
+ *      FRESULT
+ */
+FRESULT DATALOG_sync(DATALOG_t *dl) {
+	FRESULT fr;
+
+	if (dl->fil.obj.fs == NULL) {
+		return FR_INVALID_OBJECT;
+	}
+	if (dl->pos % SECTOR_SIZE != 0) {
+		fr = write_buf(dl);
+		if (fr != FR_OK) {
+			return fr;
+		}
+	}
+	dl->fil.obj.objsize = dl->pos;
+	dl->fil.flag |= FA_MODIFIED;
+	return f_sync(&dl->fil);
+}
+
+
+/**
+ *  @brief
+ *      Syncs and closes the file, the clusters not used are released.
+ *  @param[in]
+ *      dl      data logging file object
+ *  @return
+ *      FRESULT
+ */
+FRESULT DATALOG_close(DATALOG_t *dl) {
+	FRESULT fr;
+
+	fr = DATALOG_sync(dl);
+	if (fr != FR_OK) {
+		return fr;
+	}
+
+	// FatFs follows the chain again to truncate the file
+	dl->fil.cltbl = NULL;
+	dl->fil.obj.objsize = dl->size;
+	fr = f_lseek(&dl->fil, dl->pos);
+	if (fr == FR_OK) {
+		fr = f_truncate(&dl->fil);
+	}
+	if (fr == FR_OK) {
+		fr = f_close(&dl->fil);
+	} else {
+		dl->fil.obj.objsize = dl->pos;
+		f_close(&dl->fil);
+	}
+	dl->fil.obj.fs = NULL;
+	return fr;
+}
+
+
+// Private Functions
+// *****************
+
+/**
+ *  @brief
+ *      Maps the file offset to the sector by the link map table.
+ *  @param[in]
+ *      dl      data logging file object
+ *  @param[in]
+ *      ofs     file offset
+ *  @param[out]
+ *      run     contiguous sectors from there on
+ *  @return
+ *      sector, 0 not mapped
+ */
+static DWORD map(const DATALOG_t *dl, FSIZE_t ofs, UINT *run) {
+	FATFS *fs = dl->fil.obj.fs;
+	const DWORD *tbl = &dl->clmt[1];
+	DWORD sect = ofs / SECTOR_SIZE;
+	DWORD cl = sect / fs->csize;
+	DWORD ncl;
+
+	while ((ncl = *tbl++) != 0) {
+		if (cl < ncl) {
+			*run = (ncl - cl) * fs->csize - sect % fs->csize;
+			return fs->database + (*tbl + cl - 2) * fs->csize + sect % fs->csize;
+		}
+		cl -= ncl;
+		tbl++;
+	}
+	return 0;
+}
+
+
+/**
+ *  @brief
+ *      Writes the buffered sector (pos is in or at the end of it).
+ *  @return
+ *      FRESULT
+ */
+static FRESULT write_buf(DATALOG_t *dl) {
+	DWORD sect;
+	UINT run;
+
+	sect = map(dl, dl->pos - 1, &run);
+	if (sect == 0) {
+		return FR_INT_ERR;
+	}
+	if (disk_write(dl->fil.obj.fs->drv, dl->buf, sect, 1) != RES_OK) {
+		return FR_DISK_ERR;
+	}
+	return FR_OK;
+}
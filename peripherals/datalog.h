@@ -0,0 +1,53 @@
+/**
+ *  @brief
+ *      Data logging files for high-rate data capture.
+ *
+ *      The file is pre-allocated contiguous (f_expand), the data is written
+ *      by raw multi-block writes without FAT access.
+ *  @file
+ *      datalog.h
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-19
+ *  @remark
+ *      Language: C, STM32CubeIDE GCC
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ *
+ *      Mecrsip-Cube is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with Mecrsip-Cube. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef INC_DATALOG_H_
+#define INC_DATALOG_H_
+
+#include "ff.h"
+
+#define DATALOG_CLMT		16		// link map table, 7 fragments
+
+typedef struct {
+	FIL fil;
+	DWORD clmt[DATALOG_CLMT];		// cluster link map table (fast seek)
+	FSIZE_t size;					// pre-allocated
+	FSIZE_t pos;					// written
+	BYTE buf[_MIN_SS];				// last sector, not complete
+} DATALOG_t;
+
+int DATALOG_size(void);
+FRESULT DATALOG_create(DATALOG_t *dl, const TCHAR *path, FSIZE_t size);
+FRESULT DATALOG_write(DATALOG_t *dl, const void *buff, UINT btw);
+FRESULT DATALOG_sync(DATALOG_t *dl);
+FRESULT DATALOG_close(DATALOG_t *dl);
+
+#endif /* INC_DATALOG_H_ */
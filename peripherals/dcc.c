@@ -2,11 +2,24 @@
  *  @brief
  *      Digital Command Control Driver
  *
- *		Using TIM16, resolution 1 us, interrupt every 58 us (see module tim.c).
+ *		Using TIM16, resolution 1 us (see module tim.c).
+ *		The packet is encoded into a buffer of half bit periods. The DMA
+ *		writes the next period into the ARR (preload) on each update event,
+ *		a second circular DMA writes D0/D1 into GPIOA BSRR on each CC1
+ *		(CCR1 = 0, start of the period). Between the packets the ARR stays
+ *		at the 1-bit half period (preamble). The CPU is only involved once
+ *		per packet (DMA transfer complete).
  *		max. 2*116 us for one 0-bit -> min. 4 kBit/s
  *		129 bit in 30 ms, about min. 12 bytes, average 18 bytes
  *		Max. 4 active locomotive slots.
  *		Each slot has an assigned locomotive address.
+ *
+ *		Scheduler: new speed and function commands go into the urgent
+ *		queue, accessory commands into the accessory queue, both are sent
+ *		with the required repetitions. The active slots are refreshed in
+ *		the background, at least every DCC_REFRESH_SHARE packet. Commands
+ *		for the same slot are merged, the packet is built from the slot
+ *		when it is sent.
  *  @file
  *      dcc.c
  *  @author
@@ -36,6 +49,7 @@
 // ********************
 #include "cmsis_os.h"
 #include <stdio.h>
+#include <string.h>
 
 // Application include files
 // *************************
@@ -45,28 +59,68 @@
 
 #include "bsp.h"
 #include "dcc.h"
+#include "fs.h"
 
 #if DCC == 1
 
 #define TIME_0BIT_HALF_PERIOD	(100-1)		// 0 bit is 100 us
 #define TIME_1BIT_HALF_PERIOD	(58-1)		// 1 bit is 58 us
+#define DCC_UPDATE_WAIT			1000		// polls, more than a 0 bit (200 us)
+
+// lead-in, preamble, start bit and 8 bits for each byte, both halves, end bit
+#define DCC_MAX_PERIODS			(1 + DCC_PREAMBLE_BITS*2 + DCC_MAX_PACKET_LENGTH*9*2 + 1)
 
 // Types
 // *****
 
-typedef struct accessory_t {
-	int 	adr;
-	int 	D;
-	int		R;
-} accessory_t;
+typedef enum {
+	PACKET_SPEED,
+	PACKET_FUNCTION,
+	PACKET_ACCESSORY
+} packet_t;
+
+typedef struct command_t {
+	packet_t	type;
+	int			repeat;		// packets to send
+	int			slot;		// loco slot
+	int 		adr;		// accessory address
+	int 		D;
+	int			R;
+	uint32_t	time;		// enqueued (ticks), 0 already sent
+} command_t;
+
+typedef struct queue_t {
+	command_t	command[DCC_QUEUE_SIZE];
+	int			head;
+	int			count;
+	// statistics
+	uint32_t	packets;
+	uint32_t	commands;
+	uint32_t	dropped;
+	uint32_t	latency_min;
+	uint32_t	latency_max;
+	uint32_t	latency_sum;
+} queue_t;
 
 // Private function prototypes
 // ***************************
 static void DCC_Thread(void *argument);
 static void prepare_packet(int delay);
+static int next_packet(void);
+static int refresh_packet(uint32_t now);
+static int build_packet(command_t *cmd);
+static void add_address(int address);
+static void enqueue(queue_t *queue, command_t *cmd);
+static void dequeue(queue_t *queue);
+static void kick(void);
+static int running(void);
+static int encode_packet(uint16_t *period, const uint8_t *data, int count);
+static void dma_complete(DMA_HandleTypeDef *hdma);
 
 // Global Variables
 // ****************
+DMA_HandleTypeDef hdma_tim16_up;
+DMA_HandleTypeDef hdma_tim16_ch1;
 
 // Hardware resources
 // ******************
@@ -99,13 +153,30 @@ static const osMutexAttr_t DCC_MutexAttr = {
 static DCC_LocoSlot_t loco_slots[DCC_MAX_LOCO_SLOTS];
 
 static uint8_t  packet[DCC_MAX_PACKET_LENGTH];
-static uint32_t	half_bit = FALSE;
-static uint32_t bit_count;
-static uint32_t byte_count = 0;
-static uint32_t packet_len = 0;
+static int		packet_address = -1;
+static int		idle = TRUE;
+
+// half bit periods (ARR), period[0] is the lead-in
+static uint16_t period[DCC_MAX_PERIODS];
+
+// BSRR for the first half (D1 high) and the second half (D0 high)
+static const uint32_t pins[2] = {
+		D1_Pin | (D0_Pin << 16),
+		D0_Pin | (D1_Pin << 16)
+};
 static int len;
 
-static 	accessory_t accessory;
+static queue_t 	urgent;
+static queue_t 	accessories;
+static int		refresh_slot;
+static int		refresh_share;
+static uint32_t refresh_start;
+static uint32_t refresh_cycle;		// ms for all active slots
+
+// track bandwidth since the last DCC_printStats()
+static uint32_t	track_packets;
+static uint32_t	track_time;			// us
+static uint32_t	track_start;
 
 
 // Public Functions
@@ -133,6 +204,42 @@ void DCC_init(void) {
 	loco_slots[1].direction = 0x80;
 	loco_slots[2].direction = 0x80;
 	loco_slots[3].direction = 0x80;
+
+	// TIM16 update -> ARR
+	__HAL_RCC_DMAMUX1_CLK_ENABLE();
+	__HAL_RCC_DMA2_CLK_ENABLE();
+	hdma_tim16_up.Instance = DMA2_Channel2;
+	hdma_tim16_up.Init.Request = DMA_REQUEST_TIM16_UP;
+	hdma_tim16_up.Init.Direction = DMA_MEMORY_TO_PERIPH;
+	hdma_tim16_up.Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma_tim16_up.Init.MemInc = DMA_MINC_ENABLE;
+	hdma_tim16_up.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+	hdma_tim16_up.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+	hdma_tim16_up.Init.Mode = DMA_NORMAL;
+	hdma_tim16_up.Init.Priority = DMA_PRIORITY_VERY_HIGH;
+	if (HAL_DMA_Init(&hdma_tim16_up) != HAL_OK) {
+		Error_Handler();
+	}
+	hdma_tim16_up.XferCpltCallback = dma_complete;
+
+	// TIM16 CC1 -> GPIOA BSRR
+	hdma_tim16_ch1.Instance = DMA2_Channel3;
+	hdma_tim16_ch1.Init.Request = DMA_REQUEST_TIM16_CH1;
+	hdma_tim16_ch1.Init.Direction = DMA_MEMORY_TO_PERIPH;
+	hdma_tim16_ch1.Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma_tim16_ch1.Init.MemInc = DMA_MINC_ENABLE;
+	hdma_tim16_ch1.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+	hdma_tim16_ch1.Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
+	hdma_tim16_ch1.Init.Mode = DMA_CIRCULAR;
+	hdma_tim16_ch1.Init.Priority = DMA_PRIORITY_VERY_HIGH;
+	if (HAL_DMA_Init(&hdma_tim16_ch1) != HAL_OK) {
+		Error_Handler();
+	}
+
+	HAL_NVIC_SetPriority(DMA2_Channel2_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(DMA2_Channel2_IRQn);
+
+	period[0] = TIME_1BIT_HALF_PERIOD;
 }
 
 
@@ -150,7 +257,13 @@ void DCC_start(void) {
 	// only one thread is allowed to use DCC
 	osMutexAcquire(DCC_MutexID, osWaitForever);
 	UTIL_LPM_SetStopMode(1U << CFG_LPM_DCC, UTIL_LPM_DISABLE);
-	HAL_TIM_Base_Start_IT(&htim16);
+	// idle: 1 bits (preamble)
+	__HAL_TIM_SET_AUTORELOAD(&htim16, TIME_1BIT_HALF_PERIOD);
+	SET_BIT(htim16.Instance->CR1, TIM_CR1_ARPE);
+	__HAL_TIM_SET_COMPARE(&htim16, TIM_CHANNEL_1, 0);
+	HAL_DMA_Start(&hdma_tim16_ch1, (uint32_t)pins, (uint32_t)&D0_GPIO_Port->BSRR, 2);
+	__HAL_TIM_ENABLE_DMA(&htim16, TIM_DMA_CC1);
+	HAL_TIM_Base_Start(&htim16);
 	osMutexRelease(DCC_MutexID);
 }
 
@@ -165,7 +278,10 @@ void DCC_start(void) {
 void DCC_stop(void) {
 	// only one thread is allowed to use DCC
 	osMutexAcquire(DCC_MutexID, osWaitForever);
-	HAL_TIM_Base_Stop_IT(&htim16);
+	__HAL_TIM_DISABLE_DMA(&htim16, TIM_DMA_UPDATE | TIM_DMA_CC1);
+	HAL_TIM_Base_Stop(&htim16);
+	HAL_DMA_Abort(&hdma_tim16_up);
+	HAL_DMA_Abort(&hdma_tim16_ch1);
 	UTIL_LPM_SetStopMode(1U << CFG_LPM_DCC, UTIL_LPM_ENABLE);
 	osMutexRelease(DCC_MutexID);
 	BSP_setDigitalPin(0, 0);
@@ -189,8 +305,8 @@ void DCC_setState(int slot, int state) {
 	// only one thread is allowed to use DCC
 	osMutexAcquire(DCC_MutexID, osWaitForever);
 	loco_slots[slot].state = state;
-	if ((packet_len == 0) & loco_slots[slot].state) {
-		osSemaphoreRelease(DCC_SemaphoreID);
+	if (loco_slots[slot].state) {
+		kick();
 	}
 	osMutexRelease(DCC_MutexID);
 }
@@ -257,9 +373,15 @@ int DCC_getAddress(int slot) {
  *      None
  */
 void DCC_setSpeed(int slot, int speed) {
+	command_t command;
+
 	// only one thread is allowed to use DCC
 	osMutexAcquire(DCC_MutexID, osWaitForever);
 	loco_slots[slot].speed = speed & 0x7F;
+	command.type = PACKET_SPEED;
+	command.repeat = DCC_SPEED_REPETITION;
+	command.slot = slot;
+	enqueue(&urgent, &command);
 	osMutexRelease(DCC_MutexID);
 }
 
@@ -291,6 +413,8 @@ int DCC_getSpeed(int slot) {
  *      None
  */
 void DCC_setDirection(int slot, int direction) {
+	command_t command;
+
 	// only one thread is allowed to use DCC
 	osMutexAcquire(DCC_MutexID, osWaitForever);
 	if (direction) {
@@ -298,6 +422,10 @@ void DCC_setDirection(int slot, int direction) {
 	} else {
 		loco_slots[slot].direction = 0x00;
 	}
+	command.type = PACKET_SPEED;
+	command.repeat = DCC_SPEED_REPETITION;
+	command.slot = slot;
+	enqueue(&urgent, &command);
 	osMutexRelease(DCC_MutexID);
 }
 
@@ -328,10 +456,15 @@ int DCC_getDirection(int slot) {
  *      None
  */
 void DCC_setFunction(int slot, int function) {
+	command_t command;
+
 	// only one thread is allowed to use DCC
 	osMutexAcquire(DCC_MutexID, osWaitForever);
 	loco_slots[slot].function_new |= function;
-	loco_slots[slot].function_repetition = DCC_FUNCTION_REPETITION;
+	command.type = PACKET_FUNCTION;
+	command.repeat = DCC_FUNCTION_REPETITION;
+	command.slot = slot;
+	enqueue(&urgent, &command);
 	osMutexRelease(DCC_MutexID);
 }
 
@@ -348,10 +481,15 @@ void DCC_setFunction(int slot, int function) {
  *      None
  */
 void DCC_resetFunction(int slot, int function) {
+	command_t command;
+
 	// only one thread is allowed to use DCC
 	osMutexAcquire(DCC_MutexID, osWaitForever);
 	loco_slots[slot].function_new &= ~function;
-	loco_slots[slot].function_repetition = DCC_FUNCTION_REPETITION;
+	command.type = PACKET_FUNCTION;
+	command.repeat = DCC_FUNCTION_REPETITION;
+	command.slot = slot;
+	enqueue(&urgent, &command);
 	osMutexRelease(DCC_MutexID);
 }
 
@@ -383,21 +521,86 @@ int DCC_getFunction(int slot) {
  *	@param[in]
  *	 	direction_R  0 diverging, <>0 normal
  *  @return
- *      function bits
+ *      None
  */
 void DCC_controlAccessory(int address, int activate_D, int direction_R) {
-	osMutexAcquire(DCC_MutexID, osWaitForever);
+	command_t command;
+
 	if (address <= 2044) {
-		accessory.adr = address+3;
+		command.adr = address+3;
 	} else {
-		accessory.adr = address-2045;
+		command.adr = address-2045;
 	}
-	accessory.D = activate_D;
-	accessory.R = direction_R;
+	command.type = PACKET_ACCESSORY;
+	command.repeat = DCC_ACCESSORY_REPETITION;
+	command.D = activate_D;
+	command.R = direction_R;
+	osMutexAcquire(DCC_MutexID, osWaitForever);
+	enqueue(&accessories, &command);
 	osMutexRelease(DCC_MutexID);
 }
 
 
+/**
+ *  @brief
+ *      Prints the scheduler and track statistics.
+ *
+ *		Packets/s and track load are measured since the last call.
+ *		Latency is the time from the command till the first packet is sent.
+ *  @param[in]
+ *      forth_stack   TOS (lower word) and SPS (higher word)
+ *  @return
+ *      TOS (lower word) and SPS (higher word)
+ */
+uint64_t DCC_printStats(uint64_t forth_stack) {
+	uint64_t stack;
+	char line[80];
+	uint32_t now;
+	uint32_t elapsed;
+	uint32_t packets;
+	uint32_t time;
+	queue_t *queue;
+	int i;
+
+	stack = forth_stack;
+
+	osMutexAcquire(DCC_MutexID, osWaitForever);
+	now = osKernelGetTickCount();
+	elapsed = now - track_start;
+	packets = track_packets;
+	time = track_time;
+	track_start = now;
+	track_packets = 0;
+	track_time = 0;
+	osMutexRelease(DCC_MutexID);
+
+	if (elapsed == 0) {
+		elapsed = 1;
+	}
+	snprintf(line, sizeof(line), "packets/s: %lu  track load: %lu %%  refresh cycle: %lu ms\n",
+			(packets * 1000) / elapsed, time / (elapsed * 10), refresh_cycle);
+	stack = FS_type(stack, (uint8_t*)line, strlen(line));
+
+	strcpy(line, "queue      commands packets dropped pending  latency min/avg/max ms\n");
+	stack = FS_type(stack, (uint8_t*)line, strlen(line));
+	for (i=0; i<2; i++) {
+		if (i == 0) {
+			queue = &urgent;
+		} else {
+			queue = &accessories;
+		}
+		snprintf(line, sizeof(line), "%-10s %8lu %7lu %7lu %7d  %5lu %5lu %5lu\n",
+				i ? "accessory" : "urgent",
+				queue->commands, queue->packets, queue->dropped, queue->count,
+				queue->latency_min,
+				queue->commands ? queue->latency_sum / queue->commands : 0,
+				queue->latency_max);
+		stack = FS_type(stack, (uint8_t*)line, strlen(line));
+	}
+	return stack;
+}
+
+
 // Private Functions
 // *****************
 
@@ -405,124 +608,348 @@ void DCC_controlAccessory(int address, int activate_D, int direction_R) {
   * @brief
   * 	Function implementing the DCC thread
   *
-  * 	Data for the packets are prepared here.
-  * 	Synchronized with DCC_TIM16_PeriodElapsedIRQHandler by DCC_SemaphoreID.
+  * 	The next packet is chosen and prepared here.
+  * 	Synchronized with the DMA transfer complete by DCC_SemaphoreID.
   * @param
   * 	argument: Not used
   * @retval
   * 	None
   */
 static void DCC_Thread(void *argument) {
-	int i;
-	int tmp;
+	int address;
+
+	track_start = osKernelGetTickCount();
+	refresh_start = track_start;
 
 	// Infinite loop
 	for(;;) {
-		// create data for packet
-		for (i=0; i<DCC_MAX_LOCO_SLOTS; i++) {
-			if (! loco_slots[i].state) {
-				// ignore not active slots
-				continue;
-			}
+		// blocked till packet is sent or there is something to send
+		if (osSemaphoreAcquire(DCC_SemaphoreID, 1000) == osErrorTimeout) {
+			// DCC stopped, the packet is lost
+			HAL_DMA_Abort(&hdma_tim16_up);
+			__HAL_TIM_DISABLE_DMA(&htim16, TIM_DMA_UPDATE);
+		}
+
+		// only one thread is allowed to use DCC
+		osMutexAcquire(DCC_MutexID, osWaitForever);
+		if (!running()) {
+			// DCC stopped, the slots stay queued till DCCstart
+			idle = TRUE;
+			osMutexRelease(DCC_MutexID);
+			continue;
+		}
+		idle = FALSE;
+		address = next_packet();
+		if (address < 0) {
+			// nothing to send, wait for kick()
+			idle = TRUE;
+			osMutexRelease(DCC_MutexID);
+			continue;
+		}
 
-			// blocked till packet is sent
-			osSemaphoreAcquire(DCC_SemaphoreID, 1000);
+		if (address == packet_address) {
+			prepare_packet(DCC_ADDRESS_GAP);
+		} else {
+			prepare_packet(0);
+		}
+		packet_address = address;
+	}
+}
 
-			if (loco_slots[i].state) {
-				// only one thread is allowed to use DCC
-				osMutexAcquire(DCC_MutexID, osWaitForever);
 
-				// slot is active
-				len = 0;
-				if (loco_slots[i].address <= 127) {
-					packet[len++] = loco_slots[i].address;
-				} else {
-					packet[len++] = DCC_COMMAND_ADDRESS | (loco_slots[i].address >> 8);
-					packet[len++] = loco_slots[i].address & 0xFF;
-				}
-				// speed and direction
-				packet[len++] = DCC_COMMAND_SPEED_128;
-				packet[len++] = loco_slots[i].speed | loco_slots[i].direction;
-
-				prepare_packet(3);
-
-				if (loco_slots[i].function_repetition) {
-					loco_slots[i].function_repetition--;
-
-					// blocked till packet is sent
-					osSemaphoreAcquire(DCC_SemaphoreID, 1000);
-					// only one thread is allowed to use DCC
-					osMutexAcquire(DCC_MutexID, osWaitForever);
-
-					len = 0;
-					if (loco_slots[i].address <= 127) {
-						packet[len++] = loco_slots[i].address;
-					} else {
-						packet[len++] = DCC_COMMAND_ADDRESS | (loco_slots[i].address >> 8);
-						packet[len++] = loco_slots[i].address & 0xFF;
-					}
-					if ((loco_slots[i].function_new & 0x0000001f) != (loco_slots[i].function & 0x0000001f)) {
-						// function F0 to F4
-						packet[len++] = DCC_COMMAND_F0_F4 |
-								(loco_slots[i].function_new & 0x00000001) << 4 |
-								(loco_slots[i].function_new & 0x0000001e) >> 1;
-					}
-					if ((loco_slots[i].function_new & 0x000001e0) != (loco_slots[i].function & 0x000001e0)) {
-						// function F5 to F8
-						packet[len++] = DCC_COMMAND_F5_F8 |
-								(loco_slots[i].function_new & 0x000001e0) >> 5;
-					}
-					if ((loco_slots[i].function_new & 0x00001e00) != (loco_slots[i].function & 0x00001e00)) {
-						// function F9 to F12
-						packet[len++] = DCC_COMMAND_F9_F12 |
-								(loco_slots[i].function_new & 0x00001e00) >> 9 ;
-					}
-					if ((loco_slots[i].function_new & 0x001fe000) != (loco_slots[i].function & 0x001fe000)) {
-						// function F13 to F20
-						packet[len++] = DCC_COMMAND_F13_F20 |
-								(loco_slots[i].function_new & 0x001fe000) >> 17;
-					}
-					if ((loco_slots[i].function_new & 0x1fe00000) != (loco_slots[i].function & 0x1fe00000)) {
-						// function F21 to F28
-						packet[len++] = DCC_COMMAND_F21_F28 |
-								(loco_slots[i].function_new & 0x1fe00000) >> 21;
-					}
-
-				    if (! loco_slots[i].function_repetition) {
-				    	loco_slots[i].function = loco_slots[i].function_new;
-				    }
-
-				    prepare_packet(3);
-				}
+/**
+  * @brief
+  * 	Chooses the next packet and builds it.
+  *
+  * 	Urgent before accessory commands, refresh at least every
+  * 	DCC_REFRESH_SHARE packet. A command with repetitions left goes to the
+  * 	end of its queue, the repetitions are interleaved with other packets.
+  * @retval
+  * 	address of the packet (for the gap), -1 nothing to send
+  */
+static int next_packet(void) {
+	queue_t *queue;
+	command_t *cmd;
+	command_t repetition;
+	int address;
+	uint32_t now;
+
+	now = osKernelGetTickCount();
+
+	if (refresh_share >= DCC_REFRESH_SHARE - 1 || (urgent.count == 0 && accessories.count == 0)) {
+		// refresh has its share
+		refresh_share = 0;
+		address = refresh_packet(now);
+		if (address >= 0) {
+			return address;
+		}
+	}
+
+	while (urgent.count || accessories.count) {
+		if (urgent.count) {
+			queue = &urgent;
+		} else {
+			queue = &accessories;
+		}
+		cmd = &queue->command[queue->head];
+		address = build_packet(cmd);
+		if (address < 0) {
+			// slot not active or nothing changed
+			dequeue(queue);
+			continue;
+		}
 
+		if (cmd->time) {
+			// first packet for this command
+			now = now - cmd->time;
+			if (queue->commands == 0 || now < queue->latency_min) {
+				queue->latency_min = now;
+			}
+			if (now > queue->latency_max) {
+				queue->latency_max = now;
 			}
+			queue->latency_sum += now;
+			queue->commands++;
+			cmd->time = 0;
 		}
-		// accessory
-		if (accessory.adr > 0) {
-			// blocked till packet is sent
-			osSemaphoreAcquire(DCC_SemaphoreID, 1000);
-			// only one thread is allowed to use DCC
-			osMutexAcquire(DCC_MutexID, osWaitForever);
-			len = 0;
-			tmp = 0x80;
-			tmp |= ((accessory.adr >> 2) & 0x3F);
-			packet[len++] = tmp;
-			tmp = 0x80;
-			tmp |= ((  accessory.adr  & 0x003) << 1);
-			tmp |= ((~(accessory.adr) & 0x700) >> 4);
-			tmp |= accessory.D?0x08:0x00;
-			tmp |= accessory.R?0x01:0x00;
-			packet[len++] = tmp;
-			accessory.adr = -1;
-			prepare_packet(3);
+		queue->packets++;
+		refresh_share++;
+
+		if (--cmd->repeat > 0) {
+			// repetition later, at the end of the queue
+			repetition = *cmd;
+			dequeue(queue);
+			queue->command[(queue->head + queue->count) % DCC_QUEUE_SIZE] = repetition;
+			queue->count++;
+		} else {
+			if (cmd->type == PACKET_FUNCTION) {
+				loco_slots[cmd->slot].function = loco_slots[cmd->slot].function_new;
+			}
+			dequeue(queue);
 		}
+		return address;
+	}
+
+	return -1;
+}
+
 
+/**
+  * @brief
+  * 	Builds the refresh packet (speed and direction) for the next active slot.
+  * @param[in]
+  * 	now  tick count
+  * @retval
+  * 	address, -1 no active slot
+  */
+static int refresh_packet(uint32_t now) {
+	command_t refresh;
+	int i;
+
+	for (i=0; i<DCC_MAX_LOCO_SLOTS; i++) {
+		if (++refresh_slot >= DCC_MAX_LOCO_SLOTS) {
+			refresh_slot = 0;
+			refresh_cycle = now - refresh_start;
+			refresh_start = now;
+		}
+		if (loco_slots[refresh_slot].state) {
+			refresh.type = PACKET_SPEED;
+			refresh.slot = refresh_slot;
+			return build_packet(&refresh);
+		}
+	}
+	return -1;
+}
+
+
+/**
+  * @brief
+  * 	Builds the packet for the command (without checksum).
+  *
+  * 	Loco packets are built from the current slot data.
+  * @param[in]
+  * 	cmd  command
+  * @retval
+  * 	address, -1 no packet (slot not active or no function changed)
+  */
+static int build_packet(command_t *cmd) {
+	DCC_LocoSlot_t *loco;
+	int tmp;
+
+	len = 0;
+
+	if (cmd->type == PACKET_ACCESSORY) {
+		tmp = 0x80;
+		tmp |= ((cmd->adr >> 2) & 0x3F);
+		packet[len++] = tmp;
+		tmp = 0x80;
+		tmp |= ((  cmd->adr  & 0x003) << 1);
+		tmp |= ((~(cmd->adr) & 0x700) >> 4);
+		tmp |= cmd->D?0x08:0x00;
+		tmp |= cmd->R?0x01:0x00;
+		packet[len++] = tmp;
+		// not the same as a loco address
+		return cmd->adr | 0x10000;
+	}
+
+	loco = &loco_slots[cmd->slot];
+	if (! loco->state) {
+		return -1;
+	}
+	add_address(loco->address);
+
+	if (cmd->type == PACKET_SPEED) {
+		// speed and direction
+		packet[len++] = DCC_COMMAND_SPEED_128;
+		packet[len++] = loco->speed | loco->direction;
+		return loco->address;
+	}
+
+	tmp = len;
+	if ((loco->function_new & 0x0000001f) != (loco->function & 0x0000001f)) {
+		// function F0 to F4
+		packet[len++] = DCC_COMMAND_F0_F4 |
+				(loco->function_new & 0x00000001) << 4 |
+				(loco->function_new & 0x0000001e) >> 1;
+	}
+	if ((loco->function_new & 0x000001e0) != (loco->function & 0x000001e0)) {
+		// function F5 to F8
+		packet[len++] = DCC_COMMAND_F5_F8 |
+				(loco->function_new & 0x000001e0) >> 5;
+	}
+	if ((loco->function_new & 0x00001e00) != (loco->function & 0x00001e00)) {
+		// function F9 to F12
+		packet[len++] = DCC_COMMAND_F9_F12 |
+				(loco->function_new & 0x00001e00) >> 9 ;
+	}
+	if ((loco->function_new & 0x001fe000) != (loco->function & 0x001fe000)) {
+		// function F13 to F20
+		packet[len++] = DCC_COMMAND_F13_F20 |
+				(loco->function_new & 0x001fe000) >> 17;
+	}
+	if ((loco->function_new & 0x1fe00000) != (loco->function & 0x1fe00000)) {
+		// function F21 to F28
+		packet[len++] = DCC_COMMAND_F21_F28 |
+				(loco->function_new & 0x1fe00000) >> 21;
+	}
+	if (len == tmp) {
+		// nothing changed
+		loco->function = loco->function_new;
+		return -1;
+	}
+	return loco->address;
+}
+
+
+/**
+  * @brief
+  * 	Adds the loco address to the packet (short or long address).
+  * @param[in]
+  * 	address  loco address
+  * @retval
+  * 	None
+  */
+static void add_address(int address) {
+	if (address <= 127) {
+		packet[len++] = address;
+	} else {
+		packet[len++] = DCC_COMMAND_ADDRESS | (address >> 8);
+		packet[len++] = address & 0xFF;
+	}
+}
+
+
+/**
+  * @brief
+  * 	Adds a command to the queue.
+  *
+  * 	A pending loco command of the same type and slot is merged (the
+  * 	packet is built from the slot), the repetitions start again.
+  * 	The time stamp (| 1, never 0) is for the latency.
+  * 	Has to be called with DCC_MutexID.
+  * @param[in]
+  * 	queue  urgent or accessory queue
+  * @param[in]
+  * 	cmd    command
+  * @retval
+  * 	None
+  */
+static void enqueue(queue_t *queue, command_t *cmd) {
+	command_t *pending;
+	int i;
+
+	if (cmd->type != PACKET_ACCESSORY) {
+		for (i=0; i<queue->count; i++) {
+			pending = &queue->command[(queue->head + i) % DCC_QUEUE_SIZE];
+			if (pending->type == cmd->type && pending->slot == cmd->slot) {
+				pending->repeat = cmd->repeat;
+				if (pending->time == 0) {
+					// new command
+					pending->time = osKernelGetTickCount() | 1;
+				}
+				return;
+			}
+		}
+	}
+
+	if (queue->count >= DCC_QUEUE_SIZE) {
+		queue->dropped++;
+		return;
+	}
+
+	pending = &queue->command[(queue->head + queue->count) % DCC_QUEUE_SIZE];
+	*pending = *cmd;
+	pending->time = osKernelGetTickCount() | 1;
+	queue->count++;
+	kick();
+}
+
+
+/**
+  * @brief
+  * 	Removes the first command from the queue.
+  * @param[in]
+  * 	queue  urgent or accessory queue
+  * @retval
+  * 	None
+  */
+static void dequeue(queue_t *queue) {
+	queue->head = (queue->head + 1) % DCC_QUEUE_SIZE;
+	queue->count--;
+}
+
+
+/**
+  * @brief
+  * 	Is the DCC running (TIM16 enabled)?
+  * @retval
+  * 	TRUE running, FALSE stopped by DCC_stop()
+  */
+static int running(void) {
+	return READ_BIT(htim16.Instance->CR1, TIM_CR1_CEN) != 0;
+}
+
+
+/**
+  * @brief
+  * 	Wakes up the DCC thread if it waits for something to send.
+  *
+  * 	Has to be called with DCC_MutexID.
+  * @retval
+  * 	None
+  */
+static void kick(void) {
+	if (idle) {
+		idle = FALSE;
+		osSemaphoreRelease(DCC_SemaphoreID);
 	}
 }
 
 
 static void prepare_packet(int delay) {
 	int j;
+	int count;
+	uint32_t lead;
 
 	// calculate checksum
 	packet[len] = 0;
@@ -530,76 +957,112 @@ static void prepare_packet(int delay) {
 		packet[len] ^= packet[j];
 	}
 
+	count = encode_packet(&period[1], packet, len+1);
+
+	// track bandwidth
+	for (j=1; j<=count; j++) {
+		track_time += period[j] + 1;
+	}
+	track_packets++;
+
 	osMutexRelease(DCC_MutexID);
 
-	// min. time to the next packet 18*2*58 us = 2 ms
-	osDelay(delay);
-	HAL_NVIC_DisableIRQ(TIM1_UP_TIM16_IRQn);
-	packet_len = len+1;
-	byte_count = 0;
-	bit_count  = 9;
-	HAL_NVIC_EnableIRQ(TIM1_UP_TIM16_IRQn);
-}
+	if (delay) {
+		// min. time between 2 packets to the same address
+		osDelay(delay);
+	}
 
+	// not too close to the next update event, the counter does not move
+	// if DCC is stopped meanwhile
+	for (j=0; j<DCC_UPDATE_WAIT; j++) {
+		if (!running()) {
+			return;	// the packet is lost
+		}
+		if (__HAL_TIM_GET_COUNTER(&htim16) + 4 <= __HAL_TIM_GET_AUTORELOAD(&htim16)) {
+			break;
+		}
+	}
+	__disable_irq();
+	// The next CC1 (start of the next period) writes pins[2 - CNDTR]. The
+	// first ARR written on the next update is for the period after. The
+	// packet has to start with the first half, if not insert a lead-in.
+	if (hdma_tim16_ch1.Instance->CNDTR == 2) {
+		lead = 1;
+	} else {
+		lead = 0;
+	}
+	HAL_DMA_Start_IT(&hdma_tim16_up, (uint32_t)&period[1-lead],
+			(uint32_t)&htim16.Instance->ARR, count+lead);
+	__HAL_TIM_ENABLE_DMA(&htim16, TIM_DMA_UPDATE);
+	__enable_irq();
+}
 
-// Callbacks
-// *********
 
 /**
   * @brief
-  * 	Period elapsed ISR for TIM16
+  * 	Encodes the packet into half bit periods (ARR values).
   *
-  *	 	The waveform for the packet is created here.
-  *	 	The bit pattern is in the packet array.
-  *	 	byte_count, packet_len, bit_count are global variables.
-  *	 	Startbit is 0, highest bit first.
-  * 	Ignore the shared TIM1 UP.
+  *	 	Preamble (DCC_PREAMBLE_BITS 1 bits), for each byte the startbit 0
+  *	 	and the highest bit first. Both halves of a bit have the
+  *	 	same period. The last period is the first half of the packet end
+  *	 	bit, the ARR stays there (preamble) till the next packet.
+  *	 	tools/dccdecode.py decodes this buffer on the host.
+  * @param[out]
+  * 	period  ARR values, max. DCC_PREAMBLE_BITS*2 + count*18 + 1
+  * @param[in]
+  * 	data    packet including the checksum
+  * @param[in]
+  * 	count   number of bytes
   * @retval
-  * 	None
+  * 	number of periods
   */
-void DCC_TIM16_PeriodElapsedIRQHandler() {
-    __HAL_TIM_CLEAR_IT(&htim16, TIM_IT_UPDATE);
-
-    if (half_bit) {
-    	half_bit = FALSE;
-    	HAL_GPIO_WritePin(D1_GPIO_Port, D1_Pin, 0);
-    	HAL_GPIO_WritePin(D0_GPIO_Port, D0_Pin, 1);
-    	return;
-    } else {
-    	half_bit = TRUE;
-    	HAL_GPIO_WritePin(D0_GPIO_Port, D0_Pin, 0);
-    	HAL_GPIO_WritePin(D1_GPIO_Port, D1_Pin, 1);
-    }
-
-    if (byte_count < packet_len) {
-		// packet not finished
-		if (bit_count-- == 9) {
-			// start bit always 0
-			__HAL_TIM_SET_AUTORELOAD(&htim16, TIME_0BIT_HALF_PERIOD);
-		} else {
-			// get bit
-			if ((packet[byte_count] >> bit_count) & 0x01) {
-				// 1
-				__HAL_TIM_SET_AUTORELOAD(&htim16, TIME_1BIT_HALF_PERIOD);
+static int encode_packet(uint16_t *period, const uint8_t *data, int count) {
+	int i;
+	int bit;
+	int n = 0;
+	uint16_t half;
+
+	for (i=0; i<DCC_PREAMBLE_BITS*2; i++) {
+		period[n++] = TIME_1BIT_HALF_PERIOD;
+	}
+	for (i=0; i<count; i++) {
+		// start bit always 0
+		period[n++] = TIME_0BIT_HALF_PERIOD;
+		period[n++] = TIME_0BIT_HALF_PERIOD;
+		for (bit=7; bit>=0; bit--) {
+			if ((data[i] >> bit) & 0x01) {
+				half = TIME_1BIT_HALF_PERIOD;
 			} else {
-				// 0
-				__HAL_TIM_SET_AUTORELOAD(&htim16, TIME_0BIT_HALF_PERIOD);
+				half = TIME_0BIT_HALF_PERIOD;
 			}
+			period[n++] = half;
+			period[n++] = half;
 		}
-		if (bit_count == 0) {
-			// byte finished
-			bit_count = 9;
-			byte_count++;
-			if (byte_count >= packet_len) {
-				// last byte -> ready for next packet
-				osSemaphoreRelease(DCC_SemaphoreID);
-			}
-		}
-	} else {
-		// packet finished -> write only 1s (preamble)
-		__HAL_TIM_SET_AUTORELOAD(&htim16, TIME_1BIT_HALF_PERIOD);
 	}
+	// packet end bit
+	period[n++] = TIME_1BIT_HALF_PERIOD;
+	return n;
+}
+
+
+// Callbacks
+// *********
 
+/**
+  * @brief
+  * 	DMA transfer complete callback for the ARR periods
+  *
+  *	 	The DMA request is disabled, otherwise a pending request would
+  *	 	transfer the first period of the next packet too early.
+  * @param[in]
+  * 	hdma  DMA handle
+  * @retval
+  * 	None
+  */
+static void dma_complete(DMA_HandleTypeDef *hdma) {
+	__HAL_TIM_DISABLE_DMA(&htim16, TIM_DMA_UPDATE);
+	// ready for next packet
+	osSemaphoreRelease(DCC_SemaphoreID);
 }
 
 #endif // DCC
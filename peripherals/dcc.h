@@ -11,6 +11,12 @@
 #define DCC_MAX_PACKET_LENGTH 		20
 #define DCC_MAX_LOCO_SLOTS			10
 #define DCC_FUNCTION_REPETITION 	5
+#define DCC_SPEED_REPETITION 		3
+#define DCC_ACCESSORY_REPETITION 	2
+#define DCC_QUEUE_SIZE				16		// commands per queue
+#define DCC_REFRESH_SHARE			4		// min. every 4th packet is a refresh
+#define DCC_PREAMBLE_BITS			16
+#define DCC_ADDRESS_GAP				5		// ms between 2 packets to the same address
 
 #define DCC_COMMAND_SPEED_FUNCTION	0x3C
 #define DCC_COMMAND_SPEED_128		0x3F
@@ -32,7 +38,6 @@ typedef struct DCC_LocoSlot_t {
 	uint8_t		direction;
 	uint32_t	function;
 	uint32_t	function_new;
-	uint32_t	function_repetition;
 
 } DCC_LocoSlot_t;
 
@@ -51,8 +56,7 @@ void DCC_setFunction(int slot, int function);
 void DCC_resetFunction(int slot, int function);
 int DCC_getFunction(int slot);
 void DCC_controlAccessory(int address, int activate_D, int direction_R);
-
-void DCC_TIM16_PeriodElapsedIRQHandler();
+uint64_t DCC_printStats(uint64_t forth_stack);
 
 #endif // DCC
 
@@ -0,0 +1,696 @@
+/**
+ *  @brief
+ *      Index of the Forth dictionary for the reverse lookup
+ *      code address -> word and for the name lookup (find, wordlists).
+ *
+ *      A dictionary header is the link (4 bytes), the flags (2 bytes) and the
+ *      name (counted string), it is followed by the code. The code of a word
+ *      ends with the next header in the same region (core, flash or RAM
+ *      dictionary) or at the dictionary pointer of the region. So the sorted
+ *      header addresses are a code range index, the lookup is a binary
+ *      search.
+ *
+ *      The names are hashed together with the wordlist (wid) into hash
+ *      chains, each wordlist has its own chains. The wordlist tags are the
+ *      ones of wordlists.fs: words created after the FORTH-WORDLIST have the
+ *      wid in the cell before the header (wtag), the older words belong to
+ *      the FORTH-WORDLIST. Tags and wordlists in flash survive a reset, the
+ *      index is built from the dictionary.
+ *      If several words match, the newest (highest address) is found, the
+ *      same as the linear search of the core find.
+ *
+ *      The index is kept up to date on every lookup: new RAM words change
+ *      the chain start, new flash words are linked to the last header of the
+ *      chain, only the new headers are added. If the dictionary pointers
+ *      have shrunk (forget, eraseflash) or the chain does not match, the
+ *      index is built again.
+ *  @file
+ *      dict.c
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-19
+ *  @remark
+ *      Language: C, STM32CubeIDE GCC
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ *
+ *      Mecrsip-Cube is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with Mecrsip-Cube. If not, see http://www.gnu.org/licenses/.
+ */
+
+// System include files
+// ********************
+#include "cmsis_os.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Application include files
+// *************************
+#include "app_common.h"
+#include "main.h"
+#include "dict.h"
+#include "myassert.h"
+
+
+#define DICT_FLASH_START	0x08040000	// FlashDictionaryAnfang
+#define DICT_FLASH_END		0x08060000
+#define DICT_RAM_START		0x20000000	// RamAnfang
+#define DICT_RAM_END		0x20010000
+#define DICT_LINK_ERASED	0xFFFFFFFF
+#define DICT_SPARE			64			// new words before the index is allocated again
+#define DICT_BUCKETS_BITS	10
+#define DICT_BUCKETS		(1 << DICT_BUCKETS_BITS)	// hash chains
+#define DICT_END			0xFFFF		// end of the hash chain
+#define DICT_FLAG_INVISIBLE	0xFFFF		// Flag_invisible, erased flash
+#define DICT_WTAG_MASK		(~3)		// wtag = wid | wflags
+
+// dictionary regions
+#define DICT_NONE			0			// C code, data
+#define DICT_CORE			1
+#define DICT_FLASH			2
+#define DICT_RAM			3
+
+
+// Private typedefs
+// ****************
+typedef struct {
+	uint32_t header;
+	uint16_t next;				// next entry in the hash chain
+} DICT_Name_t;
+
+
+// Private function prototypes
+// ***************************
+static void update(uint32_t dictionary);
+static int build(uint32_t dictionary);
+static int append(uint32_t dictionary);
+static int add(uint32_t header);
+static uint32_t search(const uint8_t *str, uint32_t count, uint32_t wid, uint32_t dictionary);
+static int match(uint32_t header, const uint8_t *str, uint32_t count, uint32_t wid);
+static uint32_t hash(const uint8_t *str, uint32_t count, uint32_t wid);
+static uint32_t header_wid(uint32_t header);
+static uint32_t *context(void);
+static void default_order(uint32_t *search_order);
+static int chain_next(uint32_t *header);
+static int region(uint32_t addr);
+static int compare_address(const void *a, const void *b);
+
+// Global Variables
+// ****************
+extern uint32_t Dictionarypointer;		// Forth/mecrisp.s
+extern uint32_t ZweitDictionaryPointer;
+extern void Forth(void);				// code after the core dictionary
+
+// Hardware resources
+// ******************
+
+// RTOS resources
+// **************
+static osMutexId_t DICT_MutexID;
+static const osMutexAttr_t DICT_MutexAttr = {
+		NULL,				// no name required
+		osMutexPrioInherit,	// attr_bits
+		NULL,				// memory for control block
+		0U					// size for control block
+};
+
+
+// Private Variables
+// *****************
+static uint32_t *index_header;		// sorted header addresses
+static DICT_Name_t *index_name;		// hash chain entries
+static int index_count;
+static int index_size;
+static uint32_t index_top[4];		// highest header in the region
+static uint16_t bucket[DICT_BUCKETS];	// first entry of the hash chains
+
+static uint32_t chain_start;		// dictionarystart of the index
+static uint32_t chain_last;			// last header of the chain (flash or core)
+static uint32_t flash_here;			// dictionary pointers
+static uint32_t ram_here;
+static uint32_t core_end;
+
+static uint32_t forth_wid;			// 0 no wordlists, words above are tagged
+static uint32_t root_wid;
+static uint32_t order[2][DICT_ORDER_MAX+1];	// search order for flash and RAM, 0 terminated
+
+
+// Public Functions
+// ****************
+
+/**
+ *  @brief
+ *      Initializes the dictionary index, it is built on the first lookup.
+ *  @return
+ *      None
+ */
+void DICT_init(void) {
+	DICT_MutexID = osMutexNew(&DICT_MutexAttr);
+	ASSERT_fatal(DICT_MutexID != NULL, ASSERT_MUTEX_CREATION, __get_PC());
+}
+
+
+/**
+ *  @brief
+ *      Finds the word a code address belongs to.
+ *  @param[in]
+ *      addr        code address (Thumb bit is ignored)
+ *  @param[in]
+ *      dictionary  start of the dictionary chain (dictionarystart)
+ *  @return
+ *      header address, 0 not in a Forth word (e.g. C code)
+ */
+uint32_t DICT_addrToHeader(uint32_t addr, uint32_t dictionary) {
+	uint32_t found = 0;
+	int low, high, mid;
+
+	addr &= ~1;
+	osMutexAcquire(DICT_MutexID, osWaitForever);
+	update(dictionary);
+
+	if (index_count > 0 && region(addr) != DICT_NONE && addr >= index_header[0]) {
+		// the last header below or at the address
+		low = 0;
+		high = index_count - 1;
+		while (low < high) {
+			mid = (low + high + 1) / 2;
+			if (index_header[mid] <= addr) {
+				low = mid;
+			} else {
+				high = mid - 1;
+			}
+		}
+		if (region(index_header[low]) == region(addr)) {
+			found = index_header[low];
+		}
+	}
+
+	osMutexRelease(DICT_MutexID);
+	return found;
+}
+
+
+/**
+ *  @brief
+ *      Registers the wordlists of wordlists.fs and sets the default search
+ *      order for both compile modes (FORTH-WORDLIST FORTH-WORDLIST
+ *      ROOT-WORDLIST).
+ *  @param[in]
+ *      forth  wid of the FORTH-WORDLIST, the words above are tagged
+ *  @param[in]
+ *      root   wid of the ROOT-WORDLIST
+ *  @return
+ *      None
+ */
+void DICT_initWordlists(uint32_t forth, uint32_t root) {
+	osMutexAcquire(DICT_MutexID, osWaitForever);
+	if (forth != forth_wid) {
+		// the wordlist of the words has changed, build the hash chains again
+		vPortFree(index_header);
+		index_header = NULL;
+		vPortFree(index_name);
+		index_name = NULL;
+	}
+	forth_wid = forth;
+	root_wid = root;
+	osMutexRelease(DICT_MutexID);
+
+	default_order(order[0]);
+	default_order(order[1]);
+}
+
+
+/**
+ *  @brief
+ *      Finds a word in a wordlist.
+ *  @param[in]
+ *      str         name
+ *  @param[in]
+ *      count       length of the name
+ *  @param[in]
+ *      wid         wordlist, 0 for all words if there are no wordlists
+ *  @param[in]
+ *      dictionary  start of the dictionary chain (dictionarystart)
+ *  @return
+ *      header address, 0 not found
+ */
+uint32_t DICT_searchWordlist(const uint8_t *str, uint32_t count, uint32_t wid, uint32_t dictionary) {
+	uint32_t found;
+
+	osMutexAcquire(DICT_MutexID, osWaitForever);
+	update(dictionary);
+	found = search(str, count, wid, dictionary);
+	osMutexRelease(DICT_MutexID);
+
+	return found;
+}
+
+
+/**
+ *  @brief
+ *      Finds a word in the search order of the compile mode. Without
+ *      wordlists the whole dictionary is searched like the core find.
+ *  @param[in]
+ *      str         name
+ *  @param[in]
+ *      count       length of the name
+ *  @param[in]
+ *      dictionary  start of the dictionary chain (dictionarystart)
+ *  @return
+ *      header address, 0 not found
+ */
+uint32_t DICT_findInOrder(const uint8_t *str, uint32_t count, uint32_t dictionary) {
+	uint32_t found = 0;
+	uint32_t *wid;
+
+	osMutexAcquire(DICT_MutexID, osWaitForever);
+	update(dictionary);
+	if (forth_wid == 0) {
+		found = search(str, count, 0, dictionary);
+	} else {
+		for (wid = context(); *wid != 0 && found == 0; wid++) {
+			found = search(str, count, *wid, dictionary);
+		}
+	}
+	osMutexRelease(DICT_MutexID);
+
+	return found;
+}
+
+
+/**
+ *  @brief
+ *      Search order of the compile mode (see context in wordlists.fs).
+ *  @return
+ *      wids, the first is searched first, 0 terminated
+ */
+uint32_t *DICT_context(void) {
+	return context();
+}
+
+
+/**
+ *  @brief
+ *      Sets the search order of the compile mode.
+ *  @param[in]
+ *      n    number of wordlists, -1 for the default order
+ *  @param[in]
+ *      wid  wordlists, the first is searched first
+ *  @return
+ *      number of wids to drop, -1 order overflow
+ */
+int DICT_setOrder(int n, const uint32_t *wid) {
+	uint32_t *search_order = context();
+	int i;
+
+	if (n > DICT_ORDER_MAX) {
+		return -1;
+	}
+	if (n < 0) {
+		default_order(search_order);
+		return 0;
+	}
+	for (i = 0; i < n; i++) {
+		search_order[i] = wid[i];
+	}
+	search_order[n] = 0;
+	return n;
+}
+
+
+// Private Functions
+// *****************
+
+/**
+ *  @brief
+ *      Brings the index up to date.
+ *  @param[in]
+ *      dictionary  start of the dictionary chain
+ *  @return
+ *      None
+ */
+static void update(uint32_t dictionary) {
+	uint32_t ram, flash, last;
+	int rebuild;
+
+	// the pointers are swapped by compiletoflash and compiletoram
+	if (Dictionarypointer >= DICT_RAM_START) {
+		ram = Dictionarypointer;
+		flash = ZweitDictionaryPointer;
+	} else {
+		ram = ZweitDictionaryPointer;
+		flash = Dictionarypointer;
+	}
+
+	rebuild = index_header == NULL || ram < ram_here || flash < flash_here;
+	core_end = (uint32_t) Forth & ~1;
+	ram_here = ram;
+	flash_here = flash;
+
+	if (! rebuild && dictionary == chain_start) {
+		last = chain_last;
+		if (! chain_next(&last)) {
+			// nothing new
+			return;
+		}
+	}
+
+	if (rebuild || region(dictionary) != region(chain_start) || append(dictionary) < 0) {
+		build(dictionary);
+	}
+	chain_start = dictionary;
+}
+
+
+/**
+ *  @brief
+ *      Builds the index from scratch.
+ *  @param[in]
+ *      dictionary  start of the dictionary chain
+ *  @return
+ *      number of headers, -1 not enough memory
+ */
+static int build(uint32_t dictionary) {
+	uint32_t header;
+	int n;
+
+	vPortFree(index_header);
+	index_header = NULL;
+	vPortFree(index_name);
+	index_name = NULL;
+	index_count = 0;
+	index_size = 0;
+	memset(index_top, 0, sizeof(index_top));
+	memset(bucket, 0xFF, sizeof(bucket));
+
+	n = 1;
+	for (header = dictionary; chain_next(&header); ) {
+		n++;
+	}
+	if (n + DICT_SPARE >= DICT_END) {
+		return -1;
+	}
+	index_header = pvPortMalloc((n + DICT_SPARE) * sizeof(uint32_t));
+	index_name = pvPortMalloc((n + DICT_SPARE) * sizeof(DICT_Name_t));
+	if (index_header == NULL || index_name == NULL) {
+		vPortFree(index_header);
+		index_header = NULL;
+		vPortFree(index_name);
+		index_name = NULL;
+		return -1;
+	}
+	index_size = n + DICT_SPARE;
+
+	header = dictionary;
+	do {
+		add(header);
+	} while (chain_next(&header));
+	chain_last = header;
+	qsort(index_header, index_count, sizeof(uint32_t), compare_address);
+
+	return index_count;
+}
+
+
+/**
+ *  @brief
+ *      Adds the new headers: the RAM words from the chain start down to the
+ *      newest RAM word of the index and the flash words linked to the last
+ *      header of the chain.
+ *  @param[in]
+ *      dictionary  start of the dictionary chain
+ *  @return
+ *      number of headers, -1 the chain does not match the index
+ */
+static int append(uint32_t dictionary) {
+	uint32_t header, ram_top;
+	int count = index_count;
+
+	ram_top = index_top[DICT_RAM];
+	header = dictionary;
+	while (region(header) == DICT_RAM && header > ram_top) {
+		if (add(header) < 0 || ! chain_next(&header)) {
+			return -1;
+		}
+	}
+	if (ram_top != 0 && header != ram_top) {
+		return -1;
+	}
+
+	header = chain_last;
+	while (chain_next(&header)) {
+		if (region(header) != DICT_FLASH || add(header) < 0) {
+			return -1;
+		}
+	}
+	chain_last = header;
+
+	if (index_count > count) {
+		qsort(index_header, index_count, sizeof(uint32_t), compare_address);
+	}
+	return index_count;
+}
+
+
+/**
+ *  @brief
+ *      Adds a header to the index and to its hash chain.
+ *  @param[in]
+ *      header  header address
+ *  @return
+ *      number of headers, -1 not enough memory
+ */
+static int add(uint32_t header) {
+	uint32_t *new_header;
+	DICT_Name_t *new_name;
+	uint8_t *name;
+	uint32_t h;
+
+	if (index_count >= index_size) {
+		if (index_size + DICT_SPARE >= DICT_END) {
+			return -1;
+		}
+		new_header = pvPortMalloc((index_size + DICT_SPARE) * sizeof(uint32_t));
+		new_name = pvPortMalloc((index_size + DICT_SPARE) * sizeof(DICT_Name_t));
+		if (new_header == NULL || new_name == NULL) {
+			vPortFree(new_header);
+			vPortFree(new_name);
+			return -1;
+		}
+		memcpy(new_header, index_header, index_count * sizeof(uint32_t));
+		memcpy(new_name, index_name, index_count * sizeof(DICT_Name_t));
+		vPortFree(index_header);
+		vPortFree(index_name);
+		index_header = new_header;
+		index_name = new_name;
+		index_size += DICT_SPARE;
+	}
+
+	name = (uint8_t *) (header + DICT_NAME_OFFSET);
+	h = hash(name + 1, name[0], header_wid(header));
+	index_header[index_count] = header;
+	index_name[index_count].header = header;
+	index_name[index_count].next = bucket[h];
+	bucket[h] = index_count;
+	if (header > index_top[region(header)]) {
+		index_top[region(header)] = header;
+	}
+	return ++index_count;
+}
+
+
+/**
+ *  @brief
+ *      Finds the newest visible word with the name in the wordlist.
+ *  @return
+ *      header address, 0 not found
+ */
+static uint32_t search(const uint8_t *str, uint32_t count, uint32_t wid, uint32_t dictionary) {
+	uint32_t header, found = 0;
+	int i;
+
+	if (index_header == NULL) {
+		// no memory for the index, linear search
+		header = dictionary;
+		do {
+			if (header > found && match(header, str, count, wid)) {
+				found = header;
+			}
+		} while (chain_next(&header));
+		return found;
+	}
+
+	for (i = bucket[hash(str, count, wid)]; i != DICT_END; i = index_name[i].next) {
+		header = index_name[i].header;
+		if (header > found && match(header, str, count, wid)) {
+			found = header;
+		}
+	}
+	return found;
+}
+
+
+/**
+ *  @brief
+ *      Is the word visible, in the wordlist and has the name (case
+ *      insensitive like compare)?
+ *  @return
+ *      TRUE match
+ */
+static int match(uint32_t header, const uint8_t *str, uint32_t count, uint32_t wid) {
+	const uint8_t *name = (uint8_t *) (header + DICT_NAME_OFFSET);
+	uint8_t a, b;
+	uint32_t i;
+
+	if (name[0] != count || *(uint16_t *) (header + 4) == DICT_FLAG_INVISIBLE
+			|| header_wid(header) != wid) {
+		return FALSE;
+	}
+	for (i = 0; i < count; i++) {
+		a = name[i+1];
+		b = str[i];
+		if (a != b) {
+			if (a >= 'A' && a <= 'Z') {
+				a += 'a' - 'A';
+			}
+			if (b >= 'A' && b <= 'Z') {
+				b += 'a' - 'A';
+			}
+			if (a != b) {
+				return FALSE;
+			}
+		}
+	}
+	return TRUE;
+}
+
+
+/**
+ *  @brief
+ *      Hash chain of the name (lowercase, FNV-1a) in the wordlist.
+ *  @return
+ *      hash chain (bucket)
+ */
+static uint32_t hash(const uint8_t *str, uint32_t count, uint32_t wid) {
+	uint32_t h = 2166136261U ^ wid;
+	uint8_t c;
+
+	while (count--) {
+		c = *str++;
+		if (c >= 'A' && c <= 'Z') {
+			c += 'a' - 'A';
+		}
+		h = (h ^ c) * 16777619U;
+	}
+	return (h * 2654435761U) >> (32 - DICT_BUCKETS_BITS);
+}
+
+
+/**
+ *  @brief
+ *      Wordlist of the word (see lfa>wtag in wordlists.fs).
+ *  @return
+ *      wid, 0 if there are no wordlists
+ */
+static uint32_t header_wid(uint32_t header) {
+	if (forth_wid == 0) {
+		return 0;
+	}
+	if (header < forth_wid) {
+		// created before wordlists.fs, no wtag
+		return forth_wid;
+	}
+	return *(uint32_t *) (header - 4) & DICT_WTAG_MASK;
+}
+
+
+/**
+ *  @brief
+ *      Search order of the compile mode.
+ *  @return
+ *      wids, 0 terminated
+ */
+static uint32_t *context(void) {
+	return order[Dictionarypointer >= DICT_RAM_START];
+}
+
+
+/**
+ *  @brief
+ *      Sets the default search order FORTH-WORDLIST FORTH-WORDLIST
+ *      ROOT-WORDLIST, empty without wordlists.
+ *  @return
+ *      None
+ */
+static void default_order(uint32_t *search_order) {
+	if (forth_wid == 0) {
+		search_order[0] = 0;
+		return;
+	}
+	search_order[0] = forth_wid;
+	search_order[1] = forth_wid;
+	search_order[2] = root_wid;
+	search_order[3] = 0;
+}
+
+
+/**
+ *  @brief
+ *      Next header in the dictionary chain (see dictionarynext).
+ *  @param[in, out]
+ *      header  current header, next header
+ *  @return
+ *      FALSE end of the chain
+ */
+static int chain_next(uint32_t *header) {
+	uint32_t link = *(uint32_t *) *header;
+
+	if (link == DICT_LINK_ERASED || *(uint8_t *) (link + DICT_NAME_OFFSET) == 0xFF) {
+		return FALSE;
+	}
+	*header = link;
+	return TRUE;
+}
+
+
+/**
+ *  @brief
+ *      Dictionary region of an address.
+ *  @return
+ *      DICT_CORE, DICT_FLASH, DICT_RAM or DICT_NONE
+ */
+static int region(uint32_t addr) {
+	if (addr >= DICT_FLASH_START && addr < DICT_FLASH_END) {
+		return (flash_here == 0 || addr < flash_here) ? DICT_FLASH : DICT_NONE;
+	}
+	if (addr >= DICT_RAM_START && addr < DICT_RAM_END) {
+		return (ram_here == 0 || addr < ram_here) ? DICT_RAM : DICT_NONE;
+	}
+	if (addr < core_end && addr >= FLASH_BASE) {
+		return DICT_CORE;
+	}
+	return DICT_NONE;
+}
+
+
+/**
+ *  @brief
+ *      qsort() compare function for addresses, ascending.
+ */
+static int compare_address(const void *a, const void *b) {
+	uint32_t x = *(const uint32_t *) a;
+	uint32_t y = *(const uint32_t *) b;
+
+	return (x > y) - (x < y);
+}
@@ -0,0 +1,45 @@
+/**
+ *  @brief
+ *      Index of the Forth dictionary for the reverse lookup
+ *      code address -> word and for the name lookup (find, wordlists).
+ *
+ *  @file
+ *      dict.h
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-19
+ *  @remark
+ *      Language: C, STM32CubeIDE GCC
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ *
+ *      Mecrsip-Cube is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with Mecrsip-Cube. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef INC_DICT_H_
+#define INC_DICT_H_
+
+#define DICT_NAME_OFFSET	6		// link (4 bytes), flags (2 bytes), name
+#define DICT_ORDER_MAX		6		// wordlists in the search order (#vocs)
+
+void DICT_init(void);
+uint32_t DICT_addrToHeader(uint32_t addr, uint32_t dictionary);
+void DICT_initWordlists(uint32_t forth, uint32_t root);
+uint32_t DICT_searchWordlist(const uint8_t *str, uint32_t count, uint32_t wid, uint32_t dictionary);
+uint32_t DICT_findInOrder(const uint8_t *str, uint32_t count, uint32_t dictionary);
+uint32_t *DICT_context(void);
+int DICT_setOrder(int n, const uint32_t *wid);
+
+#endif /* INC_DICT_H_ */
@@ -0,0 +1,892 @@
+/**
+ *  @brief
+ *      Directory entry cache for the FAT volumes.
+ *
+ *      A directory is read once with f_readdir() (long file names, every
+ *      item rescans the directory clusters) and the entries are kept in RAM,
+ *      the key is the volume (mount ID) and the start cluster of the
+ *      directory. ls, f_readdir, f_findfirst/f_findnext, f_stat and
+ *      dir-entries are served from the cache.
+ *
+ *      The entries and names of all cached directories share one static
+ *      pool (6 KiB entries, 10 KiB names): a directory with up to 512 items
+ *      (about 250 with 25 character long names) is cached, the least
+ *      recently used directories are dropped to make room. A directory too
+ *      large for the whole pool is remembered (volume generation), it is
+ *      not read again till the volume changes.
+ *
+ *      Every sector written to a volume (file data, FAT, directory) drops
+ *      the cached directories of the volume (see user_diskio.c), while the
+ *      FatFs window is dirty the cache is bypassed. A DIR served from the
+ *      cache stays rewound, if the cache entry is dropped in between the
+ *      DIR is positioned and read by FatFs.
+ *  @file
+ *      dircache.c
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-19
+ *  @remark
+ *      Language: C, STM32CubeIDE GCC
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ *
+ *      Mecrsip-Cube is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with Mecrsip-Cube. If not, see http://www.gnu.org/licenses/.
+ */
+
+// System include files
+// ********************
+#include "cmsis_os.h"
+#include <string.h>
+
+// Application include files
+// *************************
+#include "app_common.h"
+#include "main.h"
+#include "dircache.h"
+#include "myassert.h"
+
+
+// Defines
+// *******
+#define DIRCACHE_SLOTS			4			// cached directories (all volumes)
+#define DIRCACHE_ITERATORS		8			// open DIRs served by the cache
+#define DIRCACHE_LARGE			4			// remembered too large directories
+#define DIRCACHE_ENTRIES		512			// entry pool, all slots
+#define DIRCACHE_NAMES			0x2800		// name pool, all slots
+
+
+// Private typedefs
+// ****************
+typedef struct {
+	FSIZE_t	fsize;
+	WORD	fdate;
+	WORD	ftime;
+	BYTE	fattrib;
+	uint16_t name;			// offset in the slot names: fname, 0, altname, 0
+} DIRCACHE_Entry_t;
+
+typedef struct {
+	FATFS *fs;				// NULL free slot
+	WORD id;				// mount ID
+	DWORD sclust;			// start cluster of the directory
+	uint32_t generation;	// volume generation
+	uint32_t tag;			// fill number, iterators check it
+	uint32_t used;			// LRU
+	int first;				// first entry in the entry pool
+	int entries;
+	int names;				// names in the name pool
+	int names_len;
+} DIRCACHE_Slot_t;
+
+typedef struct {
+	FATFS *fs;				// NULL free
+	WORD id;				// mount ID
+	DWORD sclust;			// start cluster of the directory
+	uint32_t generation;	// volume generation
+} DIRCACHE_Large_t;
+
+typedef struct {
+	DIR *dp;				// NULL free iterator
+	int slot;
+	uint32_t tag;
+	int index;				// next entry
+	uint32_t used;			// LRU
+} DIRCACHE_Iter_t;
+
+
+// Private function prototypes
+// ***************************
+static int valid(const DIRCACHE_Slot_t *s);
+static int lookup(const DIR *dp);
+static int fill(DIR *dp);
+static int attach(DIR *dp);
+static void free_slot(DIRCACHE_Slot_t *s);
+static int add_entry(DIRCACHE_Slot_t *s, const FILINFO *fno);
+static int make_room(DIRCACHE_Slot_t *s, int names_len);
+static void compact(void);
+static int too_large(const DIR *dp);
+static void set_too_large(const DIR *dp, uint32_t gen);
+static DIRCACHE_Iter_t *iter_get(const DIR *dp);
+static void iter_new(DIR *dp, int slot);
+static void iter_drop(const DIR *dp);
+static void iter_release(DIRCACHE_Iter_t *it);
+static FRESULT next(DIR *dp, FILINFO *fno);
+static void copy_entry(const DIRCACHE_Slot_t *s, const DIRCACHE_Entry_t *e, FILINFO *fno);
+static int match(const char *pat, const char *name);
+static int same_name(const char *a, const char *b);
+
+// Global Variables
+// ****************
+
+// RTOS resources
+// **************
+
+static osMutexId_t DIRCACHE_MutexID;
+static const osMutexAttr_t DIRCACHE_MutexAttr = {
+		NULL,				// no name required
+		osMutexPrioInherit,	// attr_bits
+		NULL,				// memory for control block
+		0U					// size for control block
+};
+
+
+// Hardware resources
+// ******************
+
+
+// Private Variables
+// *****************
+static DIRCACHE_Slot_t slot[DIRCACHE_SLOTS];
+static DIRCACHE_Entry_t entry[DIRCACHE_ENTRIES];	// 6 KiB, not on the heap
+static char names[DIRCACHE_NAMES];					// 10 KiB
+static int entries_top;				// next free entry
+static int names_top;				// next free name byte
+static DIRCACHE_Large_t large[DIRCACHE_LARGE];
+static int large_next;
+static DIRCACHE_Iter_t iter[DIRCACHE_ITERATORS];
+static volatile uint32_t generation[_VOLUMES];
+static uint32_t tags;
+static uint32_t uses;
+static FILINFO info;
+
+
+// Public Functions
+// ****************
+
+/**
+ *  @brief
+ *      Initializes the directory cache.
+ *  @return
+ *      None
+ */
+void DIRCACHE_init(void) {
+	DIRCACHE_MutexID = osMutexNew(&DIRCACHE_MutexAttr);
+	ASSERT_fatal(DIRCACHE_MutexID != NULL, ASSERT_MUTEX_CREATION, __get_PC());
+}
+
+
+/**
+ *  @brief
+ *      Drops the cached directories of the volume, called by the disk write
+ *      functions (no mutex, no FatFs calls).
+ *  @param[in]
+ *      volume  0 flash drive, 1 SD drive
+ *  @return
+ *      None
+ */
+void DIRCACHE_invalidate(int volume) {
+	if (volume >= 0 && volume < _VOLUMES) {
+		generation[volume]++;
+	}
+}
+
+
+/**
+ *  @brief
+ *      Opens a directory (f_opendir) and reads the entries into the cache.
+ *  @param[in]
+ *      dp      directory object
+ *  @param[in]
+ *      path    directory name
+ *  @return
+ *      FRESULT
+ */
+FRESULT DIRCACHE_opendir(DIR* dp, const TCHAR* path) {
+	FRESULT fr;
+	int s;
+
+	osMutexAcquire(DIRCACHE_MutexID, osWaitForever);
+	iter_drop(dp);
+	fr = f_opendir(dp, path);
+	dp->pat = NULL;
+	if (fr == FR_OK) {
+		s = attach(dp);
+		if (s >= 0) {
+			iter_new(dp, s);
+		}
+	}
+	osMutexRelease(DIRCACHE_MutexID);
+	return fr;
+}
+
+
+/**
+ *  @brief
+ *      Closes the directory (f_closedir).
+ *  @param[in]
+ *      dp      directory object
+ *  @return
+ *      FRESULT
+ */
+FRESULT DIRCACHE_closedir(DIR* dp) {
+	FRESULT fr;
+
+	osMutexAcquire(DIRCACHE_MutexID, osWaitForever);
+	iter_drop(dp);
+	fr = f_closedir(dp);
+	osMutexRelease(DIRCACHE_MutexID);
+	return fr;
+}
+
+
+/**
+ *  @brief
+ *      Reads the next directory item (f_readdir).
+ *  @param[in]
+ *      dp      directory object
+ *  @param[out]
+ *      fno     file information, NULL rewinds the directory
+ *  @return
+ *      FRESULT
+ */
+FRESULT DIRCACHE_readdir(DIR* dp, FILINFO* fno) {
+	const TCHAR *pat;
+	FRESULT fr;
+
+	osMutexAcquire(DIRCACHE_MutexID, osWaitForever);
+	pat = dp->pat;
+	dp->pat = NULL;
+	fr = next(dp, fno);
+	dp->pat = pat;
+	osMutexRelease(DIRCACHE_MutexID);
+	return fr;
+}
+
+
+/**
+ *  @brief
+ *      Opens a directory and reads the first item matched (f_findfirst).
+ *  @param[in]
+ *      dp      directory object
+ *  @param[out]
+ *      fno     file information
+ *  @param[in]
+ *      path    directory name
+ *  @param[in]
+ *      pattern matching pattern, has to be valid till the directory is closed
+ *  @return
+ *      FRESULT
+ */
+FRESULT DIRCACHE_findfirst(DIR* dp, FILINFO* fno, const TCHAR* path, const TCHAR* pattern) {
+	FRESULT fr;
+
+	fr = DIRCACHE_opendir(dp, path);
+	dp->pat = pattern;
+	if (fr == FR_OK) {
+		fr = DIRCACHE_findnext(dp, fno);
+	}
+	return fr;
+}
+
+
+/**
+ *  @brief
+ *      Reads the next item matched (f_findnext).
+ *  @param[in]
+ *      dp      directory object
+ *  @param[out]
+ *      fno     file information
+ *  @return
+ *      FRESULT
+ */
+FRESULT DIRCACHE_findnext(DIR* dp, FILINFO* fno) {
+	FRESULT fr;
+
+	osMutexAcquire(DIRCACHE_MutexID, osWaitForever);
+	fr = next(dp, fno);
+	osMutexRelease(DIRCACHE_MutexID);
+	return fr;
+}
+
+
+/**
+ *  @brief
+ *      Gets the file status (f_stat) from the cached directory.
+ *
+ *      Names with non-ASCII characters, "." and ".." are left to f_stat().
+ *  @param[in]
+ *      path    object name
+ *  @param[out]
+ *      fno     file information, can be NULL
+ *  @return
+ *      FRESULT
+ */
+FRESULT DIRCACHE_stat(const TCHAR* path, FILINFO* fno) {
+	TCHAR dir[_MAX_LFN + 1];
+	const TCHAR *name;
+	const char *alt;
+	DIR dj;
+	int s, i, len;
+
+	name = strrchr(path, '/');
+	if (name == NULL) {
+		name = strchr(path, ':');
+	}
+	name = (name == NULL) ? path : name + 1;
+	len = name - path;
+
+	if (*name == 0 || ! strcmp(name, ".") || ! strcmp(name, "..") || len > _MAX_LFN) {
+		return f_stat(path, fno);
+	}
+	for (i = 0; name[i]; i++) {
+		if ((uint8_t) name[i] >= 0x80) {
+			return f_stat(path, fno);
+		}
+	}
+	memcpy(dir, path, len);
+	dir[len] = 0;
+
+	osMutexAcquire(DIRCACHE_MutexID, osWaitForever);
+	s = -1;
+	if (f_opendir(&dj, dir) == FR_OK) {
+		s = attach(&dj);
+		f_closedir(&dj);
+	}
+	if (s < 0) {
+		osMutexRelease(DIRCACHE_MutexID);
+		return f_stat(path, fno);
+	}
+
+	for (i = 0; i < slot[s].entries; i++) {
+		alt = &names[slot[s].names + entry[slot[s].first + i].name];
+		if (same_name(alt, name)) {
+			break;
+		}
+		alt += strlen(alt) + 1;
+		if (*alt && same_name(alt, name)) {
+			break;
+		}
+	}
+	if (i < slot[s].entries) {
+		if (fno != NULL) {
+			copy_entry(&slot[s], &entry[slot[s].first + i], fno);
+		}
+		osMutexRelease(DIRCACHE_MutexID);
+		return FR_OK;
+	}
+	osMutexRelease(DIRCACHE_MutexID);
+	return FR_NO_FILE;
+}
+
+
+/**
+ *  @brief
+ *      Reads the next n items (matched, if opened by f_findfirst) into a
+ *      FILINFO array.
+ *
+ *      dir-entries ( dp addr n -- count )
+ *  @param[in]
+ *      dp      directory object
+ *  @param[out]
+ *      fno     FILINFO array
+ *  @param[in]
+ *      n       array size
+ *  @return
+ *      number of items read, less than n at the end of the directory
+ */
+int DIRCACHE_entries(DIR* dp, FILINFO* fno, int n) {
+	int count = 0;
+
+	osMutexAcquire(DIRCACHE_MutexID, osWaitForever);
+	while (count < n) {
+		if (next(dp, &fno[count]) != FR_OK || fno[count].fname[0] == 0) {
+			break;
+		}
+		count++;
+	}
+	osMutexRelease(DIRCACHE_MutexID);
+	return count;
+}
+
+
+// Private Functions
+// *****************
+
+/**
+ *  @brief
+ *      Reads the next item, all items if there is no pattern (dp->pat).
+ *  @return
+ *      FRESULT
+ */
+static FRESULT next(DIR *dp, FILINFO *fno) {
+	DIRCACHE_Iter_t *it;
+	DIRCACHE_Slot_t *s;
+	DIRCACHE_Entry_t *e;
+
+	it = iter_get(dp);
+	if (it == NULL) {
+		if (dp->pat != NULL) {
+			return f_findnext(dp, fno);
+		}
+		return f_readdir(dp, fno);
+	}
+
+	if (fno == NULL) {
+		// rewind
+		it->index = 0;
+		return FR_OK;
+	}
+	s = &slot[it->slot];
+	while (it->index < s->entries) {
+		e = &entry[s->first + it->index++];
+		if (dp->pat == NULL || match(dp->pat, &names[s->names + e->name])) {
+			copy_entry(s, e, fno);
+			return FR_OK;
+		}
+	}
+	fno->fname[0] = 0;
+	return FR_OK;
+}
+
+
+/**
+ *  @brief
+ *      Gets the cache slot for the open directory, reads the directory if it
+ *      is not in the cache.
+ *  @return
+ *      slot, -1 not cached
+ */
+static int attach(DIR *dp) {
+	int s;
+
+	if (dp->obj.fs->wflag) {
+		// directory or FAT changes not written yet
+		return -1;
+	}
+	s = lookup(dp);
+	if (s < 0 && ! too_large(dp)) {
+		s = fill(dp);
+	}
+	if (s >= 0) {
+		slot[s].used = ++uses;
+	}
+	return s;
+}
+
+
+/**
+ *  @brief
+ *      Is the cached directory still valid?
+ */
+static int valid(const DIRCACHE_Slot_t *s) {
+	return s->fs != NULL
+			&& s->fs->id == s->id
+			&& s->generation == generation[s->fs->drv]
+			&& ! s->fs->wflag;
+}
+
+
+/**
+ *  @brief
+ *      Searches the directory in the cache.
+ *  @return
+ *      slot, -1 not found
+ */
+static int lookup(const DIR *dp) {
+	int i;
+
+	for (i = 0; i < DIRCACHE_SLOTS; i++) {
+		if (slot[i].fs == dp->obj.fs && slot[i].id == dp->obj.id
+				&& slot[i].sclust == dp->obj.sclust) {
+			if (valid(&slot[i])) {
+				return i;
+			}
+			free_slot(&slot[i]);
+		}
+	}
+	return -1;
+}
+
+
+/**
+ *  @brief
+ *      Reads the directory into the free or least recently used slot, the
+ *      directory is rewound. The entries and names are appended to the
+ *      pools.
+ *  @return
+ *      slot, -1 not cached (too large, changed)
+ */
+static int fill(DIR *dp) {
+	DIRCACHE_Slot_t *s;
+	FRESULT fr;
+	uint32_t gen;
+	int i, n, full;
+
+	n = 0;
+	for (i = 0; i < DIRCACHE_SLOTS; i++) {
+		if (slot[i].fs == NULL) {
+			n = i;
+			break;
+		}
+		if (slot[i].used < slot[n].used) {
+			n = i;
+		}
+	}
+	s = &slot[n];
+	free_slot(s);
+
+	gen = generation[dp->obj.fs->drv];
+	// the slot is in use while it is filled, make_room() keeps it
+	s->fs = dp->obj.fs;
+	s->id = dp->obj.id;
+	s->sclust = dp->obj.sclust;
+	s->generation = gen;
+	s->first = entries_top;
+	s->names = names_top;
+	full = FALSE;
+	while (TRUE) {
+		fr = f_readdir(dp, &info);
+		if (fr != FR_OK || info.fname[0] == 0) {
+			break;
+		}
+		if (add_entry(s, &info) != 0) {
+			full = TRUE;
+			break;
+		}
+	}
+	f_readdir(dp, NULL);
+
+	if (fr != FR_OK || full || gen != generation[dp->obj.fs->drv]) {
+		if (full && gen == generation[dp->obj.fs->drv]) {
+			set_too_large(dp, gen);
+		}
+		free_slot(s);
+		return -1;
+	}
+	s->tag = ++tags;
+	return n;
+}
+
+
+/**
+ *  @brief
+ *      Adds the item to the slot, the slot is the last one in the pools.
+ *  @return
+ *      0 OK, -1 too large (DIRCACHE_ENTRIES, DIRCACHE_NAMES)
+ */
+static int add_entry(DIRCACHE_Slot_t *s, const FILINFO *fno) {
+	int fname_len = strlen(fno->fname) + 1;
+	int alt_len = strlen(fno->altname) + 1;
+	DIRCACHE_Entry_t *e;
+
+	if (make_room(s, fname_len + alt_len) != 0) {
+		return -1;
+	}
+
+	e = &entry[entries_top++];
+	e->fsize = fno->fsize;
+	e->fdate = fno->fdate;
+	e->ftime = fno->ftime;
+	e->fattrib = fno->fattrib;
+	e->name = s->names_len;
+	memcpy(&names[names_top], fno->fname, fname_len);
+	memcpy(&names[names_top + fname_len], fno->altname, alt_len);
+	names_top += fname_len + alt_len;
+	s->names_len += fname_len + alt_len;
+	s->entries++;
+	return 0;
+}
+
+
+/**
+ *  @brief
+ *      Makes room for one more entry at the end of the pools. The freed
+ *      space is compacted first, then the least recently used slots other
+ *      than s are dropped.
+ *  @return
+ *      0 OK, -1 s alone does not fit
+ */
+static int make_room(DIRCACHE_Slot_t *s, int names_len) {
+	int i, n;
+
+	while (entries_top >= DIRCACHE_ENTRIES || names_top + names_len > DIRCACHE_NAMES) {
+		n = 0;
+		for (i = 0; i < DIRCACHE_SLOTS; i++) {
+			n += slot[i].entries;
+		}
+		if (n < entries_top) {
+			// freed slots in between
+			compact();
+			continue;
+		}
+		n = -1;
+		for (i = 0; i < DIRCACHE_SLOTS; i++) {
+			if (&slot[i] != s && slot[i].fs != NULL
+					&& (n < 0 || slot[i].used < slot[n].used)) {
+				n = i;
+			}
+		}
+		if (n < 0) {
+			return -1;
+		}
+		free_slot(&slot[n]);
+	}
+	return 0;
+}
+
+
+/**
+ *  @brief
+ *      Moves the entries and names of the slots in use to the start of the
+ *      pools. The slots are appended in the same order to both pools.
+ */
+static void compact(void) {
+	DIRCACHE_Slot_t *s;
+	int moved[DIRCACHE_SLOTS] = { 0 };
+	int i, k;
+
+	entries_top = 0;
+	names_top = 0;
+	for (k = 0; k < DIRCACHE_SLOTS; k++) {
+		// the slot in use next in the pools
+		s = NULL;
+		for (i = 0; i < DIRCACHE_SLOTS; i++) {
+			if (! moved[i] && slot[i].fs != NULL && (s == NULL || slot[i].first < s->first)) {
+				s = &slot[i];
+			}
+		}
+		if (s == NULL) {
+			break;
+		}
+		moved[s - slot] = TRUE;
+		memmove(&entry[entries_top], &entry[s->first], s->entries * sizeof(DIRCACHE_Entry_t));
+		memmove(&names[names_top], &names[s->names], s->names_len);
+		s->first = entries_top;
+		s->names = names_top;
+		entries_top += s->entries;
+		names_top += s->names_len;
+	}
+}
+
+
+/**
+ *  @brief
+ *      Was the directory too large for the pools (same volume generation)?
+ *  @return
+ *      TRUE too large, do not read it again
+ */
+static int too_large(const DIR *dp) {
+	int i;
+
+	for (i = 0; i < DIRCACHE_LARGE; i++) {
+		if (large[i].fs == dp->obj.fs && large[i].id == dp->obj.id
+				&& large[i].sclust == dp->obj.sclust
+				&& large[i].generation == generation[dp->obj.fs->drv]) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+
+/**
+ *  @brief
+ *      Remembers the too large directory, the oldest is replaced.
+ */
+static void set_too_large(const DIR *dp, uint32_t gen) {
+	DIRCACHE_Large_t *l = &large[large_next];
+
+	large_next = (large_next + 1) % DIRCACHE_LARGE;
+	l->fs = dp->obj.fs;
+	l->id = dp->obj.id;
+	l->sclust = dp->obj.sclust;
+	l->generation = gen;
+}
+
+
+/**
+ *  @brief
+ *      Frees the slot, the pools are compacted by make_room().
+ */
+static void free_slot(DIRCACHE_Slot_t *s) {
+	s->fs = NULL;
+	s->id = 0;
+	s->sclust = 0;
+	s->generation = 0;
+	s->tag = 0;
+	s->used = 0;
+	s->entries = 0;
+	s->names_len = 0;
+}
+
+
+/**
+ *  @brief
+ *      Copies the cached entry into the FILINFO.
+ */
+static void copy_entry(const DIRCACHE_Slot_t *s, const DIRCACHE_Entry_t *e, FILINFO *fno) {
+	const char *name = &names[s->names + e->name];
+
+	fno->fsize = e->fsize;
+	fno->fdate = e->fdate;
+	fno->ftime = e->ftime;
+	fno->fattrib = e->fattrib;
+	strcpy(fno->fname, name);
+	strcpy(fno->altname, name + strlen(name) + 1);
+}
+
+
+/**
+ *  @brief
+ *      Gets the iterator of the DIR. If the cached directory is not valid
+ *      anymore, the DIR is handed back to FatFs.
+ *  @return
+ *      iterator, NULL DIR not served by the cache
+ */
+static DIRCACHE_Iter_t *iter_get(const DIR *dp) {
+	DIRCACHE_Iter_t *it;
+	int i;
+
+	for (i = 0; i < DIRCACHE_ITERATORS; i++) {
+		it = &iter[i];
+		if (it->dp == dp) {
+			if (slot[it->slot].tag == it->tag && valid(&slot[it->slot])) {
+				it->used = ++uses;
+				return it;
+			}
+			iter_release(it);
+			return NULL;
+		}
+	}
+	return NULL;
+}
+
+
+/**
+ *  @brief
+ *      Serves the DIR by the cache slot, the least recently used iterator
+ *      is released if there is no free one.
+ */
+static void iter_new(DIR *dp, int s) {
+	DIRCACHE_Iter_t *it = &iter[0];
+	int i;
+
+	for (i = 0; i < DIRCACHE_ITERATORS; i++) {
+		if (iter[i].dp == NULL) {
+			it = &iter[i];
+			break;
+		}
+		if (iter[i].used < it->used) {
+			it = &iter[i];
+		}
+	}
+	if (it->dp != NULL) {
+		iter_release(it);
+	}
+	it->dp = dp;
+	it->slot = s;
+	it->tag = slot[s].tag;
+	it->index = 0;
+	it->used = ++uses;
+}
+
+
+/**
+ *  @brief
+ *      Forgets the iterator of the DIR (reopened or closed).
+ */
+static void iter_drop(const DIR *dp) {
+	int i;
+
+	for (i = 0; i < DIRCACHE_ITERATORS; i++) {
+		if (iter[i].dp == dp) {
+			iter[i].dp = NULL;
+		}
+	}
+}
+
+
+/**
+ *  @brief
+ *      Hands the DIR back to FatFs, the DIR skips the items already read
+ *      from the cache.
+ */
+static void iter_release(DIRCACHE_Iter_t *it) {
+	int i;
+
+	for (i = 0; i < it->index; i++) {
+		if (f_readdir(it->dp, &info) != FR_OK || info.fname[0] == 0) {
+			break;
+		}
+	}
+	it->dp = NULL;
+}
+
+
+/**
+ *  @brief
+ *      Wildcard match like FatFs (? one character, * any), case insensitive
+ *      for ASCII.
+ *  @return
+ *      TRUE matched
+ */
+static int match(const char *pat, const char *name) {
+	const char *star = NULL;
+	const char *back = NULL;
+	char p, n;
+
+	while (*name) {
+		p = *pat;
+		n = *name;
+		if (p >= 'a' && p <= 'z') {
+			p -= 'a' - 'A';
+		}
+		if (n >= 'a' && n <= 'z') {
+			n -= 'a' - 'A';
+		}
+		if (p == '*') {
+			star = ++pat;
+			back = name;
+		} else if (p == '?' || (p != 0 && p == n)) {
+			pat++;
+			name++;
+		} else if (star != NULL) {
+			pat = star;
+			name = ++back;
+		} else {
+			return FALSE;
+		}
+	}
+	while (*pat == '*') {
+		pat++;
+	}
+	return *pat == 0;
+}
+
+
+/**
+ *  @brief
+ *      Compares the names case insensitive (ASCII).
+ *  @return
+ *      TRUE same name
+ */
+static int same_name(const char *a, const char *b) {
+	char x, y;
+
+	do {
+		x = *a++;
+		y = *b++;
+		if (x >= 'a' && x <= 'z') {
+			x -= 'a' - 'A';
+		}
+		if (y >= 'a' && y <= 'z') {
+			y -= 'a' - 'A';
+		}
+		if (x != y) {
+			return FALSE;
+		}
+	} while (x != 0);
+	return TRUE;
+}
@@ -0,0 +1,47 @@
+/**
+ *  @brief
+ *      Directory entry cache for the FAT volumes.
+ *
+ *      The entries of a directory are read once and served from RAM for
+ *      ls, f_readdir, f_findfirst/f_findnext and f_stat.
+ *  @file
+ *      dircache.h
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-19
+ *  @remark
+ *      Language: C, STM32CubeIDE GCC
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ *
+ *      Mecrsip-Cube is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with Mecrsip-Cube. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef INC_DIRCACHE_H_
+#define INC_DIRCACHE_H_
+
+#include "ff.h"
+
+void DIRCACHE_init(void);
+void DIRCACHE_invalidate(int volume);
+FRESULT DIRCACHE_opendir(DIR* dp, const TCHAR* path);
+FRESULT DIRCACHE_closedir(DIR* dp);
+FRESULT DIRCACHE_readdir(DIR* dp, FILINFO* fno);
+FRESULT DIRCACHE_findfirst(DIR* dp, FILINFO* fno, const TCHAR* path, const TCHAR* pattern);
+FRESULT DIRCACHE_findnext(DIR* dp, FILINFO* fno);
+FRESULT DIRCACHE_stat(const TCHAR* path, FILINFO* fno);
+int DIRCACHE_entries(DIR* dp, FILINFO* fno, int n);
+
+#endif /* INC_DIRCACHE_H_ */
@@ -185,44 +185,30 @@ uint8_t FD_WriteBlocks(uint8_t *pData, uint32_t WriteAddr, uint32_t NumOfBlocks)
 
 		osMutexAcquire(FD_MutexID, osWaitForever);
 
-		int FirstBoundary = WriteAddr % FD_BLOCKS_PER_PAGE;
-		int LastBoundary = (WriteAddr + NumOfBlocks) % FD_BLOCKS_PER_PAGE;
-		int pages = NumOfBlocks / FD_BLOCKS_PER_PAGE;
-		if (FirstBoundary + LastBoundary > 0) {
-			pages++;
-		}
+		int first = WriteAddr % FD_BLOCKS_PER_PAGE;	// first block in the page
+		int blocks = NumOfBlocks;
 
-		uint32_t base_flash_addr = FD_START_ADDRESS + base_block_adr * FD_BLOCK_SIZE;
+		uint32_t flash_addr = FD_START_ADDRESS + base_block_adr * FD_BLOCK_SIZE;
 		retr = SD_OK;
-		for (i=0; i < pages; i++) {
-			if (i==0 && i == pages -1) {
-				// only one page
-				if (LastBoundary == 0) {
-					block_field = 0xFF << FirstBoundary;
-				} else {
-					block_field = (0xFF << FirstBoundary) & (0xFF >> (FD_BLOCKS_PER_PAGE - LastBoundary));
-				}
-			} else if (i==0) {
-				// first page
-				block_field = 0xFF << FirstBoundary;
-			} else if (i == pages -1) {
-				// last page
-				if (LastBoundary == 0) {
-					block_field = 0xFF;
-				} else {
-					block_field = 0xFF >> LastBoundary;
-				}
-			} else {
-				block_field = 0xFF;
+		while (blocks > 0) {
+			// blocks in this page
+			i = FD_BLOCKS_PER_PAGE - first;
+			if (i > blocks) {
+				i = blocks;
 			}
+			block_field = ((1 << i) - 1) << first;
 			if (flash_page(
-					pData +  i*FD_PAGE_SIZE, 			// dress data source (contiguous)
-					base_flash_addr + i*FD_PAGE_SIZE,	// page base address flash dest
-					block_field)						// valid blocks bitfield
+					pData, 					// data source (contiguous)
+					flash_addr,				// page base address flash dest
+					block_field)			// valid blocks bitfield
 					!= SD_OK) {
 				retr = SD_ERROR;
 				break;
 			}
+			pData += i*FD_BLOCK_SIZE;
+			flash_addr += FD_PAGE_SIZE;
+			blocks -= i;
+			first = 0;
 		}
 
 		osMutexRelease(FD_MutexID);
@@ -8,6 +8,16 @@
  *      Erase takes about 20 ms, program 2 ms.
  *
  *      Flash process is not real time!
+ *
+ *      The Forth compiler stages its double words in a row buffer
+ *      (512 bytes, 64 double words). A complete row on erased flash is
+ *      written by fast programming, otherwise the staged double words are
+ *      programmed one by one, but with only one flash unlock.
+ *      The row buffer is written when the compiler moves on to the next row,
+ *      at the end of a definition (smudge), at the end of the interpreted
+ *      or evaluated line (quit, evaluate, include), by flushflash and
+ *      before the dictionary search reads a staged double word
+ *      (FLASH_readStage()).
  *  @file
  *      flash.c
  *  @author
@@ -53,6 +63,11 @@
 // ***************************
 int aquire_flash(uint8_t Erase);
 int release_flash(uint8_t Erase);
+static void aquire_cpu2(void);
+static void release_cpu2(void);
+static int program_double(uint32_t Address, uint64_t data);
+static int program_stage(void);
+static int row_erased(uint32_t Address);
 
 // Global Variables
 // ****************
@@ -75,6 +90,11 @@ static const osMutexAttr_t FLASH_MutexAttr = {
 // Variable used for Erase procedure
 static FLASH_EraseInitTypeDef EraseInitStruct;
 
+// Row buffer for the staged double words
+static uint64_t stage_buffer[FLASH_ROW_SIZE / 8];
+static uint32_t stage_row = 0;		// address of the staged row
+static uint64_t stage_mask = 0;		// one bit per staged double word
+
 // Public Functions
 // ****************
 
@@ -120,21 +140,16 @@ int FLASH_programDouble(uint32_t Address, uint32_t word1, uint32_t word2) {
 
 	// only one thread is allowed to use the flash
 	osMutexAcquire(FLASH_MutexID, osWaitForever);
-	UTIL_LPM_SetStopMode(1U << CFG_LPM_FLASH, UTIL_LPM_DISABLE);
-
-	aquire_flash(FALSE);
 
-	__HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_OPTVERR);
-	__HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_ALL_ERRORS);
+	if (stage_mask && (Address & ~(FLASH_ROW_SIZE - 1)) == stage_row) {
+		// keep the order of the writes to the staged row
+		program_stage();
+	}
 
 	data.word[0] = word1;
 	data.word[1] = word2;
-	return_value = HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, Address,
-				data.doubleword);
-
-	release_flash(FALSE);
+	return_value = program_double(Address, data.doubleword);
 
-	UTIL_LPM_SetStopMode(1U << CFG_LPM_FLASH, UTIL_LPM_ENABLE);
 	osMutexRelease(FLASH_MutexID);
 
 	if (return_value != HAL_OK) {
@@ -146,6 +161,127 @@ int FLASH_programDouble(uint32_t Address, uint32_t word1, uint32_t word2) {
 }
 
 
+/**
+ *  @brief
+ *      Stages 8 bytes (doubleword) for the FLASH.
+ *
+ *      The double word is collected in the row buffer. The row is programmed
+ *      when it is complete, when a double word for a following row arrives or
+ *      by FLASH_flushStage(). A double word for a preceding row (back link,
+ *      flags of a header) is programmed at once and the row buffer is kept.
+ *  @param[in]
+ *      Address  first byte
+ *  @param[in]
+ *      word1
+ *  @param[in]
+ *      word2
+ *  @return
+ *      HAL Status
+ */
+int FLASH_stageDouble(uint32_t Address, uint32_t word1, uint32_t word2) {
+	int return_value = HAL_OK;
+	uint32_t row = Address & ~(FLASH_ROW_SIZE - 1);
+	uint64_t bit = 1ULL << ((Address - row) / 8);
+
+	if (Address < 0x08040000 || Address >= 0x080C0000 || (Address & 7)) {
+		Error_Handler();
+		return -1;
+	}
+
+	// only one thread is allowed to use the flash
+	osMutexAcquire(FLASH_MutexID, osWaitForever);
+
+	if (stage_mask && row < stage_row) {
+		// e.g. the back link of the previous definition
+		return_value = program_double(Address, ((uint64_t) word2 << 32) | word1);
+		osMutexRelease(FLASH_MutexID);
+		if (return_value != HAL_OK) {
+			return_value = HAL_ERROR;
+			Error_Handler();
+		}
+		return return_value;
+	}
+
+	if (stage_mask && (row != stage_row || (stage_mask & bit))) {
+		// next row or the same double word again
+		return_value = program_stage();
+	}
+
+	stage_row = row;
+	stage_buffer[(Address - row) / 8] = ((uint64_t) word2 << 32) | word1;
+	stage_mask |= bit;
+
+	if (stage_mask == UINT64_MAX) {
+		// row complete
+		return_value = program_stage();
+	}
+
+	osMutexRelease(FLASH_MutexID);
+
+	return return_value;
+}
+
+
+/**
+ *  @brief
+ *      Programs the staged double words.
+ *  @return
+ *      HAL Status
+ */
+int FLASH_flushStage(void) {
+	int return_value = HAL_OK;
+
+	if (stage_mask == 0) {
+		// nothing staged, also before the RTOS is running
+		return return_value;
+	}
+
+	osMutexAcquire(FLASH_MutexID, osWaitForever);
+	if (stage_mask) {
+		return_value = program_stage();
+	}
+	osMutexRelease(FLASH_MutexID);
+
+	return return_value;
+}
+
+
+/**
+ *  @brief
+ *      Programs the row buffer, if a staged double word is in the range.
+ *
+ *      The dictionary search reads the flash directly. It calls this
+ *      function, if it reads an erased link or name.
+ *  @param[in]
+ *      Address  first byte
+ *  @param[in]
+ *      Length   number of bytes
+ *  @return
+ *      TRUE row buffer programmed, read again
+ */
+int FLASH_readStage(uint32_t Address, uint32_t Length) {
+	int i;
+	uint64_t mask = 0;
+
+	if (stage_mask == 0 || Address + Length <= stage_row
+			|| Address >= stage_row + FLASH_ROW_SIZE) {
+		return FALSE;
+	}
+
+	for (i = 0; i < FLASH_ROW_SIZE / 8; i++) {
+		if (stage_row + 8 * i + 8 > Address && stage_row + 8 * i < Address + Length) {
+			mask |= 1ULL << i;
+		}
+	}
+	if ((stage_mask & mask) == 0) {
+		return FALSE;
+	}
+
+	FLASH_flushStage();
+	return TRUE;
+}
+
+
 /**
  *  @brief
  *
@@ -161,6 +297,13 @@ int FLASH_erasePage(uint32_t Address) {
 
 	// only one thread is allowed to use the flash
 	osMutexAcquire(FLASH_MutexID, osWaitForever);
+
+	if (stage_mask && (stage_row & ~(FLASH_PAGE_SIZE - 1))
+			== (Address & ~(FLASH_PAGE_SIZE - 1))) {
+		// the staged row is erased anyway
+		stage_mask = 0;
+	}
+
 	UTIL_LPM_SetStopMode(1U << CFG_LPM_FLASH, UTIL_LPM_DISABLE);
 
 	aquire_flash(TRUE);
@@ -206,6 +349,30 @@ int aquire_flash(uint8_t Erase) {
 		SHCI_C2_FLASH_EraseActivity(ERASE_ACTIVITY_ON);
 	}
 
+	aquire_cpu2();
+
+	return HAL_OK;
+}
+
+
+int release_flash(uint8_t Erase) {
+
+	release_cpu2();
+
+	if (Erase) {
+		SHCI_C2_FLASH_EraseActivity(ERASE_ACTIVITY_OFF);
+	}
+
+	ASSERT_nonfatal(HAL_FLASH_Lock() != HAL_ERROR, ASSERT_FLASH_LOCK, 0);
+
+	HAL_HSEM_Release(2, 0);
+
+	return HAL_OK;
+}
+
+
+// the flash operation itself has to be protected against CPU2 (sem 7)
+static void aquire_cpu2(void) {
 	while (TRUE) {
 		// PESD bit set?
 		if (LL_FLASH_IsActiveFlag_OperationSuspended()) {
@@ -231,11 +398,10 @@ int aquire_flash(uint8_t Erase) {
 
 		break;
 	}
-	return HAL_OK;
 }
 
 
-int release_flash(uint8_t Erase) {
+static void release_cpu2(void) {
 
 	HAL_HSEM_Release(7, 0);
 
@@ -246,16 +412,85 @@ int release_flash(uint8_t Erase) {
 	while (__HAL_FLASH_GET_FLAG(FLASH_FLAG_CFGBSY)) {
 		 ;
 	}
+}
 
-	if (Erase) {
-		SHCI_C2_FLASH_EraseActivity(ERASE_ACTIVITY_OFF);
+
+// programs one double word, the mutex has to be taken
+static int program_double(uint32_t Address, uint64_t data) {
+	int return_value;
+
+	UTIL_LPM_SetStopMode(1U << CFG_LPM_FLASH, UTIL_LPM_DISABLE);
+
+	aquire_flash(FALSE);
+
+	__HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_OPTVERR);
+	__HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_ALL_ERRORS);
+
+	return_value = HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, Address, data);
+
+	release_flash(FALSE);
+
+	UTIL_LPM_SetStopMode(1U << CFG_LPM_FLASH, UTIL_LPM_ENABLE);
+
+	return return_value;
+}
+
+
+// programs the row buffer, the mutex has to be taken
+static int program_stage(void) {
+	int return_value = HAL_OK;
+	int i;
+
+	UTIL_LPM_SetStopMode(1U << CFG_LPM_FLASH, UTIL_LPM_DISABLE);
+
+	aquire_flash(FALSE);
+	__HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_OPTVERR);
+	__HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_ALL_ERRORS);
+
+	if (stage_mask == UINT64_MAX && row_erased(stage_row)) {
+		// whole row at once with one CPU2 semaphore grab
+		return_value = HAL_FLASH_Program(FLASH_TYPEPROGRAM_FAST, stage_row,
+				(uint32_t) stage_buffer);
+	} else {
+		// unlocked once, but CPU2 gets the flash between the double words
+		for (i = 0; i < FLASH_ROW_SIZE / 8; i++) {
+			if ((stage_mask & (1ULL << i)) == 0) {
+				continue;
+			}
+			return_value = HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD,
+					stage_row + 8 * i, stage_buffer[i]);
+			if (return_value != HAL_OK) {
+				break;
+			}
+			release_cpu2();
+			aquire_cpu2();
+		}
 	}
 
-	ASSERT_nonfatal(HAL_FLASH_Lock() != HAL_ERROR, ASSERT_FLASH_LOCK, 0);
+	release_flash(FALSE);
 
-	HAL_HSEM_Release(2, 0);
+	UTIL_LPM_SetStopMode(1U << CFG_LPM_FLASH, UTIL_LPM_ENABLE);
+	stage_mask = 0;
 
-	return HAL_OK;
+	if (return_value != HAL_OK) {
+		return_value = HAL_ERROR;
+		Error_Handler();
+	}
+
+	return return_value;
 }
 
 
+// fast programming needs an erased row
+static int row_erased(uint32_t Address) {
+	uint32_t *p = (uint32_t*) Address;
+	int i;
+
+	for (i = 0; i < FLASH_ROW_SIZE / 4; i++) {
+		if (p[i] != 0xFFFFFFFF) {
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
@@ -8,8 +8,13 @@
 #ifndef INC_FLASH_H_
 #define INC_FLASH_H_
 
+#define FLASH_ROW_SIZE		512		// fast programming row (64 double words)
+
 void FLASH_init(void);
 int FLASH_programDouble(uint32_t Address, uint32_t word1, uint32_t word2);
+int FLASH_stageDouble(uint32_t Address, uint32_t word1, uint32_t word2);
+int FLASH_flushStage(void);
+int FLASH_readStage(uint32_t Address, uint32_t Length);
 int FLASH_erasePage(uint32_t Address);
 
 #endif /* INC_FLASH_H_ */
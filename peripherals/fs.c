@@ -52,6 +52,7 @@
 #include "ff.h"
 #include "rtc.h"
 #include "block.h"
+#include "dircache.h"
 #include "myassert.h"
 
 
@@ -60,13 +61,40 @@
 #define LINE_LENGTH				256
 #define	RAM_SHARED				(SRAM2B_BASE + 0x1000)	// 4 KiB used by fd
 #define	SCRATCH_SIZE			0x1000					// 4 KiB scratch
+#define BATCH_SIZE				512						// output batch
+#define SEARCH_LENGTH			80						// cat -p pattern
 
 // Private typedefs
 // ****************
+typedef struct {
+	// options
+	uint8_t number;					// -n line numbers
+	uint8_t count;					// count lines, words and bytes (wc)
+	int search_len;					// -p pattern length, 0 all lines
+	uint8_t skip[256];				// Boyer-Moore-Horspool bad character shift
+	FIL *out;						// output file, NULL console
+	// state
+	int line_num;
+	uint8_t in_word;
+	uint8_t last;					// last character
+	uint32_t lines;
+	uint32_t words;
+	uint32_t bytes;
+	int batch_len;
+} FS_Stream_t;
 
 
 // Private function prototypes
 // ***************************
+static void stream_search(FS_Stream_t *stream, const uint8_t *str, int count);
+static uint64_t stream_file(uint64_t forth_stack, FS_Stream_t *stream, FIL *fil);
+static uint64_t stream_lines(uint64_t forth_stack, FS_Stream_t *stream, const uint8_t *buf, int len);
+static uint64_t stream_write(uint64_t forth_stack, FS_Stream_t *stream, const uint8_t *buf, int len);
+static uint64_t stream_flush(uint64_t forth_stack, FS_Stream_t *stream);
+static void stream_count(FS_Stream_t *stream, const uint8_t *buf, int len);
+static int strip_cr(uint8_t *buf, int len);
+static const uint8_t *bmh_search(const FS_Stream_t *stream, const uint8_t *text, int len);
+static int count_newlines(const uint8_t *buf, int len);
 
 // Global Variables
 // ****************
@@ -103,6 +131,9 @@ extern RTC_HandleTypeDef hrtc;
 // Private Variables
 // *****************
 uint8_t 	*mkfs_scratch;
+static FS_Stream_t stream;
+static uint8_t batch[BATCH_SIZE];
+static uint8_t search[SEARCH_LENGTH];
 
 // Public Functions
 // ****************
@@ -118,7 +149,7 @@ void FS_init(void) {
 //	mkfs_scratch = pvPortMalloc(FD_PAGE_SIZE);
 	FS_MutexID = osMutexNew(&FS_MutexAttr);
 	ASSERT_fatal(FS_MutexID != NULL, ASSERT_MUTEX_CREATION, __get_PC());
-
+	DIRCACHE_init();
 
 	/* Gives a work area to the flash drive */
 	f_mount(&FatFs_FD, "0:", 0);
@@ -259,6 +290,8 @@ uint64_t FS_coredump(uint64_t forth_stack, uint8_t *str, int count) {
  *  @brief
  *      Concatenate files and print on the standard output
  *
+ *      The files are read in blocks of 4 KiB, the output is batched.
+ *      With -p only the lines with the pattern are printed (grep).
  *      The parameters are taken from the command line (Forth tokens)
  *  @param[in]
  *      forth_stack   TOS (lower word) and SPS (higher word)
@@ -268,11 +301,9 @@ uint64_t FS_coredump(uint64_t forth_stack, uint8_t *str, int count) {
 uint64_t FS_cat(uint64_t forth_stack) {
 	uint8_t *str = NULL;
 	int count = 1;
-	uint8_t n_flag = FALSE;
 	uint8_t outfile_flag = FALSE;
 	uint8_t input_flag = FALSE;
 	uint8_t EOF_flag = FALSE;
-	int line_num = 0;
 	FIL fil_in;		/* File object */
 	FIL fil_out;	/* File object */
 	FRESULT fr;		/* FatFs return code */
@@ -282,6 +313,7 @@ uint64_t FS_cat(uint64_t forth_stack) {
 	stack = forth_stack;
 
 	stack = FS_cr(stack);
+	memset(&stream, 0, sizeof(stream));
 
 	while (TRUE) {
 		// get tokens till end of line
@@ -293,7 +325,14 @@ uint64_t FS_cat(uint64_t forth_stack) {
 		memcpy(line, str, count);
 		line[count] = 0;
 		if (! strcmp(line, "-n")) {
-			n_flag = TRUE;
+			stream.number = TRUE;
+		} else if (! strcmp(line, "-p")) {
+			stack = FS_token(stack, &str, &count);
+			if (count == 0) {
+				// no more tokens
+				break;
+			}
+			stream_search(&stream, str, count);
 		} else if ( (! strcmp(line, ">")) || (! strcmp(line, ">>")) ) {
 			if (! strcmp(line, ">")) {
 				// new file
@@ -310,6 +349,7 @@ uint64_t FS_cat(uint64_t forth_stack) {
 				break;
 			}
 			outfile_flag = TRUE;
+			stream.out = &fil_out;
 			fr = f_open(&fil_out, line, mode);
 			if (fr != FR_OK) {
 				stack = FS_type(stack, (uint8_t*)line, strlen(line));
@@ -335,22 +375,8 @@ uint64_t FS_cat(uint64_t forth_stack) {
 				strcpy(line, ": file not found");
 				stack = FS_type(stack, (uint8_t*)line, strlen(line));
 			} else {
-				/* Read every line and type it */
-				while (f_gets(line, sizeof(line), &fil_in)) {
-					if (n_flag) {
-						snprintf(pattern, sizeof(pattern), "%6i: ", line_num++);
-						if (outfile_flag) {
-							f_puts(pattern, &fil_out);
-						} else {
-							stack = FS_type(stack, (uint8_t*)pattern, strlen(pattern));
-						}
-					}
-					if (outfile_flag) {
-						f_puts(line, &fil_out);
-					} else {
-						stack = FS_type(stack, (uint8_t*)line, strlen(line));
-					}
-				}
+				/* Read the file in blocks and type it */
+				stack = stream_file(stack, &stream, &fil_in);
 				/* Close the file */
 				f_close(&fil_in);
 			}
@@ -455,9 +481,10 @@ uint64_t FS_ls(uint64_t forth_stack) {
 		strncpy(path, line, sizeof(path));
 	}
 
-	fr = f_findfirst(&dj, &fno, path, pattern);
+	fr = DIRCACHE_findfirst(&dj, &fno, path, pattern);
 
 	stack = FS_cr(stack);
+	memset(&stream, 0, sizeof(stream));
 	while (fr == FR_OK && fno.fname[0]) {
 		/* Repeat while an item is found */
 		if (l_flag) {
@@ -499,16 +526,17 @@ uint64_t FS_ls(uint64_t forth_stack) {
 			}
 		}
 		if ( ( (fno.fattrib & AM_HID) != AM_HID) || a_flag) {
-			stack = FS_type(stack, (uint8_t*)line, strlen(line));
+			stack = stream_write(stack, &stream, (uint8_t*)line, strlen(line));
 		}
 		/* Search for next item */
-		fr = f_findnext(&dj, &fno);
+		fr = DIRCACHE_findnext(&dj, &fno);
 	}
+	stack = stream_flush(stack, &stream);
 	if (!l_flag && column != 0) {
 		stack = FS_cr(stack);
 	}
 
-	f_closedir(&dj);
+	DIRCACHE_closedir(&dj);
 
 	return stack;
 }
@@ -1054,25 +1082,11 @@ uint64_t FS_split(uint64_t forth_stack) {
 }
 
 
-int count_words(const char *s) {
-	int i, w;
-
-	for (i = 0, w = 0; i < strlen(s); i++) {
-		if (!isspace ((int) *(s+i))) {
-			w++;
-			while (!isspace ((int) *(s+i)) && *(s+i) != '\0') {
-				i++;
-			}
-		}
-	}
-
-	return w;
-}
-
-
 /**
  *  @brief
  *      Word count, print newline, word, and byte counts for each file
+ *
+ *      The file is read in blocks of 4 KiB and counted in one pass.
  *  @param[in]
  *      forth_stack   TOS (lower word) and SPS (higher word)
  *  @return
@@ -1081,12 +1095,8 @@ int count_words(const char *s) {
 uint64_t FS_wc(uint64_t forth_stack) {
 	FIL fil;        /* File object */
 	FRESULT fr;     /* FatFs return code */
-	TCHAR* buf;
 	uint8_t *str = NULL;
 	int count = 1;
-	unsigned int line_count = 0;
-	unsigned int word_count = 0;
-	unsigned int char_count = 0;
 
 	uint64_t stack;
 	stack = forth_stack;
@@ -1104,24 +1114,14 @@ uint64_t FS_wc(uint64_t forth_stack) {
 
 		fr = f_open(&fil, path, FA_READ);
 		if (fr == FR_OK) {
-			while (!f_eof(&fil)) {
-				buf = f_gets(line, sizeof(line), &fil);
-				if (buf == NULL) {
-					// no lines left
-					break;
-				}
-				line_count++;
-				word_count += count_words(line);
-				char_count += strlen(line);
-			}
+			memset(&stream, 0, sizeof(stream));
+			stream.count = TRUE;
+			stack = stream_file(stack, &stream, &fil);
 			f_close(&fil);
-			snprintf(line, sizeof(line), "%5u %5u %5u %s",
-					line_count, word_count, char_count, path);
+			snprintf(line, sizeof(line), "%5lu %5lu %5lu %s",
+					stream.lines, stream.words, stream.bytes, path);
 			stack = FS_type(stack, (uint8_t*)line, strlen(line));
 			stack = FS_cr(stack);
-			line_count = 0;
-			word_count = 0;
-			char_count = 0;
 		} else {
 			// open file failed
 			stack = FS_type(stack, (uint8_t*)path, strlen(path));
@@ -1689,3 +1689,291 @@ int FS_getc(FIL* fp) {
 // Private Functions
 // *****************
 
+/**
+ *  @brief
+ *      Sets the pattern for the line search (Boyer-Moore-Horspool).
+ *  @param[in]
+ *      stream  stream
+ *  @param[in]
+ *      str     pattern
+ *  @param[in]
+ *      count   pattern length
+ *  @return
+ *      None
+ */
+static void stream_search(FS_Stream_t *stream, const uint8_t *str, int count) {
+	int i;
+
+	if (count > SEARCH_LENGTH) {
+		count = SEARCH_LENGTH;
+	}
+	memcpy(search, str, count);
+	stream->search_len = count;
+
+	memset(stream->skip, count, sizeof(stream->skip));
+	for (i = 0; i < count - 1; i++) {
+		stream->skip[search[i]] = count - 1 - i;
+	}
+}
+
+
+/**
+ *  @brief
+ *      Reads the file in blocks, counts and types it (see stream options).
+ *
+ *      The CRs are removed like f_gets() does (_USE_STRFUNC 2). Lines are
+ *      only split if they are longer than the block.
+ *  @param[in]
+ *      forth_stack   TOS (lower word) and SPS (higher word)
+ *  @param[in]
+ *      stream  stream
+ *  @param[in]
+ *      fil     open file
+ *  @return
+ *      TOS (lower word) and SPS (higher word)
+ */
+static uint64_t stream_file(uint64_t forth_stack, FS_Stream_t *stream, FIL *fil) {
+	uint64_t stack = forth_stack;
+	uint8_t *buf = mkfs_scratch;
+	int output = ! stream->count;
+	int lines = stream->number || stream->search_len > 0;
+	int carry = 0;
+	int end, complete, eof;
+	UINT rd_count;
+
+	do {
+		if (f_read(fil, buf + carry, SCRATCH_SIZE - carry, &rd_count) != FR_OK) {
+			break;
+		}
+		eof = rd_count < SCRATCH_SIZE - carry;
+		end = carry + strip_cr(buf + carry, rd_count);
+
+		if (stream->count) {
+			stream_count(stream, buf + carry, end - carry);
+		}
+		if (! output) {
+			carry = 0;
+			continue;
+		}
+		if (! lines) {
+			stack = stream_write(stack, stream, buf, end);
+			carry = 0;
+			continue;
+		}
+
+		// complete lines only, the rest is carried to the next block
+		complete = end;
+		if (! eof) {
+			while (complete > 0 && buf[complete-1] != '\n') {
+				complete--;
+			}
+			if (complete == 0) {
+				// line longer than the block
+				complete = end;
+			}
+		}
+		stack = stream_lines(stack, stream, buf, complete);
+		carry = end - complete;
+		memmove(buf, buf + complete, carry);
+	} while (! eof);
+
+	if (stream->count && stream->bytes > 0 && stream->last != '\n') {
+		// last line without a newline
+		stream->lines++;
+	}
+	return stream_flush(stack, stream);
+}
+
+
+/**
+ *  @brief
+ *      Types the lines with the line number (-n) or the lines with the
+ *      pattern (-p).
+ *  @return
+ *      TOS (lower word) and SPS (higher word)
+ */
+static uint64_t stream_lines(uint64_t forth_stack, FS_Stream_t *stream, const uint8_t *buf, int len) {
+	uint64_t stack = forth_stack;
+	const uint8_t *p = buf;
+	const uint8_t *end = buf + len;
+	const uint8_t *start, *match, *nl;
+	char number[16];
+
+	while (p < end) {
+		if (stream->search_len > 0) {
+			match = bmh_search(stream, p, end - p);
+			if (match == NULL) {
+				stream->line_num += count_newlines(p, end - p);
+				break;
+			}
+			for (start = match; start > p && start[-1] != '\n'; start--) {
+				;
+			}
+			stream->line_num += count_newlines(p, start - p);
+		} else {
+			start = p;
+			match = p;
+		}
+		nl = memchr(match, '\n', end - match);
+		p = (nl != NULL) ? nl + 1 : end;
+
+		if (stream->number) {
+			snprintf(number, sizeof(number), "%6i: ", stream->line_num);
+			stack = stream_write(stack, stream, (uint8_t*)number, strlen(number));
+		}
+		stream->line_num++;
+		stack = stream_write(stack, stream, start, p - start);
+	}
+	return stack;
+}
+
+
+/**
+ *  @brief
+ *      Batches the output for the console or the file (LF -> CRLF like
+ *      f_puts()).
+ *  @return
+ *      TOS (lower word) and SPS (higher word)
+ */
+static uint64_t stream_write(uint64_t forth_stack, FS_Stream_t *stream, const uint8_t *buf, int len) {
+	uint64_t stack = forth_stack;
+	int i;
+
+	if (stream->out == NULL && len >= BATCH_SIZE) {
+		// large blocks directly
+		stack = stream_flush(stack, stream);
+		return FS_type(stack, (uint8_t*)buf, len);
+	}
+
+	for (i = 0; i < len; i++) {
+		if (stream->batch_len >= BATCH_SIZE - 1) {
+			stack = stream_flush(stack, stream);
+		}
+		if (stream->out != NULL && buf[i] == '\n') {
+			batch[stream->batch_len++] = '\r';
+		}
+		batch[stream->batch_len++] = buf[i];
+	}
+	return stack;
+}
+
+
+/**
+ *  @brief
+ *      Writes the batched output.
+ *  @return
+ *      TOS (lower word) and SPS (higher word)
+ */
+static uint64_t stream_flush(uint64_t forth_stack, FS_Stream_t *stream) {
+	uint64_t stack = forth_stack;
+	UINT wr_count;
+
+	if (stream->batch_len > 0) {
+		if (stream->out != NULL) {
+			f_write(stream->out, batch, stream->batch_len, &wr_count);
+		} else {
+			stack = FS_type(stack, batch, stream->batch_len);
+		}
+		stream->batch_len = 0;
+	}
+	return stack;
+}
+
+
+/**
+ *  @brief
+ *      Counts newlines, words and bytes in one pass.
+ *  @return
+ *      None
+ */
+static void stream_count(FS_Stream_t *stream, const uint8_t *buf, int len) {
+	uint32_t lines = 0, words = 0;
+	uint8_t in_word = stream->in_word;
+	uint8_t c;
+	int i;
+
+	for (i = 0; i < len; i++) {
+		c = buf[i];
+		if (c == ' ' || (c >= '\t' && c <= '\r')) {
+			// isspace()
+			if (c == '\n') {
+				lines++;
+			}
+			in_word = FALSE;
+		} else if (! in_word) {
+			words++;
+			in_word = TRUE;
+		}
+	}
+
+	if (len > 0) {
+		stream->last = buf[len-1];
+	}
+	stream->in_word = in_word;
+	stream->lines += lines;
+	stream->words += words;
+	stream->bytes += len;
+}
+
+
+/**
+ *  @brief
+ *      Removes the CRs.
+ *  @return
+ *      new length
+ */
+static int strip_cr(uint8_t *buf, int len) {
+	uint8_t *cr = memchr(buf, '\r', len);
+	int i, n;
+
+	if (cr == NULL) {
+		return len;
+	}
+	n = cr - buf;
+	for (i = n + 1; i < len; i++) {
+		if (buf[i] != '\r') {
+			buf[n++] = buf[i];
+		}
+	}
+	return n;
+}
+
+
+/**
+ *  @brief
+ *      Boyer-Moore-Horspool search for the pattern.
+ *  @return
+ *      first match, NULL not found
+ */
+static const uint8_t *bmh_search(const FS_Stream_t *stream, const uint8_t *text, int len) {
+	int m = stream->search_len;
+	uint8_t last = search[m - 1];
+	uint8_t c;
+	int i = 0;
+
+	while (i <= len - m) {
+		c = text[i + m - 1];
+		if (c == last && memcmp(text + i, search, m - 1) == 0) {
+			return text + i;
+		}
+		i += stream->skip[c];
+	}
+	return NULL;
+}
+
+
+/**
+ *  @brief
+ *      Number of newlines.
+ */
+static int count_newlines(const uint8_t *buf, int len) {
+	const uint8_t *end = buf + len;
+	const uint8_t *nl;
+	int n = 0;
+
+	while ((nl = memchr(buf, '\n', end - buf)) != NULL) {
+		n++;
+		buf = nl + 1;
+	}
+	return n;
+}
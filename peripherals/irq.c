@@ -0,0 +1,181 @@
+/**
+ *  @brief
+ *      Forth interrupt hooks for C interrupt service routines.
+ *
+ *      The Forth registers R6 (TOS) and R7 (data stack pointer) are not
+ *      valid in an ISR, the interrupted code could be a C function.
+ *      IRQ_forth() (Forth/cube/interrupts.s) saves them and calls the
+ *      Forth word with a private data stack for each hook.
+ *
+ *      For each hook the latency (hardware ISR entry until the Forth word
+ *      is called) and the duration of the Forth word are measured in CPU
+ *      cycles.
+ *  @file
+ *      irq.c
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-19
+ *  @remark
+ *      Language: C, STM32CubeIDE GCC
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ *
+ *      Mecrsip-Cube is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with Mecrsip-Cube. If not, see http://www.gnu.org/licenses/.
+ */
+
+// System include files
+// ********************
+#include "cmsis_os.h"
+#include <stdio.h>
+#include <string.h>
+
+// Application include files
+// *************************
+#include "app_common.h"
+#include "main.h"
+#include "irq.h"
+#include "fs.h"
+
+
+// Private typedefs
+// ****************
+typedef struct {
+	uint32_t count;
+	uint32_t latency_min;
+	uint32_t latency_max;
+	uint64_t latency_sum;
+	uint32_t duration_min;
+	uint32_t duration_max;
+	uint64_t duration_sum;
+} IRQ_Stats_t;
+
+
+// Global Variables
+// ****************
+
+// Forth execution tokens, 0 for no hook
+uint32_t IRQ_hook[IRQ_HOOKS];
+
+// DWT cycle counter at the entry of the hardware ISR. A stamp per hook, an
+// ISR with a higher priority could preempt the ISR before the dispatch.
+volatile uint32_t IRQ_entry[IRQ_HOOKS];
+
+
+// Private Variables
+// *****************
+static const char * const name[IRQ_HOOKS] = {
+		"exti4", "exti6", "exti10", "exti13"
+};
+
+static uint32_t stack[IRQ_HOOKS][IRQ_STACK_SIZE];
+static IRQ_Stats_t stats[IRQ_HOOKS];
+
+
+// Public Functions
+// ****************
+
+/**
+ *  @brief
+ *      Initializes the IRQ hooks and starts the DWT cycle counter.
+ *  @return
+ *      None
+ */
+void IRQ_init(void) {
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+
+/**
+ *  @brief
+ *      Calls the Forth word in the hook, if there is any.
+ *
+ *      Has to be called from an ISR after IRQ_ENTRY(hook).
+ *  @param[in]
+ *      hook  hook number e.g. IRQ_EXTI4
+ *  @return
+ *      None
+ */
+void IRQ_dispatch(int hook) {
+	uint32_t xt;
+	uint32_t start;
+	uint32_t latency;
+	uint32_t duration;
+	IRQ_Stats_t *s;
+
+	xt = IRQ_hook[hook];
+	if (xt == 0) {
+		return;
+	}
+
+	start = DWT->CYCCNT;
+	IRQ_forth(xt, &stack[hook][IRQ_STACK_SIZE]);
+	duration = DWT->CYCCNT - start;
+	latency = start - IRQ_entry[hook];
+
+	s = &stats[hook];
+	if (s->count == 0 || latency < s->latency_min) {
+		s->latency_min = latency;
+	}
+	if (latency > s->latency_max) {
+		s->latency_max = latency;
+	}
+	if (s->count == 0 || duration < s->duration_min) {
+		s->duration_min = duration;
+	}
+	if (duration > s->duration_max) {
+		s->duration_max = duration;
+	}
+	s->latency_sum += latency;
+	s->duration_sum += duration;
+	s->count++;
+}
+
+
+/**
+ *  @brief
+ *      Prints the latency and duration statistics in CPU cycles.
+ *  @param[in]
+ *      forth_stack   TOS (lower word) and SPS (higher word)
+ *  @return
+ *      TOS (lower word) and SPS (higher word)
+ */
+uint64_t IRQ_print(uint64_t forth_stack) {
+	uint64_t stack;
+	char line[96];
+	IRQ_Stats_t s;
+	int i;
+
+	stack = forth_stack;
+	strcpy(line, "hook        count  latency min/avg/max  duration min/avg/max\n");
+	stack = FS_type(stack, (uint8_t*)line, strlen(line));
+	for (i = 0; i < IRQ_HOOKS; i++) {
+		// consistent copy
+		__disable_irq();
+		s = stats[i];
+		__enable_irq();
+		if (s.count == 0) {
+			continue;
+		}
+		snprintf(line, sizeof(line),
+				"irq-%-7s %6lu %6lu %6lu %6lu  %6lu %6lu %6lu\n",
+				name[i], s.count,
+				s.latency_min, (uint32_t)(s.latency_sum / s.count), s.latency_max,
+				s.duration_min, (uint32_t)(s.duration_sum / s.count), s.duration_max);
+		stack = FS_type(stack, (uint8_t*)line, strlen(line));
+	}
+	return stack;
+}
@@ -0,0 +1,55 @@
+/**
+ *  @brief
+ *      Forth interrupt hooks for C interrupt service routines.
+ *
+ *      The C ISR calls the Forth word in the hook with a private data stack.
+ *      Dispatch latency and duration are measured with the DWT cycle counter.
+ *  @file
+ *      irq.h
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-19
+ *  @remark
+ *      Language: C, STM32CubeIDE GCC
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ *
+ *      Mecrsip-Cube is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with Mecrsip-Cube. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef INC_IRQ_H_
+#define INC_IRQ_H_
+
+#define IRQ_STACK_SIZE		32		// cells in the private ISR data stack
+
+// hook numbers, the same as in Forth/cube/interrupts.s
+#define IRQ_EXTI4			0		// D10
+#define IRQ_EXTI6			1		// D2
+#define IRQ_EXTI10			2		// D4
+#define IRQ_EXTI13			3		// D7
+#define IRQ_HOOKS			4
+
+// time stamp at the entry of the hardware ISR, one per hook (nested ISRs)
+#define IRQ_ENTRY(hook)		(IRQ_entry[hook] = DWT->CYCCNT)
+
+extern uint32_t IRQ_hook[IRQ_HOOKS];
+extern volatile uint32_t IRQ_entry[IRQ_HOOKS];
+
+void IRQ_init(void);
+void IRQ_dispatch(int hook);
+void IRQ_forth(uint32_t xt, uint32_t *stack);
+uint64_t IRQ_print(uint64_t forth_stack);
+
+#endif /* INC_IRQ_H_ */
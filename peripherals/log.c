@@ -1,6 +1,18 @@
 /**
  *  @brief
+ *      Binary logger.
  *
+ *      LOG_write() (or the LOG0 .. LOG3 macros) stores the address of the
+ *      format string and the raw arguments into a RAM ring. Slots are
+ *      reserved with an atomic increment of the head, a record is valid
+ *      when its sequence number is written, no lock is needed and it can
+ *      be used in ISRs. Formatting is deferred.
+ *
+ *      A low priority thread appends the records to a log file if a file
+ *      is set (e.g. "0:/mecrisp.log" on the flash drive or "1:/..." on
+ *      the SD drive). The file is rotated to "<file>.1" when it reaches
+ *      LOG_FILE_SIZE. tools/logdecode.py decodes a log file with the help
+ *      of the firmware image (format strings).
  *  @file
  *      log.c
  *  @author
@@ -30,17 +42,30 @@
 // ********************
 #include "cmsis_os.h"
 #include <stdio.h>
+#include <string.h>
 
 // Application include files
 // *************************
 #include "app_common.h"
 #include "main.h"
-#include "wwdg.h"
-#include "clock.h"
+#include "ff.h"
+#include "fs.h"
+#include "myassert.h"
 #include "log.h"
 
+#define LOG_FLUSH			0x01			// thread flag
+#define LOG_FLUSH_PERIOD	1000			// ms
+#define LOG_BATCH			32				// records per f_write
+#define LOG_PATH_LENGTH		64
+#define LOG_IMAGE_BASE		0x08000000
+#define LOG_FORMAT_LENGTH	100				// max. user format string
+
 // Private function prototypes
 // ***************************
+static void LOG_Thread(void *argument);
+static void flush_file(void);
+static int write_file(LOG_Record_t *rec, int count);
+static int valid_format(const char *fmt);
 
 // Global Variables
 // ****************
@@ -51,16 +76,418 @@
 // RTOS resources
 // **************
 
+// Definitions for LOG thread
+static osThreadId_t LOG_ThreadId = NULL;
+static const osThreadAttr_t LOG_ThreadAttr = {
+		.name = "LOG",
+		.priority = (osPriority_t) osPriorityLow,
+		.stack_size = 128 * 16
+};
+
+static osMutexId_t LOG_MutexID;
+static const osMutexAttr_t LOG_MutexAttr = {
+		NULL,				// no name required
+		osMutexPrioInherit,	// attr_bits
+		NULL,				// memory for control block
+		0U					// size for control block
+};
+
 
 // Private Variables
 // *****************
+static LOG_Record_t log_ring[LOG_RECORDS];
+static volatile uint32_t log_head = 0;		// next sequence number to write
+static uint32_t log_tail = 0;				// next sequence number for the file
+static uint32_t log_lost = 0;				// records lost (overwritten) since startup
+static uint32_t log_lost_pending = 0;		// lost records not yet in the file
+
+static LOG_Record_t log_batch[LOG_BATCH];
+static char log_path[LOG_PATH_LENGTH] = "";
+static FIL log_fil;							// protected by LOG_MutexID
+
+static const char log_lost_fmt[] = "log: %u records lost";
+static const char log_format_fmt[] = "log: bad format at %x";
 
 
 // Public Functions
 // ****************
 
+/**
+ *  @brief
+ *      Initializes the logger.
+ *  @return
+ *      None
+ */
+void LOG_init(void) {
+	LOG_MutexID = osMutexNew(&LOG_MutexAttr);
+	ASSERT_fatal(LOG_MutexID != NULL, ASSERT_MUTEX_CREATION, __get_PC());
+
+	// creation of LOG_Thread
+	LOG_ThreadId = osThreadNew(LOG_Thread, NULL, &LOG_ThreadAttr);
+	ASSERT_fatal(LOG_ThreadId != NULL, ASSERT_THREAD_CREATION, __get_PC());
+}
+
+
+/**
+ *  @brief
+ *      Writes a record into the log ring.
+ *
+ *      Lock-free, can be used in ISRs. If the ring is full the oldest
+ *      records are overwritten.
+ *  @param[in]
+ *      fmt   printf format string (literal in flash)
+ *  @param[in]
+ *      a0    1st argument
+ *  @param[in]
+ *      a1    2nd argument
+ *  @param[in]
+ *      a2    3rd argument
+ *  @return
+ *      None
+ */
+void LOG_write(const char *fmt, uint32_t a0, uint32_t a1, uint32_t a2) {
+	uint32_t seq;
+	LOG_Record_t *rec;
+
+	// reserve a slot (LDREX/STREX)
+	seq = __atomic_fetch_add(&log_head, 1, __ATOMIC_RELAXED);
+	rec = &log_ring[seq & (LOG_RECORDS - 1)];
+
+	rec->seq = 0;	// the record is invalid till it is complete
+	__DMB();
+	rec->timestamp = osKernelGetTickCount();
+	rec->fmt = fmt;
+	rec->arg[0] = a0;
+	rec->arg[1] = a1;
+	rec->arg[2] = a2;
+	__DMB();
+	rec->seq = seq + 1;
+
+	if (log_path[0] != 0 && (seq - log_tail) == LOG_RECORDS / 2
+			&& LOG_ThreadId != NULL) {
+		// ring half full, wake up the LOG thread
+		osThreadFlagsSet(LOG_ThreadId, LOG_FLUSH);
+	}
+}
+
+
+/**
+ *  @brief
+ *      Writes a record with a user format string into the log ring (>log).
+ *
+ *      The format string is checked, only integer conversions (d i o u x X
+ *      c) without * are allowed. Otherwise the address of the format string
+ *      is logged.
+ *  @param[in]
+ *      fmt   0-terminated printf format string (has to stay)
+ *  @param[in]
+ *      a0    1st argument
+ *  @param[in]
+ *      a1    2nd argument
+ *  @param[in]
+ *      a2    3rd argument
+ *  @return
+ *      0 for success, -1 bad format
+ */
+int LOG_writeUser(const char *fmt, uint32_t a0, uint32_t a1, uint32_t a2) {
+	if (!valid_format(fmt)) {
+		LOG_write(log_format_fmt, (uint32_t) fmt, 0, 0);
+		return -1;
+	}
+	LOG_write(fmt, a0, a1, a2);
+	return 0;
+}
+
+
+/**
+ *  @brief
+ *      Writes the pending records to the log file.
+ *
+ *      Does not work in ISRs.
+ *  @return
+ *      None
+ */
+void LOG_flush(void) {
+	flush_file();
+}
+
+
+/**
+ *  @brief
+ *      Sets the log file.
+ *
+ *      An empty string switches off the log file, the records remain in
+ *      the RAM ring only.
+ *  @param[in]
+ *      str   file path (w/ or w/o null termination)
+ *  @param[in]
+ *      count string length
+ *  @return
+ *      0 for success
+ */
+int LOG_setFile(uint8_t *str, int count) {
+	if (count >= LOG_PATH_LENGTH) {
+		return -1;
+	}
+	osMutexAcquire(LOG_MutexID, osWaitForever);
+	memcpy(log_path, str, count);
+	log_path[count] = 0;
+	// the file gets the records from now on
+	log_tail = log_head;
+	osMutexRelease(LOG_MutexID);
+	return 0;
+}
+
+
+/**
+ *  @brief
+ *      How many records are lost (overwritten before they were written to
+ *      the file)?
+ *  @return
+ *      lost records since startup
+ */
+int LOG_getLost(void) {
+	return log_lost;
+}
+
+
+/**
+ *  @brief
+ *      Copies the most recent complete records from the RAM ring.
+ *
+ *      Lock-free, used by the crash dump in fault handlers.
+ *  @param[out]
+ *      rec   buffer for the records, oldest first
+ *  @param[in]
+ *      count max. number of records
+ *  @return
+ *      number of records copied
+ */
+int LOG_getRecent(LOG_Record_t *rec, int count) {
+	uint32_t seq, head;
+	int n = 0;
+
+	head = log_head;
+	seq = (head > (uint32_t)count) ? head - count : 0;
+	for (; seq != head; seq++) {
+		rec[n] = log_ring[seq & (LOG_RECORDS - 1)];
+		if (rec[n].seq == seq + 1) {
+			n++;
+		}
+	}
+	return n;
+}
+
+
+/**
+ *  @brief
+ *      Prints the records in the RAM ring.
+ *  @param[in]
+ *      forth_stack   TOS (lower word) and SPS (higher word)
+ *  @return
+ *      TOS (lower word) and SPS (higher word)
+ */
+uint64_t LOG_print(uint64_t forth_stack) {
+	uint64_t stack;
+	char line[128];
+	uint32_t seq, head;
+	LOG_Record_t rec;
+	int n;
+
+	stack = forth_stack;
+	head = log_head;
+	seq = (head > LOG_RECORDS) ? head - LOG_RECORDS : 0;
+	for (; seq != head; seq++) {
+		rec = log_ring[seq & (LOG_RECORDS - 1)];
+		if (rec.seq != seq + 1) {
+			// overwritten or not yet complete
+			continue;
+		}
+		n = snprintf(line, sizeof(line), "%10lu ", rec.timestamp);
+		snprintf(line + n, sizeof(line) - n - 1, rec.fmt,
+				rec.arg[0], rec.arg[1], rec.arg[2]);
+		strcat(line, "\n");
+		stack = FS_type(stack, (uint8_t*)line, strlen(line));
+	}
+	return stack;
+}
 
 
 // Private Functions
 // *****************
 
+/**
+  * @brief
+  * 	Function implementing the LOG thread.
+  * @param
+  * 	argument: Not used
+  * @retval
+  * 	None
+  */
+static void LOG_Thread(void *argument) {
+	uint32_t timeout;
+
+	// Infinite loop
+	for(;;) {
+		// no periodic wakeup if there is nothing to write
+		if (log_path[0] != 0 && log_head != log_tail) {
+			timeout = LOG_FLUSH_PERIOD;
+		} else {
+			timeout = osWaitForever;
+		}
+		osThreadFlagsWait(LOG_FLUSH, osFlagsWaitAny, timeout);
+		flush_file();
+	}
+}
+
+
+/**
+  * @brief
+  * 	Copies the pending records from the ring and appends them to the
+  * 	log file.
+  * @retval
+  * 	None
+  */
+static void flush_file(void) {
+	LOG_Record_t *rec;
+	uint32_t head, seq;
+	int n;
+
+	osMutexAcquire(LOG_MutexID, osWaitForever);
+	if (log_path[0] == 0) {
+		log_tail = log_head;
+		osMutexRelease(LOG_MutexID);
+		return;
+	}
+	do {
+		head = log_head;
+		if ((head - log_tail) > LOG_RECORDS) {
+			// overrun, the oldest records are overwritten
+			log_lost_pending += head - LOG_RECORDS - log_tail;
+			log_tail = head - LOG_RECORDS;
+		}
+		n = 0;
+		if (log_lost_pending > 0) {
+			log_batch[n].seq = 0;
+			log_batch[n].timestamp = osKernelGetTickCount();
+			log_batch[n].fmt = log_lost_fmt;
+			log_batch[n].arg[0] = log_lost_pending;
+			log_batch[n].arg[1] = 0;
+			log_batch[n].arg[2] = 0;
+			log_lost += log_lost_pending;
+			log_lost_pending = 0;
+			n++;
+		}
+		while (log_tail != head && n < LOG_BATCH) {
+			rec = &log_ring[log_tail & (LOG_RECORDS - 1)];
+			seq = rec->seq;
+			if (seq != log_tail + 1) {
+				if ((int32_t)(seq - (log_tail + 1)) > 0) {
+					// overwritten
+					log_lost_pending++;
+					log_tail++;
+					continue;
+				}
+				// still written by a producer
+				break;
+			}
+			log_batch[n] = *rec;
+			__DMB();
+			if (rec->seq != seq) {
+				// overwritten while copying
+				log_lost_pending++;
+				log_tail++;
+				continue;
+			}
+			n++;
+			log_tail++;
+		}
+		if (n > 0 && write_file(log_batch, n) != 0) {
+			break;
+		}
+	} while (n == LOG_BATCH);
+	osMutexRelease(LOG_MutexID);
+}
+
+
+/**
+  * @brief
+  * 	Appends the records to the log file, rotates the file.
+  * @param[in]
+  * 	rec   records
+  * @param[in]
+  * 	count number of records
+  * @retval
+  * 	0 for success
+  */
+static int write_file(LOG_Record_t *rec, int count) {
+	FIL *fil = &log_fil;
+	FRESULT fr;
+	UINT bw;
+	LOG_Header_t header;
+	char old_path[LOG_PATH_LENGTH + 2];
+
+	fr = f_open(fil, log_path, FA_OPEN_APPEND | FA_WRITE);
+	if (fr != FR_OK) {
+		return -1;
+	}
+	if (f_size(fil) == 0) {
+		header.magic = LOG_MAGIC;
+		header.version = LOG_VERSION;
+		header.record_size = sizeof(LOG_Record_t);
+		header.image_base = LOG_IMAGE_BASE;
+		fr = f_write(fil, &header, sizeof(header), &bw);
+	}
+	if (fr == FR_OK) {
+		fr = f_write(fil, rec, count * sizeof(LOG_Record_t), &bw);
+	}
+	if (fr == FR_OK && f_size(fil) >= LOG_FILE_SIZE) {
+		f_close(fil);
+		// rotate
+		strcpy(old_path, log_path);
+		strcat(old_path, ".1");
+		f_unlink(old_path);
+		f_rename(log_path, old_path);
+		return 0;
+	}
+	f_close(fil);
+	return (fr == FR_OK) ? 0 : -1;
+}
+
+
+/**
+  * @brief
+  * 	Checks a user format string, printf gets 3 uint32_t arguments.
+  * @param[in]
+  * 	fmt   format string
+  * @retval
+  * 	TRUE only integer conversions, not too long
+  */
+static int valid_format(const char *fmt) {
+	int i, args = 0;
+
+	for (i = 0; fmt[i] != 0; i++) {
+		if (i >= LOG_FORMAT_LENGTH) {
+			return FALSE;
+		}
+		if (fmt[i] != '%') {
+			continue;
+		}
+		i++;
+		if (fmt[i] == '%') {
+			continue;
+		}
+		// flags, width, precision
+		while (fmt[i] != 0 && strchr("-+ #0123456789.", fmt[i]) != NULL) {
+			i++;
+		}
+		// length modifier (32 bit)
+		if (fmt[i] == 'l' || fmt[i] == 'h') {
+			i++;
+		}
+		if (fmt[i] == 0 || strchr("diouxXc", fmt[i]) == NULL || ++args > 3) {
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
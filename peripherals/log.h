@@ -1,6 +1,10 @@
 /**
  *  @brief
+ *      Binary logger.
  *
+ *      Call sites record a format string (the id) and up to three 32-bit
+ *      arguments into a RAM ring. Formatting is deferred to .log or the
+ *      host-side decoder tools/logdecode.py.
  *  @file
  *      log.h
  *  @author
@@ -31,5 +35,53 @@
 #ifndef INC_LOG_H_
 #define INC_LOG_H_
 
+#define LOG_RECORDS			256				// RAM ring, power of 2
+#define LOG_FILE_SIZE		(64 * 1024)		// rotate the log file at this size
+#define LOG_MAGIC			0x474C434D		// "MCLG" file header magic
+#define LOG_VERSION			1
+
+/** Log record in the RAM ring and in the log file */
+typedef struct {
+	/** sequence number + 1, 0 while the record is written */
+	uint32_t		seq;
+	/** kernel ticks (ms) */
+	uint32_t		timestamp;
+	/** printf format string in flash, the address is the id */
+	const char		*fmt;
+	/** arguments */
+	uint32_t		arg[3];
+} LOG_Record_t;
+
+/** Log file header */
+typedef struct {
+	uint32_t		magic;
+	uint32_t		version;
+	/** size of a LOG_Record_t */
+	uint32_t		record_size;
+	/** flash address of the firmware image for the format strings */
+	uint32_t		image_base;
+} LOG_Header_t;
+
+void LOG_init(void);
+void LOG_write(const char *fmt, uint32_t a0, uint32_t a1, uint32_t a2);
+int LOG_writeUser(const char *fmt, uint32_t a0, uint32_t a1, uint32_t a2);
+void LOG_flush(void);
+int LOG_setFile(uint8_t *str, int count);
+int LOG_getLost(void);
+int LOG_getRecent(LOG_Record_t *rec, int count);
+uint64_t LOG_print(uint64_t forth_stack);
+
+/**
+ *  @brief
+ *      Log a format string with 0 to 3 arguments, usable in ISRs.
+ *
+ *      The format string has to be a literal, the arguments are 32-bit
+ *      integers (%d, %u, %x, %c).
+ */
+#define LOG0(fmt)				LOG_write((fmt), 0, 0, 0)
+#define LOG1(fmt, a)			LOG_write((fmt), (uint32_t)(a), 0, 0)
+#define LOG2(fmt, a, b)			LOG_write((fmt), (uint32_t)(a), (uint32_t)(b), 0)
+#define LOG3(fmt, a, b, c)		LOG_write((fmt), (uint32_t)(a), (uint32_t)(b), (uint32_t)(c))
+
 
 #endif /* INC_LOG_H_ */
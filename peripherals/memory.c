@@ -0,0 +1,308 @@
+/**
+ *  @brief
+ *      Memory-to-memory DMA for move and fill.
+ *
+ *      The Forth words move, cmove, cmove>, fill and erase (memmove.s) hand
+ *      large blocks in RAM over to DMA2 channel 1. The calling task is
+ *      blocked till the transfer is complete, other tasks can run. The DMA
+ *      transfers only whole words, the Forth word does the head and tail
+ *      bytes.
+ *
+ *      If the DMA is not possible (ISR, RTOS not running, channel busy,
+ *      not in RAM, unaligned, overlapping) the functions return 0 and the
+ *      CPU does the job.
+ *  @file
+ *      memory.c
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-18
+ *  @remark
+ *      Language: C, STM32CubeIDE GCC
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ *
+ *      Mecrsip-Cube is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with Mecrsip-Cube. If not, see http://www.gnu.org/licenses/.
+ */
+
+// System include files
+// ********************
+#include "cmsis_os.h"
+
+// Application include files
+// *************************
+#include "app_common.h"
+#include "main.h"
+#include "myassert.h"
+#include "memory.h"
+
+#if MEM_DMA == 1
+
+#define MEMORY_DMA_BUSY		0				// dma_status
+#define MEMORY_DMA_DONE		1
+#define MEMORY_DMA_ERROR	2
+#define MEMORY_DMA_MAX		0xFFFF			// words per transfer
+#define MEMORY_RAM_START	0x20000000		// SRAM1
+#define MEMORY_RAM_END		0x20030000
+
+// Private function prototypes
+// ***************************
+static int dma_lock(void);
+static uint32_t dma_transfer(uint32_t src, uint32_t dst, uint32_t words, int increment);
+static int in_ram(uint32_t adr, uint32_t count);
+static void dma_complete(DMA_HandleTypeDef *hdma);
+static void dma_error(DMA_HandleTypeDef *hdma);
+
+// Global Variables
+// ****************
+
+// Hardware resources
+// ******************
+DMA_HandleTypeDef hdma_memtomem_dma2_channel1;
+
+// RTOS resources
+// **************
+
+static osMutexId_t MEMORY_MutexID = NULL;
+static const osMutexAttr_t MEMORY_MutexAttr = {
+		NULL,				// no name required
+		osMutexPrioInherit,	// attr_bits
+		NULL,				// memory for control block
+		0U					// size for control block
+};
+
+static osSemaphoreId_t MEMORY_SemaphoreID = NULL;	// transfer complete or error
+
+
+// Private Variables
+// *****************
+static volatile int dma_status;
+static uint32_t fill_pattern;
+
+
+// Public Functions
+// ****************
+
+/**
+ *  @brief
+ *      Initializes the memory-to-memory DMA.
+ *  @return
+ *      None
+ */
+void MEMORY_init(void) {
+	MEMORY_MutexID = osMutexNew(&MEMORY_MutexAttr);
+	ASSERT_fatal(MEMORY_MutexID != NULL, ASSERT_MUTEX_CREATION, __get_PC());
+	MEMORY_SemaphoreID = osSemaphoreNew(1, 0, NULL);
+	ASSERT_fatal(MEMORY_SemaphoreID != NULL, ASSERT_SEMAPHORE_CREATION, __get_PC());
+
+	__HAL_RCC_DMA2_CLK_ENABLE();
+	__HAL_RCC_DMAMUX1_CLK_ENABLE();
+
+	hdma_memtomem_dma2_channel1.Instance = DMA2_Channel1;
+	hdma_memtomem_dma2_channel1.Init.Request = DMA_REQUEST_MEM2MEM;
+	hdma_memtomem_dma2_channel1.Init.Direction = DMA_MEMORY_TO_MEMORY;
+	hdma_memtomem_dma2_channel1.Init.PeriphInc = DMA_PINC_ENABLE;
+	hdma_memtomem_dma2_channel1.Init.MemInc = DMA_MINC_ENABLE;
+	hdma_memtomem_dma2_channel1.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+	hdma_memtomem_dma2_channel1.Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
+	hdma_memtomem_dma2_channel1.Init.Mode = DMA_NORMAL;
+	hdma_memtomem_dma2_channel1.Init.Priority = DMA_PRIORITY_LOW;
+	if (HAL_DMA_Init(&hdma_memtomem_dma2_channel1) != HAL_OK) {
+		Error_Handler();
+	}
+	hdma_memtomem_dma2_channel1.XferCpltCallback = dma_complete;
+	hdma_memtomem_dma2_channel1.XferErrorCallback = dma_error;
+
+	HAL_NVIC_SetPriority(DMA2_Channel1_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(DMA2_Channel1_IRQn);
+}
+
+
+/**
+ *  @brief
+ *      Copies the whole words of a block by DMA.
+ *
+ *      Blocks the calling task till the transfer is complete.
+ *  @param[in]
+ *      src    source address
+ *  @param[in]
+ *      dst    destination address
+ *  @param[in]
+ *      count  number of bytes
+ *  @return
+ *      number of bytes copied (from the start), 0 if the DMA is not possible
+ */
+uint32_t MEMORY_dmaMove(uint32_t src, uint32_t dst, uint32_t count) {
+	uint32_t done;
+
+	if (((src | dst) & 3) != 0 || !in_ram(src, count) || !in_ram(dst, count)) {
+		return 0;
+	}
+	if (dst < src + count && src < dst + count) {
+		// overlapping
+		return 0;
+	}
+	if (!dma_lock()) {
+		return 0;
+	}
+	done = dma_transfer(src, dst, count / 4, TRUE);
+	osMutexRelease(MEMORY_MutexID);
+	return done;
+}
+
+
+/**
+ *  @brief
+ *      Fills the whole words of a block by DMA.
+ *
+ *      Blocks the calling task till the transfer is complete.
+ *  @param[in]
+ *      dst      destination address (word aligned)
+ *  @param[in]
+ *      count    number of bytes
+ *  @param[in]
+ *      pattern  fill word
+ *  @return
+ *      number of bytes filled (from the start), 0 if the DMA is not possible
+ */
+uint32_t MEMORY_dmaFill(uint32_t dst, uint32_t count, uint32_t pattern) {
+	uint32_t done;
+
+	if ((dst & 3) != 0 || !in_ram(dst, count)) {
+		return 0;
+	}
+	if (!dma_lock()) {
+		return 0;
+	}
+	fill_pattern = pattern;
+	done = dma_transfer((uint32_t)&fill_pattern, dst, count / 4, FALSE);
+	osMutexRelease(MEMORY_MutexID);
+	return done;
+}
+
+
+// Private Functions
+// *****************
+
+/**
+  * @brief
+  * 	Gets the DMA channel.
+  *
+  * 	Does not wait, if the channel is busy the CPU is faster.
+  * @retval
+  * 	TRUE if the DMA channel can be used
+  */
+static int dma_lock(void) {
+	if (MEMORY_MutexID == NULL || __get_IPSR() != 0
+			|| osKernelGetState() != osKernelRunning) {
+		return FALSE;
+	}
+	return osMutexAcquire(MEMORY_MutexID, 0) == osOK;
+}
+
+
+/**
+  * @brief
+  * 	Transfers words by DMA and waits for the completion.
+  * @param[in]
+  * 	src        source address
+  * @param[in]
+  * 	dst        destination address
+  * @param[in]
+  * 	words      number of words
+  * @param[in]
+  * 	increment  FALSE to repeat the source word (fill)
+  * @retval
+  * 	number of bytes transferred
+  */
+static uint32_t dma_transfer(uint32_t src, uint32_t dst, uint32_t words, int increment) {
+	uint32_t done = 0;
+	uint32_t chunk;
+
+	// EN stays set after the transfer complete, CCR is read-only while EN=1
+	__HAL_DMA_DISABLE(&hdma_memtomem_dma2_channel1);
+	if (increment) {
+		hdma_memtomem_dma2_channel1.Instance->CCR |= DMA_CCR_PINC;
+	} else {
+		hdma_memtomem_dma2_channel1.Instance->CCR &= ~DMA_CCR_PINC;
+	}
+
+	while (done < words) {
+		chunk = words - done;
+		if (chunk > MEMORY_DMA_MAX) {
+			chunk = MEMORY_DMA_MAX;
+		}
+		osSemaphoreAcquire(MEMORY_SemaphoreID, 0);	// no stale token
+		dma_status = MEMORY_DMA_BUSY;
+		if (HAL_DMA_Start_IT(&hdma_memtomem_dma2_channel1,
+				increment ? src + done * 4 : src, dst + done * 4, chunk) != HAL_OK) {
+			break;
+		}
+		osSemaphoreAcquire(MEMORY_SemaphoreID, osWaitForever);
+		if (dma_status != MEMORY_DMA_DONE) {
+			break;
+		}
+		done += chunk;
+	}
+	return done * 4;
+}
+
+
+/**
+  * @brief
+  * 	Is the block in the SRAM1 (reachable by DMA)?
+  * @param[in]
+  * 	adr
+  * @param[in]
+  * 	count  in bytes
+  * @retval
+  * 	TRUE if it is in the SRAM1
+  */
+static int in_ram(uint32_t adr, uint32_t count) {
+	return adr >= MEMORY_RAM_START && adr < MEMORY_RAM_END
+			&& count <= MEMORY_RAM_END - adr;
+}
+
+
+// Callbacks
+// *********
+
+/**
+  * @brief
+  * 	DMA transfer complete callback
+  * @param[in]
+  * 	hdma  DMA handle
+  * @retval
+  * 	None
+  */
+static void dma_complete(DMA_HandleTypeDef *hdma) {
+	dma_status = MEMORY_DMA_DONE;
+	osSemaphoreRelease(MEMORY_SemaphoreID);
+}
+
+
+/**
+  * @brief
+  * 	DMA transfer error callback
+  * @param[in]
+  * 	hdma  DMA handle
+  * @retval
+  * 	None
+  */
+static void dma_error(DMA_HandleTypeDef *hdma) {
+	dma_status = MEMORY_DMA_ERROR;
+	osSemaphoreRelease(MEMORY_SemaphoreID);
+}
+
+#endif // MEM_DMA
@@ -0,0 +1,38 @@
+/**
+ *  @brief
+ *      Memory-to-memory DMA for move and fill.
+ *  @file
+ *      memory.h
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-18
+ *  @remark
+ *      Language: C, STM32CubeIDE GCC
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ *
+ *      Mecrsip-Cube is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with Mecrsip-Cube. If not, see http://www.gnu.org/licenses/.
+ */
+
+
+
+#ifndef INC_MEMORY_H_
+#define INC_MEMORY_H_
+
+void MEMORY_init(void);
+uint32_t MEMORY_dmaMove(uint32_t src, uint32_t dst, uint32_t count);
+uint32_t MEMORY_dmaFill(uint32_t dst, uint32_t count, uint32_t pattern);
+
+#endif /* INC_MEMORY_H_ */
@@ -85,13 +85,16 @@ static const char* const assert_msg[] = {
 		"ASSERT_UART_SIGINT",				// 15
 		"ASSERT_UART_ERROR_CALLBACK",		// 16
 		"ASSERT_UART_FIFO",					// 17
+		"ASSERT_I2C",						// 18
 
-		"ASSERT_FLASH_UNLOCK",				// 18
-		"ASSERT_FLASH_LOCK",				// 19
+		"ASSERT_FLASH_UNLOCK",				// 19
+		"ASSERT_FLASH_LOCK",				// 20
 
-		"ASSERT_FREERTOS",					// 20
+		"ASSERT_FREERTOS",					// 21
 
-		"ASSERT_CRS_SIGINT"                 // 21
+		"ASSERT_CRS_SIGINT",                // 22
+
+		"ASSERT_WATCHDOG"					// 23
 };
 
 
@@ -112,6 +115,9 @@ void ASSERT_init(void) {
 		assert_occurred = TRUE;
 		RTC_Backup.assert_cnt += 1;
 		RTC_Backup.assert = 0;
+		// the log ring did not survive the reset
+		LOG3("restart after assert %u param %x (%u asserts)",
+				RTC_Backup.assert_id, RTC_Backup.assert_param, RTC_Backup.assert_cnt);
 	} else {
 		assert_occurred = FALSE;
 	}
@@ -176,6 +182,9 @@ int ASSERT_getParam(void) {
  *
  */
 char* ASSERT_getMsg(int index) {
+	if (index < 0 || index >= (int)(sizeof(assert_msg) / sizeof(assert_msg[0]))) {
+		return "ASSERT_UNKNOWN";
+	}
 	return  (char*) assert_msg[index];
 }
 
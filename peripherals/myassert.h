@@ -33,6 +33,7 @@
 
 #include "app_conf.h"
 #include "clock.h"
+#include "log.h"
 
 #ifndef CFG_ASSERT_ON
 #define CFG_ASSERT_ON	1
@@ -67,6 +68,8 @@
 
 #define ASSERT_CRS_SIGINT				22
 
+#define ASSERT_WATCHDOG					23
+
 #define ASSERT_UNKNOWN					99
 
 void ASSERT_init(void);
@@ -107,6 +110,7 @@ __attribute__( ( always_inline ) ) static inline uint32_t __get_PC(void)
 #if CFG_ASSERT_ON == 1
 #define ASSERT_nonfatal(cond, id, param)                \
   if (!(cond)) {                                        \
+	LOG2("assert %u param %x", id, param);              \
 	RTC_Backup.assert = RTC_MAGIC_COOKIE;               \
 	RTC_Backup.assert_id = id;                          \
 	RTC_Backup.assert_param = param;                    \
@@ -131,6 +135,7 @@ __attribute__( ( always_inline ) ) static inline uint32_t __get_PC(void)
  */
 #define ASSERT_fatal(cond, id, param)                   \
   if (!(cond)) {                                        \
+	LOG2("fatal assert %u param %x", id, param);        \
 	RTC_Backup.assert = RTC_MAGIC_COOKIE;               \
 	RTC_Backup.assert_id = id;                          \
 	RTC_Backup.assert_param = param;                    \
@@ -0,0 +1,344 @@
+/**
+ *  @brief
+ *      Statistical sampling profiler.
+ *
+ *      The LPTIM2 ISR (LSE clock, priority above the RTOS ISRs) samples the
+ *      PC and LR of the interrupted code: threads, C code, Forth words in
+ *      flash and RAM and the ISRs with a lower priority. The samples are
+ *      counted in a hash table (PC as key) in RAM, the ISR takes about
+ *      50 cycles.
+ *
+ *      PROFILE_print() resolves the samples by the dictionary index (see
+ *      dict.c). Samples in C code are printed as address (see the map file)
+ *      with the calling Forth word.
+ *      The time in the low power mode (Stop2) is not sampled, LPTIM2 stops.
+ *  @file
+ *      profile.c
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-19
+ *  @remark
+ *      Language: C, STM32CubeIDE GCC
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ *
+ *      Mecrsip-Cube is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with Mecrsip-Cube. If not, see http://www.gnu.org/licenses/.
+ */
+
+// System include files
+// ********************
+#include "cmsis_os.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Application include files
+// *************************
+#include "app_common.h"
+#include "main.h"
+#include "profile.h"
+#include "dict.h"
+#include "fs.h"
+
+
+#define PROFILE_SLOTS_BITS	9
+#define PROFILE_SLOTS		(1 << PROFILE_SLOTS_BITS)	// hash table size
+#define PROFILE_PROBES		8			// linear probing, then the sample is lost
+#define PROFILE_RATE		997			// Hz, default, not a multiple of the RTOS tick
+#define PROFILE_MAX_RATE	(LSE_VALUE / 8)
+#define PROFILE_PRIORITY	4			// above the RTOS ISRs (5 .. 15)
+#define PROFILE_TOP			24			// printed lines
+#define PROFILE_LINE_LENGTH	96
+
+
+// Private typedefs
+// ****************
+typedef struct {
+	uint32_t pc;
+	uint32_t lr;
+	uint32_t count;
+	uint32_t ipsr;
+} PROFILE_Slot_t;
+
+typedef struct {
+	uint32_t pc;			// C code
+	uint32_t header;		// Forth word, 0 for C code
+	uint32_t lr;
+	uint32_t count;
+	uint32_t ipsr;
+} PROFILE_Entry_t;
+
+
+// Private function prototypes
+// ***************************
+static int compare_header(const void *a, const void *b);
+static int compare_count(const void *a, const void *b);
+static int format_entry(const PROFILE_Entry_t *entry, uint32_t total, uint32_t dictionary,
+		char *line, size_t size);
+
+// Global Variables
+// ****************
+
+// Hardware resources
+// ******************
+
+// RTOS resources
+// **************
+
+
+// Private Variables
+// *****************
+static PROFILE_Slot_t slot[PROFILE_SLOTS];
+static volatile uint32_t samples;
+static volatile uint32_t lost;
+static uint32_t rate;
+
+
+// Public Functions
+// ****************
+
+/**
+ *  @brief
+ *      Starts sampling.
+ *  @param[in]
+ *      hz  sample rate, 0 for the default (997 Hz)
+ *  @return
+ *      None
+ */
+void PROFILE_start(uint32_t hz) {
+	if (hz == 0 || hz > PROFILE_MAX_RATE) {
+		hz = PROFILE_RATE;
+	}
+	PROFILE_stop();
+	rate = hz;
+
+	// LPTIM2 for the sampler, LSE
+	__HAL_RCC_LPTIM2_CONFIG(RCC_LPTIM2CLKSOURCE_LSE);
+	__HAL_RCC_LPTIM2_CLK_ENABLE();
+	LPTIM2->IER = LPTIM_IER_ARRMIE;		// only if disabled
+	HAL_NVIC_SetPriority(LPTIM2_IRQn, PROFILE_PRIORITY, 0);
+	HAL_NVIC_EnableIRQ(LPTIM2_IRQn);
+
+	LPTIM2->CR = LPTIM_CR_ENABLE;
+	LPTIM2->ARR = LSE_VALUE / hz - 1;
+	while (! (LPTIM2->ISR & LPTIM_ISR_ARROK)) {
+		;
+	}
+	LPTIM2->ICR = LPTIM_ICR_ARROKCF;
+	LPTIM2->CR = LPTIM_CR_ENABLE | LPTIM_CR_CNTSTRT;
+}
+
+
+/**
+ *  @brief
+ *      Stops sampling, the samples are kept.
+ *  @return
+ *      None
+ */
+void PROFILE_stop(void) {
+	HAL_NVIC_DisableIRQ(LPTIM2_IRQn);
+	LPTIM2->CR = 0;
+	HAL_NVIC_ClearPendingIRQ(LPTIM2_IRQn);
+}
+
+
+/**
+ *  @brief
+ *      Clears the samples.
+ *  @return
+ *      None
+ */
+void PROFILE_clear(void) {
+	BACKUP_PRIMASK();
+	DISABLE_IRQ();
+	memset(slot, 0, sizeof(slot));
+	samples = 0;
+	lost = 0;
+	RESTORE_PRIMASK();
+}
+
+
+/**
+ *  @brief
+ *      Counts a sample, called from the LPTIM2 ISR (see PROFILE_SAMPLE()).
+ *  @param[in]
+ *      frame  exception stack frame of the interrupted code
+ *  @return
+ *      None
+ */
+void PROFILE_sample(uint32_t *frame) {
+	uint32_t pc = frame[6] & ~1;
+	uint32_t i, n;
+
+	LPTIM2->ICR = LPTIM_ICR_ARRMCF;
+	samples++;
+
+	i = ((pc >> 1) * 2654435761U) >> (32 - PROFILE_SLOTS_BITS);
+	for (n = 0; n < PROFILE_PROBES; n++) {
+		if (slot[i].pc == pc || slot[i].count == 0) {
+			slot[i].pc = pc;
+			slot[i].lr = frame[5];
+			slot[i].ipsr = frame[7] & IPSR_ISR_Msk;
+			slot[i].count++;
+			return;
+		}
+		i = (i + 1) & (PROFILE_SLOTS - 1);
+	}
+	lost++;
+}
+
+
+/**
+ *  @brief
+ *      Prints where the time is spent, the words and C addresses with the
+ *      most samples first.
+ *  @param[in]
+ *      forth_stack   TOS (lower word) and SPS (higher word)
+ *  @param[in]
+ *      dictionary    start of the dictionary chain (dictionarystart)
+ *  @return
+ *      TOS (lower word) and SPS (higher word)
+ */
+uint64_t PROFILE_print(uint64_t forth_stack, uint32_t dictionary) {
+	uint64_t stack;
+	char line[PROFILE_LINE_LENGTH];
+	PROFILE_Entry_t *entry;
+	uint32_t total;
+	int i, n, entries;
+
+	stack = forth_stack;
+	total = samples;
+	snprintf(line, sizeof(line), "samples %lu  lost %lu  rate %lu Hz\n",
+			total, lost, rate);
+	stack = FS_type(stack, (uint8_t*)line, strlen(line));
+	if (total == 0) {
+		return stack;
+	}
+
+	entry = pvPortMalloc(PROFILE_SLOTS * sizeof(PROFILE_Entry_t));
+	if (entry == NULL) {
+		strcpy(line, "not enough memory\n");
+		return FS_type(stack, (uint8_t*)line, strlen(line));
+	}
+
+	// snapshot
+	entries = 0;
+	HAL_NVIC_DisableIRQ(LPTIM2_IRQn);
+	total = samples;
+	for (i = 0; i < PROFILE_SLOTS; i++) {
+		if (slot[i].count > 0) {
+			entry[entries].pc = slot[i].pc;
+			entry[entries].lr = slot[i].lr;
+			entry[entries].count = slot[i].count;
+			entry[entries].ipsr = slot[i].ipsr;
+			entries++;
+		}
+	}
+	if (LPTIM2->CR & LPTIM_CR_ENABLE) {
+		HAL_NVIC_EnableIRQ(LPTIM2_IRQn);
+	}
+
+	// samples in the same word are summed up, C code is kept by address
+	for (i = 0; i < entries; i++) {
+		entry[i].header = DICT_addrToHeader(entry[i].pc, dictionary);
+	}
+	qsort(entry, entries, sizeof(PROFILE_Entry_t), compare_header);
+	n = 0;
+	for (i = 0; i < entries; i++) {
+		if (n > 0 && entry[i].header != 0 && entry[i].header == entry[n-1].header) {
+			entry[n-1].count += entry[i].count;
+		} else {
+			entry[n++] = entry[i];
+		}
+	}
+	entries = n;
+	qsort(entry, entries, sizeof(PROFILE_Entry_t), compare_count);
+
+	strcpy(line, "  count     %  where\n");
+	stack = FS_type(stack, (uint8_t*)line, strlen(line));
+	for (i = 0; i < entries && i < PROFILE_TOP; i++) {
+		format_entry(&entry[i], total, dictionary, line, sizeof(line));
+		stack = FS_type(stack, (uint8_t*)line, strlen(line));
+	}
+
+	vPortFree(entry);
+	return stack;
+}
+
+
+// Private Functions
+// *****************
+
+/**
+ *  @brief
+ *      Formats a profile line: count, percent and the word name or the C
+ *      address with the ISR number and the caller.
+ *  @return
+ *      length of the line
+ */
+static int format_entry(const PROFILE_Entry_t *entry, uint32_t total, uint32_t dictionary,
+		char *line, size_t size) {
+	uint32_t permille = (uint64_t) entry->count * 1000 / total;
+	uint8_t *name;
+	uint32_t caller;
+	int len;
+
+	len = snprintf(line, size, "%7lu %3lu.%lu  ",
+			entry->count, permille / 10, permille % 10);
+
+	if (entry->header != 0) {
+		// Forth word
+		name = (uint8_t *) (entry->header + DICT_NAME_OFFSET);
+		len += snprintf(line + len, size - len, "%.*s\n", name[0], name + 1);
+		return len;
+	}
+
+	len += snprintf(line + len, size - len, "%08lx", entry->pc);
+	if (entry->ipsr != 0) {
+		len += snprintf(line + len, size - len, " isr %lu", entry->ipsr);
+	}
+	caller = DICT_addrToHeader(entry->lr, dictionary);
+	if (caller != 0) {
+		name = (uint8_t *) (caller + DICT_NAME_OFFSET);
+		len += snprintf(line + len, size - len, " < %.*s\n", name[0], name + 1);
+	} else {
+		len += snprintf(line + len, size - len, " < %08lx\n", entry->lr);
+	}
+	return len;
+}
+
+
+/**
+ *  @brief
+ *      qsort() compare function for the entries, by word (C code last).
+ */
+static int compare_header(const void *a, const void *b) {
+	uint32_t x = ((const PROFILE_Entry_t *) a)->header - 1;
+	uint32_t y = ((const PROFILE_Entry_t *) b)->header - 1;
+
+	return (x > y) - (x < y);
+}
+
+
+/**
+ *  @brief
+ *      qsort() compare function for the entries, most samples first.
+ */
+static int compare_count(const void *a, const void *b) {
+	uint32_t x = ((const PROFILE_Entry_t *) a)->count;
+	uint32_t y = ((const PROFILE_Entry_t *) b)->count;
+
+	return (x < y) - (x > y);
+}
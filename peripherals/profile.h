@@ -0,0 +1,54 @@
+/**
+ *  @brief
+ *      Statistical sampling profiler.
+ *
+ *      The LPTIM2 ISR samples the interrupted PC and LR into a RAM histogram.
+ *  @file
+ *      profile.h
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-19
+ *  @remark
+ *      Language: C, STM32CubeIDE GCC
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ *
+ *      Mecrsip-Cube is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with Mecrsip-Cube. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef INC_PROFILE_H_
+#define INC_PROFILE_H_
+
+void PROFILE_start(uint32_t hz);
+void PROFILE_stop(void);
+void PROFILE_clear(void);
+void PROFILE_sample(uint32_t *frame);
+uint64_t PROFILE_print(uint64_t forth_stack, uint32_t dictionary);
+
+/**
+ *  @brief
+ *      Passes the exception stack frame of the interrupted code to
+ *      PROFILE_sample(). Has to be the only statement of a naked ISR.
+ */
+#define PROFILE_SAMPLE()                                \
+  __asm volatile (                                      \
+	" tst lr, #4                    \n"                 \
+	" ite eq                        \n"                 \
+	" mrseq r0, msp                 \n"                 \
+	" mrsne r0, psp                 \n"                 \
+	" b PROFILE_sample              \n"                 \
+	: : : "r0")
+
+#endif /* INC_PROFILE_H_ */
@@ -0,0 +1,239 @@
+/**
+ *  @brief
+ *      Monotonic microsecond clock and precise delays.
+ *
+ *      The clock is the DWT cycle counter (32 MHz) extended to 64 bit
+ *      microseconds. It can be read from threads and ISRs. The cycle
+ *      counter wraps after 134 s, a RTOS timer reads the clock every 10 s.
+ *
+ *      In the low power mode (tickless idle, Stop2) the core clock and the
+ *      cycle counter stop. The time slept is measured by the timer server
+ *      (RTC wakeup timer, 122 us resolution) and added to the clock. So the
+ *      clock runs on across the tickless idle, the error is below one RTC
+ *      tick per low power entry.
+ *
+ *      A delay sleeps the whole milliseconds by the RTOS tick and busy-waits
+ *      the rest.
+ *  @file
+ *      usclock.c
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-19
+ *  @remark
+ *      Language: C, STM32CubeIDE GCC
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ *
+ *      Mecrsip-Cube is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with Mecrsip-Cube. If not, see http://www.gnu.org/licenses/.
+ */
+
+// System include files
+// ********************
+#include "cmsis_os.h"
+
+// Application include files
+// *************************
+#include "app_common.h"
+#include "main.h"
+#include "usclock.h"
+
+
+#define USCLOCK_REFRESH		10000		// ms, read the clock before the cycle counter wraps
+#define USCLOCK_SPIN		2000		// us, shorter waits are busy waiting only
+
+
+// Private function prototypes
+// ***************************
+static void update(void);
+static void refresh(void *argument);
+
+// Global Variables
+// ****************
+
+// Hardware resources
+// ******************
+
+// RTOS resources
+// **************
+static osTimerId_t USCLOCK_TimerID;
+
+
+// Private Variables
+// *****************
+static uint64_t clock_us;			// microseconds up to last_cycles
+static uint32_t last_cycles;		// DWT->CYCCNT at the last update
+static uint32_t remainder_cycles;	// cycles not yet counted as microsecond
+static uint32_t cycles_per_us;
+
+
+// Public Functions
+// ****************
+
+/**
+ *  @brief
+ *      Initializes the microsecond clock.
+ *  @return
+ *      None
+ */
+void USCLOCK_init(void) {
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	cycles_per_us = SystemCoreClock / 1000000;
+	last_cycles = DWT->CYCCNT;
+
+	USCLOCK_TimerID = osTimerNew(refresh, osTimerPeriodic, NULL, NULL);
+	if (USCLOCK_TimerID == NULL) {
+		Error_Handler();
+	}
+	osTimerStart(USCLOCK_TimerID, USCLOCK_REFRESH);
+}
+
+
+/**
+ *  @brief
+ *      Gets the microseconds since the start.
+ *
+ *      Can be called from an ISR.
+ *  @return
+ *      Monotonic clock in us
+ */
+uint64_t USCLOCK_get(void) {
+	uint64_t us;
+
+	BACKUP_PRIMASK();
+	DISABLE_IRQ();
+	update();
+	us = clock_us;
+	RESTORE_PRIMASK();
+
+	return us;
+}
+
+
+/**
+ *  @brief
+ *      Waits some microseconds.
+ *  @param[in]
+ *      us  delay in us
+ *  @return
+ *      None
+ */
+void USCLOCK_delay(uint32_t us) {
+	USCLOCK_waitUntil(USCLOCK_get() + us);
+}
+
+
+/**
+ *  @brief
+ *      Waits till the clock reaches the deadline.
+ *
+ *      Sleeps by the RTOS tick till about 1 ms before the deadline, then
+ *      busy-waits. In an ISR or before the RTOS runs it only busy-waits.
+ *  @param[in]
+ *      deadline  absolute time in us (see USCLOCK_get())
+ *  @return
+ *      None
+ */
+void USCLOCK_waitUntil(uint64_t deadline) {
+	uint64_t now = USCLOCK_get();
+	uint32_t ticks;
+
+	if (now >= deadline) {
+		return;
+	}
+	if (deadline - now > USCLOCK_SPIN
+			&& __get_IPSR() == 0 && osKernelGetState() == osKernelRunning) {
+		// osDelay(n) can wake up to one tick early
+		ticks = (deadline - now) / (1000000 / osKernelGetTickFreq()) - 1;
+		osDelay(ticks);
+	}
+	while (USCLOCK_get() < deadline) {
+		// busy wait
+	}
+}
+
+
+/**
+ *  @brief
+ *      Notes the cycle counter before entering the low power mode.
+ *
+ *      Called from vPortSuppressTicksAndSleep() with interrupts disabled.
+ *  @return
+ *      None
+ */
+void USCLOCK_enterSleep(void) {
+	update();
+}
+
+
+/**
+ *  @brief
+ *      Adds the time the cycle counter stood still in the low power mode.
+ *
+ *      Called from vPortSuppressTicksAndSleep() with interrupts disabled.
+ *      Differences below one RTC tick are the resolution of the timer
+ *      server, then the cycle counter is more precise.
+ *  @param[in]
+ *      sleep_ps  time slept measured by the timer server in ps, 0 unknown
+ *  @return
+ *      None
+ */
+void USCLOCK_exitSleep(uint64_t sleep_ps) {
+	uint64_t slept = (sleep_ps / 1000) * cycles_per_us / 1000;
+	uint32_t counted = DWT->CYCCNT - last_cycles;
+
+	if (slept > counted + CFG_TS_TICK_VAL * cycles_per_us) {
+		clock_us += (slept - counted) / cycles_per_us;
+	}
+	update();
+}
+
+
+// Private Functions
+// *****************
+
+/**
+ *  @brief
+ *      Counts the cycles since the last update.
+ *
+ *      Has to be called with interrupts disabled, at least every 134 s.
+ *  @return
+ *      None
+ */
+static void update(void) {
+	uint32_t now = DWT->CYCCNT;
+	uint32_t cycles = now - last_cycles + remainder_cycles;
+
+	last_cycles = now;
+	clock_us += cycles / cycles_per_us;
+	remainder_cycles = cycles % cycles_per_us;
+}
+
+
+// Callbacks
+// *********
+
+/**
+ *  @brief
+ *      RTOS timer callback, keeps the clock ahead of the cycle counter wrap.
+ *  @param[in]
+ *      argument  not used
+ *  @return
+ *      None
+ */
+static void refresh(void *argument) {
+	(void) USCLOCK_get();
+}
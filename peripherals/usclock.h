@@ -0,0 +1,40 @@
+/**
+ *  @brief
+ *      Monotonic microsecond clock and precise delays.
+ *
+ *  @file
+ *      usclock.h
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-19
+ *  @remark
+ *      Language: C, STM32CubeIDE GCC
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ *
+ *      Mecrsip-Cube is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with Mecrsip-Cube. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef INC_USCLOCK_H_
+#define INC_USCLOCK_H_
+
+void USCLOCK_init(void);
+uint64_t USCLOCK_get(void);
+void USCLOCK_delay(uint32_t us);
+void USCLOCK_waitUntil(uint64_t deadline);
+void USCLOCK_enterSleep(void);
+void USCLOCK_exitSleep(uint64_t sleep_ps);
+
+#endif /* INC_USCLOCK_H_ */
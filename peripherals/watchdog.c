@@ -1,18 +1,22 @@
 /**
  *  @brief
- *      Window watchdog.
+ *      Task health supervisor with the independent watchdog (IWDG).
  *
- *		There is a thread only for kicking (regularly feed) the watchdog.
- *		This thread has the second lowest priority (just higher than the
- *		idle thread), if any task does not want to give up control, the
- *		watchdog thread does not get any more CPU time and cannot feed
- *		the watchdog and the watchdog will bite after the timeout.
+ *		Tasks register with a timeout and check in regularly. The
+ *		WATCHDOG thread wakes up every WATCHDOG_PERIOD and feeds the
+ *		watchdog only if every registered task has checked in within its
+ *		timeout. The idle task is always registered (idle hook), if a
+ *		task does not want to give up control, the idle task does not
+ *		get any CPU time and cannot check in.
  *
- *		(+) WWDG clock (Hz) = PCLK1 / (4096 * Prescaler)
- *   	clock = 32'000'000 / (4096 * 64) = 122 Hz
- *   	(+) WWDG timeout (mS) = 1000 * (T[5;0] + 1) / WWDG clock (Hz)
- *   	timeout = 1000 * 64 / 122 = 524 ms
- *   	window  = 400 ms = 48
+ *		A stalled task is recorded (crash dump, RTC registers) and the
+ *		watchdog is not fed anymore, it bites after WATCHDOG_TIMEOUT. The
+ *		long period lets the tickless idle sleep between the check-ins.
+ *
+ *		(+) IWDG clock (Hz) = LSI / Prescaler
+ *   	clock = 32'000 / 256 = 125 Hz
+ *   	(+) IWDG timeout (ms) = 1000 * Reload / IWDG clock (Hz)
+ *   	timeout = 1000 * 1000 / 125 = 8000 ms
  *
  *   	RTC registers are used for accounting the watchdog bites.
  *
@@ -44,42 +48,81 @@
 // System include files
 // ********************
 #include "cmsis_os.h"
+#include "FreeRTOS.h"
+#include "task.h"
 #include <stdio.h>
+#include <string.h>
 
 // Application include files
 // *************************
 #include "app_common.h"
 #include "main.h"
-#include "wwdg.h"
 #include "clock.h"
+#include "fs.h"
 #include "watchdog.h"
+#include "myassert.h"
+#include "crash.h"
+
+#define WATCHDOG_TIMEOUT	8000			// ms
+#define WATCHDOG_PERIOD		4000			// ms, supervisor wakeup
+#define WATCHDOG_PRESCALER	6				// LSI / 256
+#define WATCHDOG_RELOAD		1000			// 8000 ms @ 125 Hz
+#define WATCHDOG_IDLE		0				// idle task client id
+#define WATCHDOG_IDLE_TIMEOUT	(2 * WATCHDOG_PERIOD)	// tickless idle and supervisor jitter
+
+#define IWDG_KEY_RELOAD		0xAAAA
+#define IWDG_KEY_ENABLE		0xCCCC
+#define IWDG_KEY_ACCESS		0x5555
+
+/** Registered task */
+typedef struct {
+	char			name[WATCHDOG_NAME_LENGTH];
+	osThreadId_t	thread;
+	/** max. time between check-ins in ms, 0 for an unused entry */
+	uint32_t		timeout;
+	/** tick of the last check-in */
+	volatile uint32_t	checkin;
+	int				stalled;
+} WATCHDOG_Client_t;
 
 // Private function prototypes
 // ***************************
 static void WATCHDOG_Thread(void *argument);
+static void iwdg_start(void);
+static int supervise(void);
 
 // Global Variables
 // ****************
 
 // Hardware resources
 // ******************
-extern WWDG_HandleTypeDef hwwdg;
 
 // RTOS resources
 // **************
 
 // Definitions for WATCHDOG thread
-static osThreadId_t WATCHDOG_ThreadId;
+static osThreadId_t WATCHDOG_ThreadId = NULL;
 static const osThreadAttr_t WATCHDOG_ThreadAttr = {
-		.name = "WATCHDOG_feed",
-		.priority = (osPriority_t) osPriorityIdle + 1, // just above IDLE
+		.name = "WATCHDOG",
+		.priority = (osPriority_t) osPriorityHigh,
 		.stack_size = 128 * 6
 };
 
+static osMutexId_t WATCHDOG_MutexID;
+static const osMutexAttr_t WATCHDOG_MutexAttr = {
+		NULL,				// no name required
+		osMutexPrioInherit,	// attr_bits
+		NULL,				// memory for control block
+		0U					// size for control block
+};
+
 
 // Private Variables
 // *****************
 static int bitten = FALSE;
+static int stalled = FALSE;
+
+static WATCHDOG_Client_t client[WATCHDOG_CLIENTS];
 
 
 // Public Functions
@@ -88,29 +131,46 @@ static int bitten = FALSE;
 /**
  *  @brief
  *      Initialize the WATCHDOG.
+ *
+ *      An IWDG reset without the RTC cookie means the WATCHDOG thread
+ *      itself did not get CPU time.
  *  @return
  *      None
  */
 void WATCHDOG_init(void) {
-	if (RTC_Backup.watchdog == RTC_MAGIC_COOKIE) {
+	if (RTC_Backup.watchdog == RTC_MAGIC_COOKIE || (RCC->CSR & RCC_CSR_IWDGRSTF)) {
 		bitten = TRUE;
 		RTC_Backup.watchdog_bites += 1;
 		RTC_Backup.watchdog = 0;
 	} else {
 		bitten = FALSE;
 	}
+	// clear the reset flags
+	RCC->CSR |= RCC_CSR_RMVF;
 
+	WATCHDOG_MutexID = osMutexNew(&WATCHDOG_MutexAttr);
+	ASSERT_fatal(WATCHDOG_MutexID != NULL, ASSERT_MUTEX_CREATION, __get_PC());
+
+	strcpy(client[WATCHDOG_IDLE].name, "IDLE");
+	client[WATCHDOG_IDLE].timeout = WATCHDOG_IDLE_TIMEOUT;
 }
 
 
 /**
  *  @brief
  *      Activate the WATCHDOG.
+ *
+ *      The IWDG cannot be stopped anymore.
  *  @return
  *      None
  */
 void WATCHDOG_activate(void) {
+	if (WATCHDOG_ThreadId != NULL) {
+		// already active
+		return;
+	}
 	RTC_Backup.watchdog = 0;
+	client[WATCHDOG_IDLE].checkin = osKernelGetTickCount();
 	// creation of WATCHDOG_Thread
 	WATCHDOG_ThreadId = osThreadNew(WATCHDOG_Thread, NULL, &WATCHDOG_ThreadAttr);
 	if (WATCHDOG_ThreadId == NULL) {
@@ -119,6 +179,82 @@ void WATCHDOG_activate(void) {
 }
 
 
+/**
+ *  @brief
+ *      Registers the calling task.
+ *
+ *      The task has to check in (WATCHDOG_checkin()) at least every
+ *      timeout ms.
+ *  @param[in]
+ *      name    task name (w/ or w/o null termination)
+ *  @param[in]
+ *      len     name length
+ *  @param[in]
+ *      timeout max. time between check-ins in ms
+ *  @return
+ *      client id, -1 if there is no free entry
+ */
+int WATCHDOG_register(const char *name, int len, uint32_t timeout) {
+	int i;
+
+	if (timeout == 0) {
+		return -1;
+	}
+	if (len >= WATCHDOG_NAME_LENGTH) {
+		len = WATCHDOG_NAME_LENGTH - 1;
+	}
+	osMutexAcquire(WATCHDOG_MutexID, osWaitForever);
+	for (i = WATCHDOG_IDLE + 1; i < WATCHDOG_CLIENTS; i++) {
+		if (client[i].timeout == 0) {
+			memcpy(client[i].name, name, len);
+			client[i].name[len] = 0;
+			client[i].thread = osThreadGetId();
+			client[i].checkin = osKernelGetTickCount();
+			client[i].stalled = FALSE;
+			client[i].timeout = timeout;
+			break;
+		}
+	}
+	osMutexRelease(WATCHDOG_MutexID);
+	return (i < WATCHDOG_CLIENTS) ? i : -1;
+}
+
+
+/**
+ *  @brief
+ *      Unregisters a task.
+ *  @param[in]
+ *      id    client id
+ *  @return
+ *      None
+ */
+void WATCHDOG_unregister(int id) {
+	if (id <= WATCHDOG_IDLE || id >= WATCHDOG_CLIENTS) {
+		return;
+	}
+	osMutexAcquire(WATCHDOG_MutexID, osWaitForever);
+	client[id].timeout = 0;
+	osMutexRelease(WATCHDOG_MutexID);
+}
+
+
+/**
+ *  @brief
+ *      The task is alive.
+ *
+ *      Does not wake up the WATCHDOG thread, can be used in ISRs.
+ *  @param[in]
+ *      id    client id
+ *  @return
+ *      None
+ */
+void WATCHDOG_checkin(int id) {
+	if (id >= 0 && id < WATCHDOG_CLIENTS) {
+		client[id].checkin = osKernelGetTickCount();
+	}
+}
+
+
 /**
  *  @brief
  *      Has the WATCHDOG bitten?
@@ -148,7 +284,7 @@ int WATCHDOG_bites(void) {
  *      Get address where the watchdog bit
  *
  *  @return
- *      Address
+ *      Address (pc of the stalled task)
  *
  */
 int WATCHDOG_adr(void) {
@@ -156,6 +292,37 @@ int WATCHDOG_adr(void) {
 }
 
 
+/**
+ *  @brief
+ *      Prints the registered tasks.
+ *  @param[in]
+ *      forth_stack   TOS (lower word) and SPS (higher word)
+ *  @return
+ *      TOS (lower word) and SPS (higher word)
+ */
+uint64_t WATCHDOG_print(uint64_t forth_stack) {
+	uint64_t stack;
+	char line[64];
+	uint32_t now;
+	int i;
+
+	stack = forth_stack;
+	now = osKernelGetTickCount();
+	osMutexAcquire(WATCHDOG_MutexID, osWaitForever);
+	for (i = 0; i < WATCHDOG_CLIENTS; i++) {
+		if (client[i].timeout == 0) {
+			continue;
+		}
+		snprintf(line, sizeof(line), "%2i %-15s %6lu ms %6lu ms%s\n", i,
+				client[i].name, client[i].timeout, now - client[i].checkin,
+				client[i].stalled ? " stalled" : "");
+		stack = FS_type(stack, (uint8_t*)line, strlen(line));
+	}
+	osMutexRelease(WATCHDOG_MutexID);
+	return stack;
+}
+
+
 // Private Functions
 // *****************
 
@@ -168,13 +335,69 @@ int WATCHDOG_adr(void) {
   * 	None
   */
 static void WATCHDOG_Thread(void *argument) {
-	MX_WWDG_Init();
+	iwdg_start();
 	// Infinite loop
 	for(;;) {
-		// wait 450 ms
-		osDelay(450);
-		HAL_WWDG_Refresh(&hwwdg); // feed the watchdog
+		osDelay(WATCHDOG_PERIOD);
+		if (!stalled && supervise()) {
+			IWDG->KR = IWDG_KEY_RELOAD; // feed the watchdog
+		}
+	}
+}
+
+
+/**
+  * @brief
+  * 	Starts the IWDG.
+  * @retval
+  * 	None
+  */
+static void iwdg_start(void) {
+	IWDG->KR = IWDG_KEY_ENABLE;		// starts the LSI too
+	IWDG->KR = IWDG_KEY_ACCESS;
+	IWDG->PR = WATCHDOG_PRESCALER;
+	IWDG->RLR = WATCHDOG_RELOAD;
+	while (IWDG->SR != 0) {
+		// wait for the register update
+	}
+	IWDG->KR = IWDG_KEY_RELOAD;
+}
+
+
+/**
+  * @brief
+  * 	Have all registered tasks checked in?
+  *
+  * 	The first stalled task is recorded, the watchdog bites after the
+  * 	timeout.
+  * @retval
+  * 	TRUE if all tasks are alive
+  */
+static int supervise(void) {
+	uint32_t now;
+	int i;
+
+	osMutexAcquire(WATCHDOG_MutexID, osWaitForever);
+	now = osKernelGetTickCount();
+	for (i = 0; i < WATCHDOG_CLIENTS; i++) {
+		if (client[i].timeout == 0 || (now - client[i].checkin) <= client[i].timeout) {
+			continue;
+		}
+		client[i].stalled = TRUE;
+		if (!stalled) {
+			stalled = TRUE;
+			RTC_Backup.watchdog = RTC_MAGIC_COOKIE;
+			if (i == WATCHDOG_IDLE) {
+				// a task does not give up control, it is not blocked
+				RTC_Backup.watchdog_adr = 0;
+				CRASH_save(ASSERT_WATCHDOG, NULL);
+			} else {
+				RTC_Backup.watchdog_adr = CRASH_save(ASSERT_WATCHDOG, client[i].thread);
+			}
+		}
 	}
+	osMutexRelease(WATCHDOG_MutexID);
+	return !stalled;
 }
 
 
@@ -182,15 +405,13 @@ static void WATCHDOG_Thread(void *argument) {
 // *********
 
 /**
-  * @brief  WWDG Early Wakeup callback.
-  * @param  hwwdg  pointer to a WWDG_HandleTypeDef structure that contains
-  *                the configuration information for the specified WWDG module.
-  * @retval None
+  * @brief
+  * 	Idle hook, the idle task checks in.
+  *
+  * 	Called in every idle loop before the tickless sleep.
+  * @retval
+  * 	None
   */
-void HAL_WWDG_EarlyWakeupCallback(WWDG_HandleTypeDef *hwwdg) {
-	/* Prevent unused argument(s) compilation warning */
-	UNUSED(hwwdg);
-	RTC_Backup.watchdog = RTC_MAGIC_COOKIE;
-	Error_Handler();
+void vApplicationIdleHook(void) {
+	client[WATCHDOG_IDLE].checkin = xTaskGetTickCount();
 }
-
@@ -1,12 +1,9 @@
 /**
  *  @brief
- *      Window watchdog.
+ *      Task health supervisor with the independent watchdog (IWDG).
  *
- *		There is a thread only for kicking (regularly feed) the watchdog.
- *		This thread has the second lowest priority (just higher than the
- *		idle thread), if any task does not want to give up control, the
- *		watchdog thread does not get any more CPU time and cannot feed
- *		the watchdog and the watchdog will bite after the timeout.
+ *		Registered tasks check in, the watchdog is fed only if all of
+ *		them (and the idle task) have checked in within their timeout.
  *  @file
  *      watchdog.h
  *  @author
@@ -37,9 +34,17 @@
 #ifndef INC_WATCHDOG_H_
 #define INC_WATCHDOG_H_
 
+#define WATCHDOG_CLIENTS		16		// registered tasks incl. IDLE
+#define WATCHDOG_NAME_LENGTH	16
+
 void WATCHDOG_init(void);
 void WATCHDOG_activate(void);
+int WATCHDOG_register(const char *name, int len, uint32_t timeout);
+void WATCHDOG_unregister(int id);
+void WATCHDOG_checkin(int id);
 int WATCHDOG_bitten(void);
 int WATCHDOG_bites(void);
+int WATCHDOG_adr(void);
+uint64_t WATCHDOG_print(uint64_t forth_stack);
 
 #endif /* INC_WATCHDOG_H_ */
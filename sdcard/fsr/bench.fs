@@ -0,0 +1,154 @@
+\  @brief
+\      Micro benchmarks for core and FPU words by the DWT cycle counter
+\
+\      Each benchmark runs a word 100 times per repetition, after a warmup
+\      run 11 repetitions are measured. The loop overhead is measured with
+\      an empty word and subtracted. The result is min, median and max in
+\      CPU cycles per operation (2 decimals). Interrupts and thread switches
+\      are not disabled, the max shows the disturbances, compare the median.
+\
+\      bench-all ( -- )            runs the catalog, prints CSV
+\      bench>file ( c-addr len -- )  runs the catalog, writes CSV to the file
+\
+\      bench>file needs redirection.fs. tools/benchcmp.py compares two CSV
+\      files from different firmware builds.
+\  @file
+\      bench.fs
+\  @author
+\      Peter Schmid, peter@spyr.ch
+\  @date
+\      2026-10-19
+\  @remark
+\      Language: Mecrisp-Stellaris Forth
+\  @copyright
+\      Peter Schmid, Switzerland
+\      For details see copyright.txt
+
+CR .( bench.fs loading ... )
+
+11 constant bench-reps         \ repetitions, the median is the middle one
+100 constant bench-iter        \ operations per repetition
+
+bench-reps cells buffer: bench-samples
+0 variable bench-xt
+0 variable bench-overhead
+
+: bench-sample ( i -- addr )
+  cells bench-samples +
+;
+
+: bench-run ( -- u )  \ cycles for bench-iter executions of bench-xt
+  bench-xt @ cycles
+  bench-iter 0 do over execute loop
+  cycles swap - nip
+;
+
+: bench-sort ( -- )  \ insertion sort of the samples
+  bench-reps 1 do
+    i bench-sample @ i  ( u j )
+    begin
+      dup 0> if 2dup 1- bench-sample @ u< else false then
+    while
+      dup 1- bench-sample @ over bench-sample !  1-
+    repeat
+    bench-sample !
+  loop
+;
+
+: bench-op ( u1 -- u2 )  \ cycles per 100 operations without loop overhead
+  bench-overhead @ - 0 max
+;
+
+: bench ( xt -- u1 u2 u3 )  \ min, median and max cycles per 100 operations
+  bench-xt !
+  bench-run drop  \ warmup
+  bench-reps 0 do bench-run i bench-sample ! loop
+  bench-sort
+  0 bench-sample @ bench-op
+  bench-reps 2/ bench-sample @ bench-op
+  bench-reps 1- bench-sample @ bench-op
+;
+
+: bench-nop ( -- ) ;
+
+: bench-calibrate ( -- )  \ measures the loop overhead
+  0 bench-overhead !
+  ['] bench-nop bench drop nip bench-overhead !
+;
+
+: bench-quiet ( xt -- u1 u2 u3 )  \ bench without terminal output
+  hook-emit @ >r  ['] drop hook-emit !
+  bench
+  r> hook-emit !
+;
+
+: bench. ( u -- )  \ prints 1/100 cycles as cycles with 2 decimals
+  0 <# # # [char] . hold #s #> type
+;
+
+: bench-line ( u1 u2 u3 c-addr len -- )  \ prints a CSV line
+  type [char] , emit
+  rot bench. [char] , emit
+  swap bench. [char] , emit
+  bench. cr
+;
+
+
+\ catalog
+\ *******
+
+64 buffer: bench-src
+64 buffer: bench-dst
+12345678 variable bench-n
+7 s>f variable bench-f
+
+: b-move     bench-src bench-dst 64 move ;
+: b-fill     bench-dst 64 0 fill ;
+: b-find     s" interpret" find 2drop ;
+: b-number   s" 12345" number 2drop ;
+: b-#s       bench-n @ 0 <# #s #> 2drop ;
+: b-u>str    bench-n @ bench-dst u>str 2drop ;
+: b-um/mod   bench-n @ 3 7 um/mod 2drop ;
+: b-*/       bench-n @ 3 7 */ drop ;
+: b-interpret  s" 1 2 + drop" evaluate ;
+: b-type     s" 0123456789abcdef" type ;
+: b-f+       bench-f @ dup f+ drop ;
+: b-f*       bench-f @ dup f* drop ;
+: b-f/       bench-f @ dup f/ drop ;
+: b-fsqrt    bench-f @ fsqrt drop ;
+: b-fsin     bench-f @ fsin drop ;
+
+: bench-all ( -- )  \ runs the catalog, prints CSV
+  bench-calibrate
+  ." name,min,median,max" cr
+  ['] b-move      bench s" move 64"      bench-line
+  ['] b-fill      bench s" fill 64"      bench-line
+  ['] b-find      bench s" find"         bench-line
+  ['] b-number    bench s" number"       bench-line
+  ['] b-#s        bench s" <# #s #>"     bench-line
+  ['] b-u>str     bench s" u>str"        bench-line
+  ['] b-um/mod    bench s" um/mod"       bench-line
+  ['] b-*/        bench s" */"           bench-line
+  ['] b-interpret bench s" interpret"    bench-line
+  ['] b-type      bench-quiet s" type 16" bench-line
+  ['] b-f+        bench s" f+"           bench-line
+  ['] b-f*        bench s" f*"           bench-line
+  ['] b-f/        bench s" f/"           bench-line
+  ['] b-fsqrt     bench s" fsqrt"        bench-line
+  ['] b-fsin      bench s" fsin"         bench-line
+;
+
+
+\ CSV file
+\ ********
+
+/FIL buffer: bench-fil
+64 buffer: bench-fn
+
+: bench>file ( c-addr len -- )  \ runs the catalog, writes CSV to the file
+  dup >r bench-fn swap move  0 bench-fn r> + c!
+  bench-fil dup stdout ! bench-fn FA_WRITE FA_CREATE_ALWAYS + f_open
+  if ." can't create file" cr exit then
+  >file bench-all >term
+  >f_close drop
+;
@@ -41,14 +41,9 @@ CR .( disassembler-m3.fs loading ... )
 : name. ( Address -- ) \ If the address is Code-Start of a dictionary word, it gets named.
   1 bic \ Thumb has LSB of address set.
 
-  >r
-  dictionarystart
-  begin
-    dup   6 + dup skipstring r@ = if ."   --> " ctype else drop then
-    dictionarynext
-  until
-  drop
-  r>
+  dup addr>header ?dup \ Binary search in the dictionary index
+  if 6 + dup skipstring 2 pick = if ."   --> " ctype else drop then
+  then
 
   case \ Check for inline strings ! They are introduced by calls to ." or s" internals.
     ['] ." $1E + of ."   -->  .' " disasm-string ." '" endof \ It is ." runtime ?
@@ -2,16 +2,9 @@
 \ A profiler to count calls to all colon definitions compiled after this code.
 
 : codestart>link ( addr -- addr* )
-  >r
-  
-  dictionarystart 
-  begin
-    dup 6 + count + even r@ = if rdrop exit then
-    dictionarynext
-  until
-  drop
-    
-  r> \ Not found ? Then give back the address which we had searched for.
+  dup addr>header ?dup if nip exit then \ Binary search in the dictionary index
+
+  \ Not found ? Then give back the address which we had searched for.
   ."  Could not find header for code start address " hex. ." in dictionary." cr quit
 ;
 
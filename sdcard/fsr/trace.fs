@@ -11,37 +11,15 @@ false variable trace-state
 : tracename. ( Address -- ) \ If the address is Code-Start of a dictionary word, it gets named.
   1 bic \ Thumb has LSB of address set.
 
-  >r
-  dictionarystart
-  begin
-    dup   6 + dup skipstring r@ = if ." --> " ctype 2 spaces else drop then
-    dictionarynext
-  until
-  drop
-  rdrop 
+  dup addr>header ?dup \ Binary search in the dictionary index
+  if 6 + dup skipstring rot = if ." --> " ctype 2 spaces else drop then
+  else drop
+  then
 ;
 
-0 variable closest-found
-
 : traceinside. ( Address -- )
   1 bic \ Thumb has LSB of address set.
-  0 closest-found ! \ Address zero (vector table) is more far away than all other addresses
-
-  >r
-  dictionarystart
-  begin
-    dup r@ u< \ No need for u<= because we are scanning dictionary headers here.
-    if \ Is the address of this entry BEFORE the address which is to be found ?
-      \ Distance to current   Latest best distance
-      r@ over -               r@ closest-found @ -  <
-      if dup closest-found ! then \ Is the current entry closer to the address which is to be found ?              
-    then
-    dictionarynext
-  until
-  drop
-  rdrop
-
-  closest-found @ ?dup if 6 + ctype 2 spaces then
+  addr>name ?dup if ctype 2 spaces else drop then
 ;
 
 : does-name. ( Address -- )
@@ -82,9 +82,18 @@
 \
 \ * The search order can be changed with GET-ORDER and SET-ORDER.
 \
-\ * Dictionary searching is done by the new word FIND-IN-DICTIONARY (defined in
-\   the INSIDE-WORDLIST). It is called via HOOK-FIND by the now vectored Mecrisp
-\   word FIND .
+\ * Dictionary searching is done by the word FIND-IN-ORDER of the Mecrisp-Cube
+\   core (FIND-IN-DICTIONARY is an alias). It is called via HOOK-FIND by the now
+\   vectored Mecrisp word FIND .
+\
+\ * WORDLIST, SEARCH-WORDLIST, GET-ORDER, SET-ORDER and CONTEXT are core words,
+\   the dictionary index keeps hash chains for each wordlist (see dict.c). The
+\   wordlist tags in the dictionary are the same, wordlists compiled to flash
+\   persist, INIT registers them with INIT-WORDLISTS after a reset.
+\
+\ * SEARCH-WORDLIST ( c-addr u wid -- 0 | xt 1 | xt -1 ) has the Forth-2012
+\   stack effect. FIND-IN-WORDLIST ( c-addr u wid -- xt|0 flags ) returns the
+\   Mecrisp flags like FIND and FIND-IN-ORDER.
 \
 \ * New words are added to the FORTH-WORDLIST by default. This can be changed
 \   by setting a new compilation context with <wordlist> SET-CURRENT.
@@ -135,12 +144,7 @@
    align 0 , forth-wordlist , here constant root-wordlist
 
 
-  forth-wordlist ,
-\ Return a wordlist identifier for a new empty wordlist.
-: wordlist ( -- wid )
-\ align here 0 ,                               MM-200522
-  align here [ here @ not literal, ] ,
-;
+\ WORDLIST ( -- wid ) is a core word: align here 0 ,
 
   inside-wordlist ,
 \ Return true if lfa|wid is the wid of a wordlist.     MM-200522
@@ -153,25 +157,21 @@
   dictionarystart constant _sof_
 
 
-\ We need two buffers for the FORTH search order:
+\ The core keeps two buffers for the FORTH search order, CONTEXT returns the
+\ addr of the actual search order depending on the compile mode.
 
   inside-wordlist ,
   #6 constant #vocs 
 
-\ A buffer for the search order in compiletoflash mode.
+\ The buffer for the search order in compiletoflash mode.
   inside-wordlist ,
-  #vocs 1+ cells buffer: c2f-context
-
+  context constant c2f-context
 
-\ A buffer for the search order in compiletoram mode.
-  inside-wordlist ,
-  #vocs 1+ cells buffer: c2r-context
 
+\ The buffer for the search order in compiletoram mode.
+  compiletoram context compiletoflash
   inside-wordlist ,
-\ Return the addr of the actual search order depending on the compile mode.
-: context ( -- a-addr )
-  compiletoram? if c2r-context else c2f-context then
-;
+  constant c2r-context
 
 
   inside-wordlist ,
@@ -346,87 +346,9 @@
 \ End of Tools to display wordlists.
 
 
-  inside-wordlist ,
-\ Return true if name of word at lfa equals c-addr,u and word is smudged.
-\ Note: Based on mecrisps case insensitive non-ANS compare.
-: name? ( c-addr u lfa -- c-addr u lfa flag )
-  >r 2dup r@ lfa>nfa count compare r> swap
-  if  ( c-addr u lfa )  \ name = string c-addr,u
-      dup smudged?
-  else  \ name <> string c-addr,u
-    false
-  then
-;
-
-
-  inside-wordlist ,
-\ If the word with name c-addr,u is a member of wordlist wid, return its lfa.
-\ Otherwise return zero.
-\ Note: Based on mecrisps case insensitive non-ANS compare.
-: search-wordlist-in-ram ( c-addr u wid -- lfa|0 )
-  >r dictionarystart 
-  begin ( c-addr u lfa )
-    dup _sof_ <> 
-  while ( c-addr u lfa )
-    dup lfa>wtag tag>wid r@ =        \ wid(lfa) = wid ?
-    if
-      name?   ( c-addr u lfa flag )
-      if
-        nip nip r> drop exit
-      then
-    then
-    dictionarynext drop
-  repeat 
-  ( c-addr u lfa ) 2drop r> ( c-addr wid ) 2drop 0
-;
-
-
-  inside-wordlist ,
-\ If the word with name c-addr,u is a member of wordlist wid, return its lfa.
-\ Otherwise return zero.
-\ Note: Based on mecrisps case insensitive non-ANS compare.
-: search-wordlist-in-flash ( c-addr u wid -- lfa|0 )
-  dup 0 >r >r forth-wordlist = if _sof_ else forth-wordlist @  then
-   begin
-    dup forth-wordlist >           \ tagged word ?
-    if
-      dup lfa>wtag tag>wid r@ =    \ wid(lfa) = wid ?
-      if
-        name?
-        if
-          r> r> drop over >r >r         \ R: wid lfa.found
-          \ for debugginng only :
-          \ cr dup lfa>wtag .wtag dup .header  \ print wtag(lfa) and name(lfa)
-          \
-        then
-      then
-    else ( c-addr u lfa )
-      name?
-      if 
-        r> r> drop over >r >r           \ R: wid lfa.found
-        \ for debugginng only :
-        \ cr 9 spaces dup .header
-        \
-      then
-    then
-    dictionarynext
-  until
-  ( c-addr u lfa ) 2drop r> ( c-addr wid ) 2drop
-  r> ( lfa|0 )
-;
-
-
-  inside-wordlist , 
-\ If the word with name c-addr,u is a member of wordlist wid, return its lfa.
-\ Otherwise return zero.
+\ SEARCH-IN-WORDLIST ( c-addr u wid -- lfa|0 ) is a core word, it returns the
+\ lfa of the word with the name c-addr,u in the wordlist wid or zero.
 \ Note: Based on mecrisps case insensitive non-ANS compare.
-: search-in-wordlist ( c-addr u wid -- lfa|0 )
-  >r compiletoram?
-  if
-    2dup r@ search-wordlist-in-ram ?dup if nip nip r> drop exit then
-  then
-  r> search-wordlist-in-flash
-;
 
 
   inside-wordlist ,
@@ -451,30 +373,12 @@
 \ if found, 0 and invalid flags otherwise.
 \ Note: Based on mecrisps case insensitive non-ANS compare.
 : find-in-dictionary ( c-addr u -- xt|0 flags )
-  context search-in-order ( lfa ) lfa>xt,flags
+  find-in-order
 ;
 
 
-  inside-wordlist ,
-\ Return the number of wordlists (wids) in the search order.
-: w/o ( -- wid1 ... widn n )
-  0 context begin dup @ while swap 1+ swap cell+ repeat drop
-; 
-
-  forth-wordlist ,
-: get-order ( -- wid1 ... widn n )
-  w/o dup 0= if exit then 
-  dup >r cells context +
-  begin 1 cells - dup @ swap dup context = until drop r>
-;
-
-  forth-wordlist ,
-: set-order ( wid1 ... widn n | -1 )
-   dup #vocs > if ." order overflow" cr quit then
-   dup -1 = if drop root-wordlist forth-wordlist dup 3 then
-   dup >r 0 ?do i cells context + ! loop
-   0 r> cells context + !  \ zero terminated order
-;
+\ GET-ORDER ( -- wid1 ... widn n ) and SET-ORDER ( wid1 ... widn n | -1 ) are
+\ core words.
 
 
   forth-wordlist ,
@@ -551,8 +455,8 @@
 inside-wordlist set-current  \ MM-200419
 
 : wlst-init ( -- )
-  compiletoflash -1 set-order  compiletoram -1 set-order  \ init both orders
-  ['] find-in-dictionary hook-find !
+  forth-wordlist root-wordlist init-wordlists  \ init both orders
+  ['] find-in-order hook-find !
 ;
 
 root-wordlist set-current   \ MM-191228
@@ -561,7 +465,7 @@ root-wordlist set-current   \ MM-191228
 
 \ Finally we have to redefine INIT to set HOOK-FIND to call FIND-IN-DICTIONARY.
 : init ( -- )
-  hook-find @ ['] find-in-dictionary <
+  hook-find @ ['] find-in-order <
   if
     ." Wordlist Extension 0.8.3 for Mecrisp-Stellaris by Manfred Mahlow" cr
   then
@@ -573,7 +477,8 @@ init   \ Init the wordlist extension.
 decimal
 
 \ ------------------------------------------------------------------------------
-\ Last Revision: MM-200522 0.8.4 : wordlist changed  wid? added  .wid changed
+\ Last Revision: 2026-10-19 search order and search in the Mecrisp-Cube core
+\                MM-200522 0.8.4 : wordlist changed  wid? added  .wid changed
 \                MM-200520 smudge? changed
 \                MM-200419 0.8.3
 \                          init changed to only display (C) message on reset
@@ -0,0 +1,61 @@
+#!/usr/bin/env python3
+"""
+Compares two benchmark CSV files written by sdcard/fsr/bench.fs.
+
+The medians of the old and new firmware build are compared, a benchmark
+is a regression if the new median is more than the threshold slower.
+The exit status is 1 if there is any regression.
+
+usage: benchcmp.py [-t percent] old.csv new.csv
+
+Peter Schmid, peter@spyr.ch
+This file is part of Mecrisp-Cube, GNU General Public License v3.
+"""
+
+import argparse
+import csv
+import sys
+
+
+def read(path):
+    with open(path, newline="") as f:
+        return {row["name"]: float(row["median"]) for row in csv.DictReader(f)}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Mecrisp-Cube benchmark compare")
+    parser.add_argument("-t", "--threshold", type=float, default=5.0,
+                        help="regression threshold in percent (default 5)")
+    parser.add_argument("old")
+    parser.add_argument("new")
+    args = parser.parse_args()
+
+    try:
+        old, new = read(args.old), read(args.new)
+    except (OSError, KeyError, ValueError) as e:
+        sys.exit("benchcmp: %s" % e)
+
+    regressions = 0
+    print("%-14s %10s %10s %8s" % ("name", "old", "new", "change"))
+    for name in old:
+        if name not in new:
+            print("%-14s %10.2f %10s" % (name, old[name], "-"))
+            continue
+        if old[name] > 0:
+            change = (new[name] - old[name]) * 100.0 / old[name]
+        else:
+            change = 0.0 if new[name] == 0 else float("inf")
+        flag = ""
+        if change > args.threshold:
+            flag = "  REGRESSION"
+            regressions += 1
+        print("%-14s %10.2f %10.2f %+7.1f%%%s" % (name, old[name], new[name], change, flag))
+    for name in new:
+        if name not in old:
+            print("%-14s %10s %10.2f" % (name, "-", new[name]))
+
+    sys.exit(1 if regressions else 0)
+
+
+if __name__ == "__main__":
+    main()
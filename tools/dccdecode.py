@@ -0,0 +1,285 @@
+#!/usr/bin/env python3
+"""
+Decodes the DCC waveform of peripherals/dcc.c back into bits and packets.
+
+encode_packet() is taken from peripherals/dcc.c and compiled on the host
+(cc), the ARR buffer is played like the TIM16 update and CC1 DMA do it
+(ARR preload, lead-in period, D0/D1 from the circular BSRR buffer). The
+old half bit ISR (TIM16 update interrupt, ARR without preload) is
+modelled too. Both track signals are decoded like a DCC decoder does
+(min. 10 preamble 1 bits, start bit 0, MSB first, end bit 1, XOR
+checksum) and compared with the reference packets.
+
+A buffer dumped from the target (ARR values, decimal or $hex, e.g.
+"period 100 dump") is decoded with --buffer.
+
+usage: dccdecode.py [-v] [--cc CC] [--buffer FILE]
+
+Peter Schmid, peter@spyr.ch
+This file is part of Mecrisp-Cube, GNU General Public License v3.
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+DCC_C = os.path.join(ROOT, "peripherals", "dcc.c")
+DCC_H = os.path.join(ROOT, "peripherals", "dcc.h")
+
+PREAMBLE_MIN = 10               # a decoder needs at least 10 1 bits
+IDLE_HALVES = 40                # idle 1 bits (halves) around a packet
+
+# reference packets without the checksum (see build_packet() in dcc.c)
+REFERENCE = [
+    ("speed 3 forward 0",       [0x03, 0x3F, 0x80]),
+    ("speed 3 forward 126",     [0x03, 0x3F, 0xFE]),
+    ("speed 127 reverse 5",     [0x7F, 0x3F, 0x05]),
+    ("speed 1234 forward 64",   [0xC0 | (1234 >> 8), 1234 & 0xFF, 0x3F, 0xC0]),
+    ("F0 F2 3",                 [0x03, 0x80 | 0x10 | 0x02]),
+    ("F5..F8 3",                [0x03, 0xB0 | 0x0F]),
+    ("F13..F28 2000",           [0xC0 | (2000 >> 8), 2000 & 0xFF, 0xD7, 0x00, 0xDF, 0xFF]),
+    ("accessory 37 D R",        [0x80 | (40 >> 2), 0x80 | ((40 & 3) << 1) | 0x70 | 0x09]),
+    ("accessory 2048",          [0x80, 0x80 | (2 << 1) | 0x70]),
+    ("all zero",                [0x00, 0x00]),
+    ("max length",              list(range(0x11, 0x11 + 19))),
+]
+
+
+def checksum(data):
+    x = 0
+    for b in data:
+        x ^= b
+    return x
+
+
+def defines(path):
+    d = {}
+    with open(path) as f:
+        for line in f:
+            m = re.match(r"\s*#define\s+(\w+)\s+\(?(\d+)(?:-(\d+))?\)?", line)
+            if m:
+                d[m.group(1)] = int(m.group(2)) - int(m.group(3) or 0)
+    return d
+
+
+def c_function(src, name):
+    m = re.search(r"^static int %s\(.*?\)\s*\{" % name, src, re.M)
+    if not m:
+        sys.exit("dccdecode: %s not found in %s" % (name, DCC_C))
+    depth, i = 0, m.end() - 1
+    while True:
+        if src[i] == "{":
+            depth += 1
+        elif src[i] == "}":
+            depth -= 1
+            if depth == 0:
+                return src[m.start():i + 1]
+        i += 1
+
+
+def encode_c(packets, cc):
+    """ARR buffers of encode_packet() from dcc.c, compiled on the host."""
+    with open(DCC_C) as f:
+        src = f.read()
+    consts = dict(defines(DCC_H))
+    consts.update(defines(DCC_C))
+    prog = ["#include <stdio.h>", "#include <stdint.h>"]
+    for name in ("TIME_0BIT_HALF_PERIOD", "TIME_1BIT_HALF_PERIOD", "DCC_PREAMBLE_BITS",
+                 "DCC_MAX_PACKET_LENGTH"):
+        prog.append("#define %s %d" % (name, consts[name]))
+    prog.append(c_function(src, "encode_packet"))
+    prog.append("""
+int main(void) {
+	uint8_t data[DCC_MAX_PACKET_LENGTH];
+	uint16_t period[DCC_PREAMBLE_BITS*2 + DCC_MAX_PACKET_LENGTH*18 + 1];
+	int count, n, i, x;
+
+	while (scanf("%d", &count) == 1) {
+		for (i=0; i<count; i++) {
+			scanf("%x", &x);
+			data[i] = x;
+		}
+		n = encode_packet(period, data, count);
+		for (i=0; i<n; i++) {
+			printf("%d ", period[i]);
+		}
+		printf("\\n");
+	}
+	return 0;
+}
+""")
+    with tempfile.TemporaryDirectory() as tmp:
+        c = os.path.join(tmp, "encode.c")
+        exe = os.path.join(tmp, "encode")
+        with open(c, "w") as f:
+            f.write("\n".join(prog))
+        r = subprocess.run([cc, "-std=c99", "-Wall", "-o", exe, c],
+                           capture_output=True, text=True)
+        if r.returncode:
+            sys.exit("dccdecode: %s failed\n%s" % (cc, r.stderr))
+        stdin = "".join("%d %s\n" % (len(p), " ".join("%x" % b for b in p)) for p in packets)
+        r = subprocess.run([exe], input=stdin, capture_output=True, text=True, check=True)
+    return consts, [[int(v) for v in line.split()] for line in r.stdout.splitlines()]
+
+
+def wire_dma(buffers, one, cndtr):
+    """Track signal of the DMA generator as (phase, us) halves.
+
+    Phase 0 is the first half of a bit (D1 high, pins[0]), 1 the second.
+    The next CC1 writes pins[2 - CNDTR] for the period with the ARR loaded
+    now (idle), the first ARR from the buffer is for the period after. The
+    last ARR stays loaded (idle 1 bits) till the next packet.
+    """
+    phase = 2 - cndtr
+    arr = one
+    halves = []
+
+    def period(value):
+        nonlocal phase
+        halves.append((phase, value + 1))
+        phase ^= 1
+
+    for _ in range(IDLE_HALVES):
+        period(arr)
+    for buf in buffers:
+        # prepare_packet(): lead-in if the next period is a first half
+        lead = [one] if phase == 0 else []
+        period(arr)
+        for value in lead + buf:
+            arr = value
+            period(arr)
+        for _ in range(IDLE_HALVES):
+            period(arr)
+    return halves
+
+
+def wire_isr(packets, zero, one):
+    """Track signal of the old TIM16 update ISR (before the DMA generator).
+
+    The ISR toggles D0/D1 and sets the ARR (no preload) at the start of the
+    first half, the period is for both halves of the bit.
+    """
+    halves = []
+    arr = one
+    for data in [None] + packets:
+        stream = []
+        if data is not None:
+            for b in data + [checksum(data)]:
+                stream.append(zero)
+                stream += [one if (b >> bit) & 1 else zero for bit in range(7, -1, -1)]
+        stream += [one] * (IDLE_HALVES // 2)
+        for arr in stream:
+            halves.append((0, arr + 1))
+            halves.append((1, arr + 1))
+    return halves
+
+
+def bits(halves, zero, one):
+    """Bits from the halves, both halves of a bit have the same period."""
+    t0, t1 = zero + 1, one + 1
+    result = []
+    i = 0
+    while i < len(halves) and halves[i][0] != 0:
+        i += 1
+    while i + 1 < len(halves):
+        (p0, a), (p1, b) = halves[i], halves[i + 1]
+        if p0 != 0 or p1 != 1:
+            raise ValueError("half %d: phase %d %d" % (i, p0, p1))
+        if a != b or a not in (t0, t1):
+            raise ValueError("half %d: %d us / %d us is no bit" % (i, a, b))
+        result.append(1 if a == t1 else 0)
+        i += 2
+    return result
+
+
+def packets(stream):
+    """DCC packets (with checksum) from the bit stream."""
+    result = []
+    ones = 0
+    i = 0
+    while i < len(stream):
+        if stream[i]:
+            ones += 1
+            i += 1
+            continue
+        if ones < PREAMBLE_MIN:
+            raise ValueError("bit %d: preamble %d bits" % (i, ones))
+        data = []
+        while True:
+            if i + 9 >= len(stream):
+                raise ValueError("bit %d: packet not terminated" % i)
+            byte = 0
+            for bit in stream[i + 1:i + 9]:
+                byte = (byte << 1) | bit
+            data.append(byte)
+            i += 9
+            if stream[i]:
+                break
+        if checksum(data):
+            raise ValueError("packet %s: checksum" % " ".join("%02X" % b for b in data))
+        result.append(data)
+        ones = 0
+    return result
+
+
+def hexs(data):
+    return " ".join("%02X" % b for b in data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Mecrisp-Cube DCC waveform decoder")
+    parser.add_argument("-v", "--verbose", action="store_true", help="print the packets")
+    parser.add_argument("--cc", default=os.environ.get("CC", "cc"), help="host C compiler")
+    parser.add_argument("--buffer", help="decode ARR values (one packet) from a file")
+    args = parser.parse_args()
+
+    consts = defines(DCC_C)
+    zero, one = consts["TIME_0BIT_HALF_PERIOD"], consts["TIME_1BIT_HALF_PERIOD"]
+
+    if args.buffer:
+        with open(args.buffer) as f:
+            buf = [int(v[1:], 16) if v.startswith("$") else int(v, 0) for v in f.read().split()]
+        try:
+            for data in packets(bits(wire_dma([buf], one, 2), zero, one)):
+                print(hexs(data))
+        except ValueError as e:
+            sys.exit("dccdecode: %s" % e)
+        return
+
+    refs = [data for _, data in REFERENCE]
+    consts, buffers = encode_c([d + [checksum(d)] for d in refs], args.cc)
+    errors = 0
+    try:
+        old = packets(bits(wire_isr(refs, zero, one), zero, one))
+        new = {cndtr: packets(bits(wire_dma(buffers, one, cndtr), zero, one))
+               for cndtr in (1, 2)}
+    except ValueError as e:
+        sys.exit("dccdecode: %s" % e)
+
+    for i, (name, data) in enumerate(REFERENCE):
+        ref = data + [checksum(data)]
+        got = [old[i] if i < len(old) else None] + [new[c][i] if i < len(new[c]) else None
+                                                    for c in (1, 2)]
+        ok = all(g == ref for g in got)
+        if not ok:
+            errors += 1
+        if args.verbose or not ok:
+            print("%-22s %-40s %s" % (name, hexs(ref), "ok" if ok else "MISMATCH"))
+            if not ok:
+                for label, g in zip(("isr", "dma", "dma lead-in"), got):
+                    print("  %-12s %s" % (label, hexs(g) if g else "-"))
+    if len(old) != len(refs) or any(len(new[c]) != len(refs) for c in (1, 2)):
+        print("packet count isr %d dma %d/%d, expected %d"
+              % (len(old), len(new[1]), len(new[2]), len(refs)))
+        errors += 1
+
+    print("%d packets, %d errors" % (len(refs), errors))
+    sys.exit(1 if errors else 0)
+
+
+if __name__ == "__main__":
+    main()
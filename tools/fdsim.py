@@ -0,0 +1,400 @@
+#!/usr/bin/env python3
+"""
+Runs the built-in flash drive (peripherals/fd.c) and the file system layer
+(FatFs, FATFS/Target/user_diskio.c, peripherals/fs.c) on the host.
+
+The sources are compiled (cc) unchanged with the stubs in tools/fdstub:
+the flash drive region and the SRAM2b scratch pages are mapped at the
+target addresses, FLASH_programDouble() and FLASH_erasePage() act on a
+file-backed image (e.g. sdcard/boot/fd-384k.img) or an erased image.
+A double word can only be programmed if it is erased. The SD drive (1:)
+is a RAM image. The tool counts the page erases, programmed double words
+and SD blocks, estimates the time the STM32WB55 needs (datasheet typical
+values, SD over SPI at 8 MHz) and verifies the result.
+
+Block workloads (FD_ReadBlocks/FD_WriteBlocks, every written block is read
+back and the whole drive is compared with the expected content):
+  dd FILE            copy a file to the drive, 8 blocks at a time like dd
+  seq KIB [BLOCKS]   sequential writes, BLOCKS per write (default 8)
+  random N [SEED]    N single block writes to random addresses
+  read KIB [BLOCKS]  sequential reads
+  trace FILE         replay a block trace, lines "R|W block count"
+
+File system workloads (the words in fs.c, FILE is put on the drives first,
+the counters start after that):
+  fs-cp FILE         cp 1:/FILE 0:/FILE, the copy is compared
+  fs-dd FILE         dd 1:/FILE 0:, the drive is compared with FILE
+  fs-include FILE    include 0:/FILE, the lines are counted
+
+The Forth interpreter, vi and the UART are not hosted: include passes the
+lines to a stub that counts them (no compilation into flash), FS_type
+goes to stdout with --echo. The FatFs CPU time is not estimated.
+
+usage: fdsim.py [-i drive.img] [-o result.img] [--csv] [--echo] [--cc CC] workload args ...
+
+Peter Schmid, peter@spyr.ch
+This file is part of Mecrisp-Cube, GNU General Public License v3.
+"""
+
+import argparse
+import ctypes
+import os
+import random
+import subprocess
+import sys
+import tempfile
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+STUB = os.path.join(ROOT, "tools", "fdstub")
+FATFS = os.path.join(ROOT, "Middlewares", "Third_Party", "FatFs", "src")
+# copied, otherwise "myassert.h", "bsp.h" and "main.h" are taken from the
+# source directory instead of the stubs
+SOURCES = [os.path.join(ROOT, "peripherals", "fd.c"),
+           os.path.join(ROOT, "peripherals", "fs.c"),
+           os.path.join(ROOT, "peripherals", "dircache.c"),
+           os.path.join(ROOT, "FATFS", "Target", "user_diskio.c"),
+           os.path.join(ROOT, "FATFS", "App", "app_fatfs.c")]
+LIBRARY = [os.path.join(FATFS, "ff.c"),
+           os.path.join(FATFS, "diskio.c"),
+           os.path.join(FATFS, "ff_gen_drv.c"),
+           os.path.join(FATFS, "option", "syscall.c"),
+           os.path.join(FATFS, "option", "ccsbcs.c"),
+           os.path.join(STUB, "fdstub.c"),
+           os.path.join(STUB, "fsstub.c")]
+
+FD_BLOCK_SIZE = 0x200           # 512 bytes in a block
+FD_PAGE_SIZE = 0x1000           # 4 KiB page for the STM32WB
+FD_BLOCKS_PER_PAGE = FD_PAGE_SIZE // FD_BLOCK_SIZE
+FD_SIZE = 0x080C0000 - 0x08060000
+
+# STM32WB55 datasheet, typical values (flash timing does not depend on the
+# 32 MHz SYSCLK), memcpy about 1 byte per cycle at 32 MHz
+T_ERASE_US = 22000.0            # page erase
+T_PROGRAM_US = 81.7             # double word program
+T_READ_US = 0.03                # per byte memcpy from flash
+T_SD_READ_US = 600.0            # SD block, 512 bytes SPI 8 MHz and command
+T_SD_WRITE_US = 1000.0          # SD block, with the card busy time
+
+SD_BLOCKS = 16384               # 8 MiB SD drive image
+FA_READ = 0x01
+FA_WRITE = 0x02
+FA_CREATE_ALWAYS = 0x08
+
+
+def build(cc):
+    """Compiles fd.c, FatFs, fs.c and the stubs to a shared library and loads it."""
+    tmp = tempfile.mkdtemp(prefix="fdsim")
+    lib = os.path.join(tmp, "libfd.so")
+    sources = []
+    for name in SOURCES:
+        src = os.path.join(tmp, os.path.basename(name))
+        with open(name, "rb") as f, open(src, "wb") as g:
+            g.write(f.read())
+        sources.append(src)
+    # uint32_t is unsigned long on the target (-Wno-format), newlib declares
+    # sprintf and atoi through the HAL headers (-include)
+    r = subprocess.run([cc, "-std=gnu99", "-O2", "-Wall", "-Wno-pointer-to-int-cast",
+                        "-Wno-int-to-pointer-cast", "-Wno-format", "-Wno-stringop-truncation",
+                        "-include", "stdio.h", "-include", "stdlib.h", "-shared", "-fPIC",
+                        "-I", STUB, "-I", os.path.join(ROOT, "peripherals"),
+                        "-I", os.path.join(ROOT, "FATFS", "Target"),
+                        "-I", os.path.join(ROOT, "FATFS", "App"), "-I", FATFS,
+                        "-Wl,--wrap=FD_ReadBlocks", "-Wl,--wrap=FD_WriteBlocks",
+                        "-o", lib] + sources + LIBRARY,
+                       capture_output=True, text=True)
+    if r.returncode:
+        sys.exit("fdsim: %s failed\n%s" % (cc, r.stderr))
+    fd = ctypes.CDLL(lib)
+    for src in sources:
+        os.remove(src)
+    os.remove(lib)
+    os.rmdir(tmp)
+    fd.FD_ReadBlocks.restype = ctypes.c_uint8
+    fd.FD_ReadBlocks.argtypes = [ctypes.c_char_p, ctypes.c_uint32, ctypes.c_uint32]
+    fd.FD_WriteBlocks.restype = ctypes.c_uint8
+    fd.FD_WriteBlocks.argtypes = [ctypes.c_char_p, ctypes.c_uint32, ctypes.c_uint32]
+    fd.fdstub_init.argtypes = [ctypes.c_char_p, ctypes.c_uint32]
+    fd.fdstub_flash.restype = ctypes.POINTER(ctypes.c_uint8)
+    fd.fsstub_line.argtypes = [ctypes.c_char_p]
+    for word in ("FS_cp", "FS_dd", "FS_mkfs"):
+        getattr(fd, word).restype = ctypes.c_uint64
+        getattr(fd, word).argtypes = [ctypes.c_uint64]
+    fd.FS_include.restype = ctypes.c_uint64
+    fd.FS_include.argtypes = [ctypes.c_uint64, ctypes.c_char_p, ctypes.c_int]
+    fd.f_open.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_uint8]
+    fd.f_read.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_uint,
+                          ctypes.POINTER(ctypes.c_uint)]
+    fd.f_write.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_uint,
+                           ctypes.POINTER(ctypes.c_uint)]
+    fd.f_close.argtypes = [ctypes.c_void_p]
+    return fd
+
+
+class FlashDrive:
+    def __init__(self, lib, image=None):
+        self.lib = lib
+        if lib.fdstub_init(image, len(image) if image else 0):
+            raise OSError("flash drive address range not available")
+        self.expected = bytearray(b"\xff" * FD_SIZE)
+        if image:
+            self.expected[:len(image)] = image[:FD_SIZE]
+        self.read_bytes = 0
+        self.reads = 0
+        self.writes = 0
+        self.errors = 0
+        self.mounted = False
+
+    def counter(self, name):
+        return ctypes.c_uint32.in_dll(self.lib, name).value
+
+    def clear(self, name):
+        ctypes.c_uint32.in_dll(self.lib, name).value = 0
+
+    @property
+    def erases(self):
+        return self.counter("fdstub_erases")
+
+    @property
+    def programs(self):
+        return self.counter("fdstub_programs")
+
+    @property
+    def wear(self):
+        return list((ctypes.c_uint32 * (FD_SIZE // FD_PAGE_SIZE)).in_dll(self.lib, "fdstub_wear"))
+
+    @property
+    def flash(self):
+        return ctypes.string_at(self.lib.fdstub_flash(), FD_SIZE)
+
+    def time_ms(self):
+        # every erase saves the page to the scratch page first, FatFs and
+        # fs.c read FD_BLOCK_SIZE blocks
+        read_bytes = (self.read_bytes + self.erases * FD_PAGE_SIZE
+                      + self.counter("fsstub_fd_reads") * FD_BLOCK_SIZE)
+        return (self.erases * T_ERASE_US + self.programs * T_PROGRAM_US
+                + read_bytes * T_READ_US + self.counter("fsstub_sd_reads") * T_SD_READ_US
+                + self.counter("fsstub_sd_writes") * T_SD_WRITE_US) / 1000.0
+
+    def mount(self, mkfs):
+        """Links the drivers (MX_FATFS_Init), FS_init, mkfs 1: and 0:."""
+        if self.lib.fsstub_init(SD_BLOCKS) or self.lib.MX_FATFS_Init():
+            raise OSError("can't link the FatFs drivers")
+        self.lib.FS_init()
+        self.word("FS_mkfs", "1:")
+        if mkfs:
+            self.word("FS_mkfs", "0:")
+        self.mounted = True
+
+    def word(self, name, line):
+        """Calls a word in fs.c, line is the rest of the command line."""
+        self.lib.fsstub_line(line.encode())
+        getattr(self.lib, name)(0)
+
+    def put(self, path, data):
+        fil = ctypes.create_string_buffer(self.lib.FS_FIL_size())
+        count = ctypes.c_uint()
+        if self.lib.f_open(fil, path.encode(), FA_CREATE_ALWAYS | FA_WRITE):
+            raise OSError("%s: can't create file" % path)
+        fr = self.lib.f_write(fil, data, len(data), ctypes.byref(count))
+        self.lib.f_close(fil)
+        if fr or count.value != len(data):
+            raise OSError("%s: write error" % path)
+
+    def get(self, path):
+        fil = ctypes.create_string_buffer(self.lib.FS_FIL_size())
+        buf = ctypes.create_string_buffer(FD_PAGE_SIZE)
+        count = ctypes.c_uint()
+        data = b""
+        if self.lib.f_open(fil, path.encode(), FA_READ):
+            return None
+        while not self.lib.f_read(fil, buf, len(buf), ctypes.byref(count)) and count.value:
+            data += buf.raw[:count.value]
+        self.lib.f_close(fil)
+        return data
+
+    def start(self):
+        """The workload starts here, staging is not counted."""
+        for name in ("fdstub_erases", "fdstub_programs", "fsstub_fd_reads",
+                     "fsstub_fd_writes", "fsstub_sd_reads", "fsstub_sd_writes",
+                     "fsstub_lines", "fsstub_bytes"):
+            self.clear(name)
+        ctypes.memset(ctypes.addressof(ctypes.c_uint32.in_dll(self.lib, "fdstub_wear")),
+                      0, 4 * (FD_SIZE // FD_PAGE_SIZE))
+
+    def read_blocks(self, addr, count):
+        buf = ctypes.create_string_buffer(count * FD_BLOCK_SIZE)
+        if self.lib.FD_ReadBlocks(buf, addr, count):
+            raise ValueError("read beyond the drive: block %d" % addr)
+        self.reads += 1
+        self.read_bytes += count * FD_BLOCK_SIZE
+        return buf.raw
+
+    def write_blocks(self, data, addr, count):
+        if self.lib.FD_WriteBlocks(data, addr, count):
+            raise ValueError("write failed: block %d count %d" % (addr, count))
+        self.writes += 1
+        start = addr * FD_BLOCK_SIZE
+        self.expected[start:start + count * FD_BLOCK_SIZE] = data
+        buf = ctypes.create_string_buffer(count * FD_BLOCK_SIZE)
+        self.lib.FD_ReadBlocks(buf, addr, count)
+        if buf.raw != data:
+            self.errors += 1
+
+    def verify(self):
+        flash = self.flash
+        for block in range(FD_SIZE // FD_BLOCK_SIZE):
+            start = block * FD_BLOCK_SIZE
+            if flash[start:start + FD_BLOCK_SIZE] != self.expected[start:start + FD_BLOCK_SIZE]:
+                self.errors += 1
+        self.errors += self.counter("fdstub_errors")
+        return self.errors
+
+
+def pattern(blocks, seed):
+    rnd = random.Random(seed)
+    return bytes(rnd.getrandbits(8) for _ in range(blocks * FD_BLOCK_SIZE))
+
+
+def include_lines(text):
+    """Lines FS_include passes to evaluate, a backslash continues a line."""
+    lines = 0
+    continued = False
+    for line in text.split(b"\n")[:-1]:
+        if not continued:
+            lines += 1
+        continued = line.endswith(b"\\")
+    return lines
+
+
+def fs_workload(fd, args, image):
+    name = args[0]
+    with open(args[1], "rb") as f:
+        data = f.read()
+    base = os.path.basename(args[1])
+    fd.mount(image is None)
+    if name == "fs-cp":
+        fd.put("1:/" + base, data)
+        fd.start()
+        fd.word("FS_cp", "1:/%s 0:/%s" % (base, base))
+        if fd.get("0:/" + base) != data:
+            fd.errors += 1
+    elif name == "fs-dd":
+        fd.put("1:/" + base, data)
+        fd.start()
+        fd.word("FS_dd", "1:/%s 0:" % base)
+        # dd copies whole 4 KiB chunks
+        size = min(len(data) // FD_PAGE_SIZE * FD_PAGE_SIZE, FD_SIZE)
+        fd.expected = bytearray(fd.flash)
+        if fd.expected[:size] != data[:size]:
+            fd.errors += 1
+        return
+    elif name == "fs-include":
+        fd.put("0:/" + base, data)
+        fd.start()
+        path = ("0:/" + base).encode()
+        fd.lib.FS_include(0, path, len(path))
+        if fd.counter("fsstub_lines") != include_lines(data):
+            fd.errors += 1
+    else:
+        raise ValueError("unknown workload " + name)
+    # no expected block content, the file is compared
+    fd.expected = bytearray(fd.flash)
+
+
+def workload(fd, args, image=None):
+    name = args[0]
+    if name.startswith("fs-"):
+        fs_workload(fd, args, image)
+    elif name == "dd":
+        with open(args[1], "rb") as f:
+            image = f.read()
+        for block in range(0, min(len(image), FD_SIZE) // FD_BLOCK_SIZE - 7, 8):
+            fd.write_blocks(image[block * FD_BLOCK_SIZE:(block + 8) * FD_BLOCK_SIZE], block, 8)
+    elif name == "seq":
+        blocks = int(args[1]) * 2
+        chunk = int(args[2]) if len(args) > 2 else 8
+        data = pattern(chunk, 1)
+        for block in range(0, blocks - chunk + 1, chunk):
+            fd.write_blocks(data, block, chunk)
+    elif name == "random":
+        rnd = random.Random(int(args[2]) if len(args) > 2 else 0)
+        data = pattern(1, 2)
+        for _ in range(int(args[1])):
+            fd.write_blocks(data, rnd.randrange(FD_SIZE // FD_BLOCK_SIZE), 1)
+    elif name == "read":
+        blocks = int(args[1]) * 2
+        chunk = int(args[2]) if len(args) > 2 else 8
+        for block in range(0, blocks - chunk + 1, chunk):
+            fd.read_blocks(block, chunk)
+    elif name == "trace":
+        with open(args[1]) as f:
+            for line in f:
+                fields = line.split()
+                if len(fields) < 3 or fields[0].startswith("#"):
+                    continue
+                addr, count = int(fields[1], 0), int(fields[2], 0)
+                if fields[0].upper() == "R":
+                    fd.read_blocks(addr, count)
+                else:
+                    fd.write_blocks(pattern(count, addr), addr, count)
+    else:
+        raise ValueError("unknown workload " + name)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Mecrisp-Cube flash drive model")
+    parser.add_argument("-i", "--image", help="initial drive image (default erased)")
+    parser.add_argument("-o", "--output", help="write the resulting drive image")
+    parser.add_argument("--csv", action="store_true", help="one CSV line as result")
+    parser.add_argument("--echo", action="store_true", help="FS_type output to stdout")
+    parser.add_argument("--cc", default=os.environ.get("CC", "cc"), help="host C compiler")
+    parser.add_argument("workload", nargs=argparse.REMAINDER)
+    args = parser.parse_args()
+
+    if not args.workload:
+        parser.error("workload missing")
+
+    image = None
+    if args.image:
+        with open(args.image, "rb") as f:
+            image = f.read()
+    try:
+        fd = FlashDrive(build(args.cc), image)
+        ctypes.c_int.in_dll(fd.lib, "fsstub_echo").value = args.echo
+        workload(fd, args.workload, image)
+    except (ValueError, IndexError, OSError) as e:
+        sys.exit("fdsim: %s" % e)
+    errors = fd.verify()
+
+    if args.output:
+        with open(args.output, "wb") as f:
+            f.write(fd.flash)
+
+    # FatFs and fs.c count blocks, not calls
+    reads = fd.reads + fd.counter("fsstub_fd_reads")
+    writes = fd.writes + fd.counter("fsstub_fd_writes")
+    read_bytes = (fd.read_bytes + fd.erases * FD_PAGE_SIZE
+                  + fd.counter("fsstub_fd_reads") * FD_BLOCK_SIZE)
+    if args.csv:
+        print("%s,%d,%d,%d,%d,%d,%.1f,%d,%d,%d" % (" ".join(args.workload), reads, writes,
+              fd.erases, fd.programs, max(fd.wear), fd.time_ms(), errors,
+              fd.counter("fsstub_sd_reads"), fd.counter("fsstub_sd_writes")))
+    else:
+        print("workload       %s" % " ".join(args.workload))
+        print("block reads    %d" % reads)
+        print("flash read     %d KiB (blocks and saved pages)" % (read_bytes // 1024))
+        print("block writes   %d" % writes)
+        print("page erases    %d (max %d per page)" % (fd.erases, max(fd.wear)))
+        print("double words   %d" % fd.programs)
+        if fd.mounted:
+            print("SD blocks      %d read, %d written"
+                  % (fd.counter("fsstub_sd_reads"), fd.counter("fsstub_sd_writes")))
+            print("include lines  %d (%d bytes)"
+                  % (fd.counter("fsstub_lines"), fd.counter("fsstub_bytes")))
+        print("estimated      %.1f ms" % fd.time_ms())
+        print("verify errors  %d" % errors)
+    sys.exit(1 if errors else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,29 @@
+/**
+ *  @brief
+ *      Host stub for FreeRTOS.h, the heap is malloc().
+ *  @file
+ *      FreeRTOS.h
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-19
+ *  @remark
+ *      Language: C, host GCC (tools/fdsim.py)
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ */
+
+#ifndef FDSTUB_FREERTOS_H_
+#define FDSTUB_FREERTOS_H_
+
+#include <stddef.h>
+
+void *pvPortMalloc(size_t xSize);
+void vPortFree(void *pv);
+
+#endif /* FDSTUB_FREERTOS_H_ */
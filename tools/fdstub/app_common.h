@@ -0,0 +1,27 @@
+/**
+ *  @brief
+ *      Host stub for Core/Inc/app_common.h.
+ *  @file
+ *      app_common.h
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-19
+ *  @remark
+ *      Language: C, host GCC (tools/fdsim.py)
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ */
+
+#ifndef FDSTUB_APP_COMMON_H_
+#define FDSTUB_APP_COMMON_H_
+
+#define FALSE	0
+#define TRUE	(!FALSE)
+
+#endif /* FDSTUB_APP_COMMON_H_ */
@@ -0,0 +1,34 @@
+/**
+ *  @brief
+ *      Host stub for peripherals/bsp.h, no system LEDs.
+ *  @file
+ *      bsp.h
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-19
+ *  @remark
+ *      Language: C, host GCC (tools/fdsim.py)
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ */
+
+#ifndef FDSTUB_BSP_H_
+#define FDSTUB_BSP_H_
+
+typedef enum {
+	SYSLED_DISK_READ_OPERATION 	= 1 << 1,
+	SYSLED_DISK_WRITE_OPERATION = 1 << 2,
+	SYSLED_ERROR	      	    = 1 << 7,
+} BSP_sysled_t;
+
+void BSP_setSysLED(BSP_sysled_t status);
+void BSP_clearSysLED(BSP_sysled_t status);
+void BSP_flashSysLED(BSP_sysled_t status);
+
+#endif /* FDSTUB_BSP_H_ */
@@ -0,0 +1,50 @@
+/**
+ *  @brief
+ *      Host stub, CMSIS-RTOS2 mutex without an RTOS (single thread).
+ *      Also used by FatFs (option/syscall.c, _USE_MUTEX 1).
+ *  @file
+ *      cmsis_os.h
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-19
+ *  @remark
+ *      Language: C, host GCC (tools/fdsim.py)
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ */
+
+#ifndef FDSTUB_CMSIS_OS_H_
+#define FDSTUB_CMSIS_OS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef void *osMutexId_t;
+typedef int osStatus_t;
+
+typedef struct {
+	const char *name;
+	uint32_t attr_bits;
+	void *cb_mem;
+	uint32_t cb_size;
+} osMutexAttr_t;
+
+#define osCMSIS				0x20001U
+
+#define osOK				0
+#define osWaitForever		0xFFFFFFFFU
+#define osMutexPrioInherit	0x00000002U
+
+osMutexId_t osMutexNew(const osMutexAttr_t *attr);
+osStatus_t osMutexAcquire(osMutexId_t mutex_id, uint32_t timeout);
+osStatus_t osMutexRelease(osMutexId_t mutex_id);
+osStatus_t osMutexDelete(osMutexId_t mutex_id);
+
+#endif /* FDSTUB_CMSIS_OS_H_ */
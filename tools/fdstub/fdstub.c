@@ -0,0 +1,203 @@
+/**
+ *  @brief
+ *      Host stubs to run peripherals/fd.c with tools/fdsim.py.
+ *
+ *      The flash drive region (FD_START_ADDRESS .. FD_END_ADDRESS) and the
+ *      SRAM2b scratch pages (fd.c and fs.c) are mapped at the target
+ *      addresses, fd.c uses them unchanged. FLASH_programDouble() and FLASH_erasePage() behave
+ *      like the STM32WB flash: a double word can only be programmed if it
+ *      is erased (PROGERR), an erase sets the 4 KiB page to 0xFF. Erases,
+ *      programmed double words and the wear per page are counted.
+ *  @file
+ *      fdstub.c
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-19
+ *  @remark
+ *      Language: C, host GCC (tools/fdsim.py)
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ */
+
+// System include files
+// ********************
+#include "cmsis_os.h"
+#include <sys/mman.h>
+
+// Application include files
+// *************************
+#include "main.h"
+#include "fd.h"
+#include "flash.h"
+#include "myassert.h"
+#include "bsp.h"
+
+
+// Defines
+// *******
+#define FD_SIZE			(FD_END_ADDRESS - FD_START_ADDRESS)
+#define FD_PAGES		(FD_SIZE / FD_PAGE_SIZE)
+#define SRAM2B_SIZE		(2 * FD_PAGE_SIZE)	// fd.c scratch page, fs.c scratch
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE		MAP_FIXED
+#endif
+
+
+// Global Variables
+// ****************
+uint32_t fdstub_erases;				// page erases
+uint32_t fdstub_programs;			// programmed double words
+uint32_t fdstub_errors;				// programming errors and asserts
+uint32_t fdstub_wear[FD_PAGES];		// erases per page
+
+
+// Private Functions
+// *****************
+
+static void *map(uintptr_t address, size_t size) {
+	void *p = mmap((void *) address, size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+	if (p != (void *) address) {
+		return NULL;
+	}
+	return p;
+}
+
+
+// Public Functions
+// ****************
+
+/**
+ *  @brief
+ *      Maps the flash drive and SRAM2b, loads the image and calls FD_init().
+ *  @param[in]
+ *      image   initial drive content (NULL erased)
+ *  @param[in]
+ *      size    image size in bytes
+ *  @return
+ *      0 ok, -1 address range not available
+ */
+int fdstub_init(const uint8_t *image, uint32_t size) {
+	static uint8_t *flash = NULL;
+
+	if (flash == NULL) {
+		flash = map(FD_START_ADDRESS, FD_SIZE);
+		if (flash == NULL || map(SRAM2B_BASE, SRAM2B_SIZE) == NULL) {
+			return -1;
+		}
+	}
+	memset(flash, 0xFF, FD_SIZE);
+	if (image != NULL) {
+		memcpy(flash, image, size < FD_SIZE ? size : FD_SIZE);
+	}
+	fdstub_erases = 0;
+	fdstub_programs = 0;
+	fdstub_errors = 0;
+	memset(fdstub_wear, 0, sizeof(fdstub_wear));
+
+	FD_init();
+	FD_getSize();
+	return 0;
+}
+
+
+/**
+ *  @brief
+ *      The flash drive region (FD_START_ADDRESS).
+ */
+uint8_t *fdstub_flash(void) {
+	return (uint8_t *) FD_START_ADDRESS;
+}
+
+
+void fdstub_assert(int id, uint32_t param) {
+	(void) id;
+	(void) param;
+	fdstub_errors++;
+}
+
+
+// flash.c
+// *******
+
+int FLASH_programDouble(uint32_t Address, uint32_t word1, uint32_t word2) {
+	uint32_t *p = (uint32_t *) (uintptr_t) Address;
+
+	if (Address < FD_START_ADDRESS || Address + 8 > FD_END_ADDRESS || (Address & 7)) {
+		fdstub_errors++;
+		return HAL_ERROR;
+	}
+	if (p[0] != 0xFFFFFFFF || p[1] != 0xFFFFFFFF) {
+		// PROGERR, double word not erased
+		fdstub_errors++;
+		return HAL_ERROR;
+	}
+	p[0] = word1;
+	p[1] = word2;
+	fdstub_programs++;
+	return HAL_OK;
+}
+
+
+int FLASH_erasePage(uint32_t Address) {
+	if (Address < FD_START_ADDRESS || Address >= FD_END_ADDRESS
+			|| (Address & (FD_PAGE_SIZE - 1))) {
+		fdstub_errors++;
+		return HAL_ERROR;
+	}
+	memset((void *) (uintptr_t) Address, 0xFF, FD_PAGE_SIZE);
+	fdstub_erases++;
+	fdstub_wear[(Address - FD_START_ADDRESS) / FD_PAGE_SIZE]++;
+	return HAL_OK;
+}
+
+
+// cmsis_os2.c, bsp.c
+// ******************
+
+osMutexId_t osMutexNew(const osMutexAttr_t *attr) {
+	static int mutex;
+	(void) attr;
+	return &mutex;
+}
+
+
+osStatus_t osMutexAcquire(osMutexId_t mutex_id, uint32_t timeout) {
+	(void) mutex_id;
+	(void) timeout;
+	return osOK;
+}
+
+
+osStatus_t osMutexRelease(osMutexId_t mutex_id) {
+	(void) mutex_id;
+	return osOK;
+}
+
+
+osStatus_t osMutexDelete(osMutexId_t mutex_id) {
+	(void) mutex_id;
+	return osOK;
+}
+
+
+void BSP_setSysLED(BSP_sysled_t status) {
+	(void) status;
+}
+
+
+void BSP_clearSysLED(BSP_sysled_t status) {
+	(void) status;
+}
+
+
+void BSP_flashSysLED(BSP_sysled_t status) {
+	(void) status;
+}
@@ -0,0 +1,25 @@
+/**
+ *  @brief
+ *      Host stub for freertos_os2.h.
+ *  @file
+ *      freertos_os2.h
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-19
+ *  @remark
+ *      Language: C, host GCC (tools/fdsim.py)
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ */
+
+#ifndef FDSTUB_FREERTOS_OS2_H_
+#define FDSTUB_FREERTOS_OS2_H_
+
+
+#endif /* FDSTUB_FREERTOS_OS2_H_ */
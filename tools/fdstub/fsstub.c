@@ -0,0 +1,261 @@
+/**
+ *  @brief
+ *      Host stubs to run FatFs and peripherals/fs.c with tools/fdsim.py.
+ *
+ *      The SD drive (1:) is a RAM image, SD_ReadBlocks() and
+ *      SD_WriteBlocks() count the blocks. The FD_ReadBlocks() and
+ *      FD_WriteBlocks() calls from user_diskio.c and fs.c are wrapped
+ *      (ld --wrap) to count the blocks too, fd.c itself is not changed.
+ *
+ *      The Forth words are not hosted. FS_token() takes the tokens from a
+ *      line set by fsstub_line() (the rest of the command line after e.g.
+ *      cp), FS_evaluate() only counts the lines and bytes it gets from
+ *      include, FS_type() and FS_cr() go to stdout if fsstub_echo is set,
+ *      FS_accept() returns an empty line.
+ *  @file
+ *      fsstub.c
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-19
+ *  @remark
+ *      Language: C, host GCC (tools/fdsim.py)
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ */
+
+// System include files
+// ********************
+#include "cmsis_os.h"
+#include "FreeRTOS.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Application include files
+// *************************
+#include "main.h"
+#include "rtc.h"
+#include "sd.h"
+#include "fd.h"
+
+
+// Defines
+// *******
+#define LINE_LENGTH		256
+
+
+// Global Variables
+// ****************
+uint32_t fsstub_fd_reads;			// flash drive blocks read by FatFs and fs.c
+uint32_t fsstub_fd_writes;			// flash drive blocks written
+uint32_t fsstub_sd_reads;			// SD blocks read
+uint32_t fsstub_sd_writes;			// SD blocks written
+uint32_t fsstub_lines;				// lines evaluated (include)
+uint32_t fsstub_bytes;				// bytes evaluated
+int fsstub_echo;					// FS_type() to stdout
+
+RTC_HandleTypeDef hrtc;
+uint32_t **ZweitDictionaryPointer;	// Forth, not hosted
+
+
+// Private Variables
+// *****************
+static uint8_t *sd_image = NULL;
+static uint32_t sd_blocks = 0;
+
+static char token_line[LINE_LENGTH];
+static char *token_next = token_line;
+
+
+// Public Functions
+// ****************
+
+/**
+ *  @brief
+ *      Allocates the SD drive image (erased, no file system).
+ *  @param[in]
+ *      blocks   size in 512 byte blocks, 0 no SD card
+ *  @return
+ *      0 ok, -1 out of memory
+ */
+int fsstub_init(uint32_t blocks) {
+	free(sd_image);
+	sd_image = NULL;
+	sd_blocks = 0;
+	if (blocks) {
+		sd_image = calloc(blocks, SD_BLOCK_SIZE);
+		if (sd_image == NULL) {
+			return -1;
+		}
+		sd_blocks = blocks;
+	}
+	fsstub_fd_reads = 0;
+	fsstub_fd_writes = 0;
+	fsstub_sd_reads = 0;
+	fsstub_sd_writes = 0;
+	fsstub_lines = 0;
+	fsstub_bytes = 0;
+	return 0;
+}
+
+
+/**
+ *  @brief
+ *      Sets the rest of the command line for FS_token().
+ *  @param[in]
+ *      line   e.g. "0:/a.fs 1:/a.fs" for cp
+ */
+void fsstub_line(const char *line) {
+	strncpy(token_line, line, LINE_LENGTH-1);
+	token_line[LINE_LENGTH-1] = 0;
+	token_next = token_line;
+}
+
+
+// fs.s (Forth words used by fs.c)
+// *******************************
+
+uint64_t FS_type(uint64_t forth_stack, uint8_t *str, int count) {
+	if (fsstub_echo) {
+		fwrite(str, 1, count, stdout);
+		fflush(stdout);
+	}
+	return forth_stack;
+}
+
+
+uint64_t FS_cr(uint64_t forth_stack) {
+	return FS_type(forth_stack, (uint8_t *) "\n", 1);
+}
+
+
+uint64_t FS_token(uint64_t forth_stack, uint8_t **str, int *count) {
+	while (*token_next == ' ' || *token_next == '\t') {
+		token_next++;
+	}
+	*str = (uint8_t *) token_next;
+	while (*token_next != 0 && *token_next != ' ' && *token_next != '\t') {
+		token_next++;
+	}
+	*count = token_next - (char *) *str;
+	return forth_stack;
+}
+
+
+uint64_t FS_evaluate(uint64_t forth_stack, uint8_t *str, int count) {
+	(void) str;
+	fsstub_lines++;
+	fsstub_bytes += count;
+	return forth_stack;
+}
+
+
+uint64_t FS_catch_evaluate(uint64_t forth_stack, uint8_t *str, int count) {
+	return FS_evaluate(forth_stack, str, count);
+}
+
+
+uint64_t FS_accept(uint64_t forth_stack, uint8_t *str, int *count) {
+	// no terminal input, an empty line
+	(void) str;
+	*count = 0;
+	return forth_stack;
+}
+
+
+// fd.c, calls from user_diskio.c and fs.c (ld --wrap)
+// ***************************************************
+
+uint8_t __real_FD_ReadBlocks(uint8_t *pData, uint32_t ReadAddr, uint32_t NumOfBlocks);
+uint8_t __real_FD_WriteBlocks(uint8_t *pData, uint32_t WriteAddr, uint32_t NumOfBlocks);
+
+uint8_t __wrap_FD_ReadBlocks(uint8_t *pData, uint32_t ReadAddr, uint32_t NumOfBlocks) {
+	fsstub_fd_reads += NumOfBlocks;
+	return __real_FD_ReadBlocks(pData, ReadAddr, NumOfBlocks);
+}
+
+
+uint8_t __wrap_FD_WriteBlocks(uint8_t *pData, uint32_t WriteAddr, uint32_t NumOfBlocks) {
+	fsstub_fd_writes += NumOfBlocks;
+	return __real_FD_WriteBlocks(pData, WriteAddr, NumOfBlocks);
+}
+
+
+// sd.c
+// ****
+
+int SD_getBlocks(void) {
+	return sd_blocks / 2;
+}
+
+
+void SD_getSize(void) {
+}
+
+
+uint8_t SD_GetCardInfo(SD_CardInfo *pCardInfo) {
+	memset(pCardInfo, 0, sizeof(SD_CardInfo));
+	pCardInfo->CardCapacity = (uint64_t) sd_blocks * SD_BLOCK_SIZE;
+	pCardInfo->CardBlockSize = SD_BLOCK_SIZE;
+	pCardInfo->LogBlockNbr = sd_blocks;
+	pCardInfo->LogBlockSize = SD_BLOCK_SIZE;
+	return SD_OK;
+}
+
+
+uint8_t SD_ReadBlocks(uint8_t *pData, uint32_t ReadAddr, uint32_t NumOfBlocks) {
+	if (ReadAddr + NumOfBlocks > sd_blocks) {
+		return SD_ERROR;
+	}
+	memcpy(pData, sd_image + ReadAddr * SD_BLOCK_SIZE, NumOfBlocks * SD_BLOCK_SIZE);
+	fsstub_sd_reads += NumOfBlocks;
+	return SD_OK;
+}
+
+
+uint8_t SD_WriteBlocks(uint8_t *pData, uint32_t WriteAddr, uint32_t NumOfBlocks) {
+	if (WriteAddr + NumOfBlocks > sd_blocks) {
+		return SD_ERROR;
+	}
+	memcpy(sd_image + WriteAddr * SD_BLOCK_SIZE, pData, NumOfBlocks * SD_BLOCK_SIZE);
+	fsstub_sd_writes += NumOfBlocks;
+	return SD_OK;
+}
+
+
+// FreeRTOS heap, RTC
+// ******************
+
+void *pvPortMalloc(size_t xSize) {
+	return malloc(xSize);
+}
+
+
+void vPortFree(void *pv) {
+	free(pv);
+}
+
+
+int HAL_RTC_GetTime(RTC_HandleTypeDef *hrtc, RTC_TimeTypeDef *sTime, uint32_t Format) {
+	(void) hrtc;
+	(void) Format;
+	memset(sTime, 0, sizeof(RTC_TimeTypeDef));
+	sTime->Hours = 12;
+	return HAL_OK;
+}
+
+
+int HAL_RTC_GetDate(RTC_HandleTypeDef *hrtc, RTC_DateTypeDef *sDate, uint32_t Format) {
+	(void) hrtc;
+	(void) Format;
+	sDate->WeekDay = 1;
+	sDate->Month = 10;
+	sDate->Date = 19;
+	sDate->Year = 26;
+	return HAL_OK;
+}
@@ -0,0 +1,33 @@
+/**
+ *  @brief
+ *      Host stub for Core/Inc/main.h, HAL status, SRAM2b and the drives.
+ *  @file
+ *      main.h
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-19
+ *  @remark
+ *      Language: C, host GCC (tools/fdsim.py)
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ */
+
+#ifndef FDSTUB_MAIN_H_
+#define FDSTUB_MAIN_H_
+
+#define __IO			volatile
+
+#define HAL_OK			0
+#define HAL_ERROR		1
+
+#define SRAM2B_BASE		0x20038000UL	// mapped by fdstub_init()
+
+#define SD_DRIVE		1				// RAM image, see fsstub.c
+
+#endif /* FDSTUB_MAIN_H_ */
@@ -0,0 +1,39 @@
+/**
+ *  @brief
+ *      Host stub for peripherals/myassert.h, the assert is counted.
+ *  @file
+ *      myassert.h
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-19
+ *  @remark
+ *      Language: C, host GCC (tools/fdsim.py)
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ */
+
+#ifndef FDSTUB_MYASSERT_H_
+#define FDSTUB_MYASSERT_H_
+
+#include <stdint.h>
+
+#define ASSERT_MUTEX_CREATION	9
+
+void fdstub_assert(int id, uint32_t param);
+
+static inline uint32_t __get_PC(void) {
+	return 0;
+}
+
+#define ASSERT_fatal(cond, id, param)	\
+  if (!(cond)) {						\
+	fdstub_assert(id, param);			\
+  }
+
+#endif /* FDSTUB_MYASSERT_H_ */
@@ -0,0 +1,29 @@
+/**
+ *  @brief
+ *      Host stub for Core/Inc/rtc.h.
+ *  @file
+ *      rtc.h
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-19
+ *  @remark
+ *      Language: C, host GCC (tools/fdsim.py)
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ */
+
+#ifndef FDSTUB_RTC_H_
+#define FDSTUB_RTC_H_
+
+#include "main.h"
+#include "stm32wbxx_hal.h"
+
+extern RTC_HandleTypeDef hrtc;
+
+#endif /* FDSTUB_RTC_H_ */
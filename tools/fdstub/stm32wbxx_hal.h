@@ -0,0 +1,53 @@
+/**
+ *  @brief
+ *      Host stub for stm32wbxx_hal.h, the RTC for the FAT time stamps.
+ *  @file
+ *      stm32wbxx_hal.h
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-19
+ *  @remark
+ *      Language: C, host GCC (tools/fdsim.py)
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ */
+
+#ifndef FDSTUB_STM32WBXX_HAL_H_
+#define FDSTUB_STM32WBXX_HAL_H_
+
+#include <stdint.h>
+
+#define RTC_FORMAT_BIN		0x00000000U
+
+typedef struct {
+	uint32_t Instance;
+} RTC_HandleTypeDef;
+
+typedef struct {
+	uint8_t Hours;
+	uint8_t Minutes;
+	uint8_t Seconds;
+	uint8_t TimeFormat;
+	uint32_t SubSeconds;
+	uint32_t SecondFraction;
+	uint32_t DayLightSaving;
+	uint32_t StoreOperation;
+} RTC_TimeTypeDef;
+
+typedef struct {
+	uint8_t WeekDay;
+	uint8_t Month;
+	uint8_t Date;
+	uint8_t Year;
+} RTC_DateTypeDef;
+
+int HAL_RTC_GetTime(RTC_HandleTypeDef *hrtc, RTC_TimeTypeDef *sTime, uint32_t Format);
+int HAL_RTC_GetDate(RTC_HandleTypeDef *hrtc, RTC_DateTypeDef *sDate, uint32_t Format);
+
+#endif /* FDSTUB_STM32WBXX_HAL_H_ */
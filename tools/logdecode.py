@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+"""
+Decodes a Mecrisp-Cube binary log file (see peripherals/log.c).
+
+The records hold the flash address of the printf format string, the
+strings are read from the firmware image (e.g. Release/MecrispCube.bin).
+
+usage: logdecode.py [-i image.bin] logfile [logfile.1 ...]
+
+Peter Schmid, peter@spyr.ch
+This file is part of Mecrisp-Cube, GNU General Public License v3.
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+LOG_MAGIC = 0x474C434D
+HEADER = struct.Struct("<4I")       # magic, version, record_size, image_base
+RECORD = struct.Struct("<6I")         # seq, timestamp, fmt, arg[3]
+
+# printf conversion, length modifiers are ignored (all arguments are 32-bit)
+CONV = re.compile(r"%([-+ #0]*\d*(?:\.\d+)?)(?:hh|h|ll|l|z|t|j)?([diouxXcsp%])")
+
+
+def c_string(image, base, addr):
+    offset = addr - base
+    if offset < 0 or offset >= len(image):
+        return None
+    end = image.find(b"\0", offset)
+    if end < 0:
+        end = len(image)
+    return image[offset:end].decode("latin-1")
+
+
+def format_record(fmt, args, image, base):
+    args = list(args)
+
+    def conv(m):
+        flags, c = m.group(1), m.group(2)
+        if c == "%":
+            return "%"
+        a = args.pop(0) if args else 0
+        if c in "di":
+            a = a - (1 << 32) if a & 0x80000000 else a
+            return ("%" + flags + "d") % a
+        if c == "c":
+            return chr(a & 0xFF)
+        if c == "s":
+            s = c_string(image, base, a) if image else None
+            return s if s is not None else "<0x%08x>" % a
+        if c == "p":
+            return "0x%08x" % a
+        return ("%" + flags + c) % a
+
+    return CONV.sub(conv, fmt)
+
+
+def decode(path, image, out):
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) < HEADER.size:
+        return
+    magic, version, size, base = HEADER.unpack_from(data, 0)
+    if magic != LOG_MAGIC:
+        sys.exit("%s: not a Mecrisp-Cube log file" % path)
+    if size < RECORD.size:
+        sys.exit("%s: unknown record size %d" % (path, size))
+    for pos in range(HEADER.size, len(data) - size + 1, size):
+        seq, timestamp, fmt_addr, a0, a1, a2 = RECORD.unpack_from(data, pos)
+        fmt = c_string(image, base, fmt_addr) if image else None
+        if fmt is None:
+            text = "<fmt 0x%08x> %08x %08x %08x" % (fmt_addr, a0, a1, a2)
+        else:
+            text = format_record(fmt, (a0, a1, a2), image, base)
+        out.write("%10u %s\n" % (timestamp, text.rstrip("\n")))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode Mecrisp-Cube binary log files")
+    parser.add_argument("-i", "--image", help="firmware image (.bin) with the format strings")
+    parser.add_argument("logfile", nargs="+", help="log files, oldest first")
+    args = parser.parse_args()
+
+    image = None
+    if args.image:
+        with open(args.image, "rb") as f:
+            image = f.read()
+    for path in args.logfile:
+        decode(path, image, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
@@ -6,7 +6,9 @@
  *        * The program is resident. The text buffer and other buffers too.
  *          You can leave the program without saving, do some work on the
  *          command line and go back to vi and continue the edit task.
- *        * The text buffer is restricted to 40 !KiB. Large files have to be split up.
+ *        * The text buffer is restricted to 40 !KiB. Files larger than 20 KiB
+ *          are paged, only a window of the file is in the text buffer.
+ *          Use <b>:page</b> and <b>:page -</b> to move the window.
  *        * 8-bit characters are allowed e.g. UTF8
  *        * Mecrisp Forth uses DOS/Windows style line endings carriage return
  *          and line feed ("\r\n"). Unix (and vi) uses just line feed ("\n").
@@ -86,6 +88,8 @@ static const char vi_Version[] =
 #define BB_FEATURE_VI_READONLY		//  128
 #define BB_FEATURE_VI_SETOPTS		//  576
 #define BB_FEATURE_VI_SET			//  224
+#define BB_FEATURE_VI_OPTIMIZE_CURSOR	//  cursor motion with discrete chars
+#define BB_FEATURE_VI_SCROLL_REGION	//  scroll with VT100 scroll region
 //#define BB_FEATURE_VI_WIN_RESIZE	//  256  WIN_RESIZE
 
 #include <string.h>
@@ -117,7 +121,12 @@ static const char vi_Version[] =
 #define MAX_ARGS			10
 
 #define TEXT_SIZE		(40 * 1024)
+#define TEXT_PAGE		(TEXT_SIZE / 2)	// larger files are paged
 #define MAX_INPUT_LEN	256
+#define OUTBUF_SIZE		512				// terminal output buffer
+
+#define LINE_INDEX_STEP	64				// lines between two line index entries
+#define LINE_INDEX_SIZE	256				// indexes the first 16384 lines
 
 // Misc. non-Ascii keys that report an escape sequence
 #define VI_K_UP			128	// cursor key Up
@@ -183,6 +192,11 @@ static const char bell[]= "\007";		// Terminal bell sequence
 static const char Ceol[] = "\033[0K";	// Clear from cursor to end of line
 static const char Ceos[] = "\033[0J";	// Clear from cursor to end of screen
 static const char CMrc[] = "\033[%d;%dH";	// Terminal Crusor motion ESC sequence
+#ifdef BB_FEATURE_VI_SCROLL_REGION
+static const char CSsr[] = "\033[1;%dr";	// set scroll region to line 1 .. n
+static const char CSrs[] = "\033[r";		// reset scroll region
+static const char CSri[] = "\033M";		// reverse index, scroll down at top
+#endif
 #ifdef BB_FEATURE_VI_OPTIMIZE_CURSOR
 static const char CMup[] = "\033[A";	// move cursor up one line, same col
 static const char CMdown[] = "\n";		// move cursor down one line, same col
@@ -204,10 +218,20 @@ static char *cfn;						// previous, current, and next file name
 static char *text, *end, *textend;		// pointers to the user data in memory
 static char *screen;					// pointer to the virtual screen buffer
 static int screensize;					//            and its size
+static char *new_scr;					// screen lines formatted by refresh()
+static char *outbuf;					// terminal output buffer
+static int outbuf_len;					//            and its fill level
 static char *screenbegin;				// index into text[], of top line on the screen
 static char *dot;						// where all the action takes place
 static int tabstop;
 
+static char *line_index[LINE_INDEX_SIZE];	// B-o-l of line (k+1)*LINE_INDEX_STEP+1
+static int line_index_cnt;				// valid entries in line_index[]
+
+static FSIZE_t page_start;				// file offset of the text[] window
+static FSIZE_t page_len;				// file bytes in the text[] window
+static FSIZE_t page_total;				// file size, 0 if the file is not paged
+
 #ifdef BB_FEATURE_VI_OPTIMIZE_CURSOR
 static int last_row;					// where the cursor was last moved to
 #endif							/* BB_FEATURE_VI_OPTIMIZE_CURSOR */
@@ -280,8 +304,15 @@ static void print_literal(char *, char *);	// copy s to buf, convert unprintable
 static char readit(void);				// read (maybe cursor) key from stdin
 static char get_one_char(void);			// read 1 char from stdin
 static int file_size(char *);			// what is the char size of "fn"
+static int file_load(char *);			// load "fn" into empty text[]
 static int file_insert(char *, char *, int);
 static int file_write(char *, char *, char *);
+static int strip_cr(char *, int);		// remove carriage returns
+static int page_load(char *, FSIZE_t, FSIZE_t);	// load a window of "fn"
+static FSIZE_t page_prev(char *);		// file offset of the previous window
+static int page_write(char *, char *);	// splice text[] into the paged file
+static void line_index_extend(char *, int);	// build line_index[]
+static void line_index_invalidate(char *);	// text[] changed at "p"
 static void place_cursor(int, int, int);
 static void screen_erase();
 static void clear_to_eol(void);
@@ -299,8 +330,13 @@ static void edit_status(void);			// show file status on status line
 static void redraw(int);				// force a full screen refresh
 static void format_line(char*, char*, int);
 static void refresh(int);				// update the terminal from screen[]
+#ifdef BB_FEATURE_VI_SCROLL_REGION
+static void scroll_screen(int);			// scroll terminal and screen[]
+static int scroll_lines(void);			// how many lines has the screen scrolled
+#endif							/* BB_FEATURE_VI_SCROLL_REGION */
 
 static ssize_t write_term(const void *buf, size_t nbyte);
+static void flush_term(void);
 static char* last_char_is(const char *s, int c);
 static int puts_term(const char *s);
 static char *pvPortStrdup(const char *s);
@@ -345,6 +381,9 @@ static char *swap_context(char *);		// goto new context for '' command
 void VI_init(void) {
 	text = pvPortMalloc(TEXT_SIZE+100); // some safety margin
 	screen = pvPortMalloc(MAX_SCR_COLS * MAX_SCR_ROWS + 8);
+	new_scr = pvPortMalloc(MAX_SCR_COLS * MAX_SCR_ROWS + 8);
+	outbuf = pvPortMalloc(OUTBUF_SIZE);
+	outbuf_len = 0;
 
 	status_buffer = pvPortMalloc(MAX_INPUT_LEN);	// hold messages to user
 	memset(status_buffer, 0, MAX_INPUT_LEN);
@@ -410,6 +449,7 @@ uint64_t VI_edit(uint64_t forth_stack) {
 		} else if (! strcmp(line, "-e")) {
 			// erase buffer
 			new_text(TEXT_SIZE);
+			page_start = page_len = page_total = 0;
 			screenbegin = dot = end = text;
 			(void) char_insert(text, '\n');	// start empty buf with dummy line
 			file_modified = FALSE;
@@ -499,7 +539,7 @@ uint64_t VI_edit(uint64_t forth_stack) {
 static void edit_file(char * fn)
 {
 	char c;
-	int cnt, size, ch;
+	int cnt, ch;
 
 #ifdef BB_FEATURE_VI_YANKMARK
 	static char *cur_line;
@@ -512,11 +552,7 @@ static void edit_file(char * fn)
 	new_screen(rows, columns);	// get memory for virtual screen
 
 	if (fn != 0) {
-		cnt = file_size(fn);	// file size
-		size = 2 * cnt;		// 200% of file size
-		new_text(size);		// get a text[] buffer
-		screenbegin = dot = end = text;
-		ch= file_insert(fn, text, cnt);
+		ch= file_load(fn);
 		if (ch < 1) {
 			(void) char_insert(text, '\n');	// start empty buf with dummy line
 		}
@@ -589,6 +625,7 @@ static void edit_file(char * fn)
 
 	place_cursor(rows, 0, FALSE);	// go to bottom of screen
 	clear_to_eol();		// Erase to end of line
+	flush_term();
 }
 
 
@@ -738,6 +775,7 @@ static void do_cmd(char c)
 	case 18:			// ctrl-R  force redraw
 		place_cursor(0, 0, FALSE);	// put cursor in correct place
 		clear_to_eos();	// tel terminal to erase display
+		flush_term();
 		osDelay(10*10);
 		screen_erase();	// erase the internal screen buffer
 		refresh(TRUE);	// this will redraw the entire display
@@ -1149,6 +1187,7 @@ static void do_cmd(char c)
 		}				// repeat cnt
 		dot_end();		// move to NL
 		if (dot < end - 1) {	// make sure not last char in text[]
+			line_index_invalidate(dot);
 			*dot++ = ' ';	// replace NL with space
 			while (isblnk(*dot)) {	// delete leading WS
 				dot_delete();
@@ -1339,6 +1378,7 @@ static void do_cmd(char c)
 	case 'r':			// r- replace the current char with user input
 		c1 = get_one_char();	// get the replacement char
 		if (*dot != '\n') {
+			line_index_invalidate(dot);
 			*dot = c1;
 			file_modified = TRUE;	// has the file been modified
 		}
@@ -1359,13 +1399,13 @@ static void do_cmd(char c)
 		dot = q;
 		place_cursor(rows, 0, FALSE);	// go below Status line, bottom of screen
 		clear_to_eol();	// clear the line
-		stack = FS_type(stack, (uint8_t*)line, strlen(line));
-		stack = TERMINAL_emit(stack, ' ');
+		puts_term(line);
+		write_term(" ", 1);
+		flush_term();
 		stack = FS_catch_evaluate(stack, (uint8_t*)line, strlen(line));
 		if (EvaluateState == 0) {
 			// successful
-			strcpy(line, "ok.");
-			stack = FS_type(stack, (uint8_t*)line, strlen(line));
+			puts_term("ok.");
 		}
 		dot = next_line(dot);
 		break;
@@ -1377,6 +1417,7 @@ static void do_cmd(char c)
 		dot = q;
 
 		// redirect terminal out to terminal in
+		flush_term();
 		TERMINAL_redirect();
 		// put Append command 'A'
 		stack = TERMINAL_emit(stack, 'A');
@@ -1589,6 +1630,8 @@ static void colon(char * buf)
 	// :/123/,/abc/d    // delete lines from "123" line to "abc" line
 	// :/xyz/	// goto the "xyz" line
 	// :s/find/replace/ // substitute pattern "find" with "replace"
+	// :page		// next window of a paged file
+	// :page -	// previous window of a paged file
 	// :!<cmd>	// run <cmd> then return
 	//
 	if (strlen(buf) <= 0)
@@ -1655,8 +1698,9 @@ static void colon(char * buf)
 		// :!ls   run the <cmd>
 		place_cursor(rows - 1, 0, FALSE);	// go to Status line
 		clear_to_eol();			// clear the line
+		write_term(" ", 1);
+		flush_term();
 //		system(orig_buf+1);		// run the cmd
-		stack = TERMINAL_emit(stack, ' ');
 		stack = FS_catch_evaluate(stack, (uint8_t*)orig_buf+1, strlen(orig_buf+1));
 
 		Hit_Return();			// let user see results
@@ -1723,12 +1767,8 @@ static void colon(char * buf)
 		cfn = q;			// remember new cfn
 
 	  vc5:
-		// delete all the contents of text[]
-		new_text(2 * file_size(fn));
-		screenbegin = dot = end = text;
-
-		// insert new file
-		ch = file_insert(fn, text, file_size(fn));
+		// delete all the contents of text[] and insert new file
+		ch = file_load(fn);
 
 		if (ch < 1) {
 			// start empty buf with dummy line
@@ -1807,6 +1847,43 @@ static void colon(char * buf)
 	  vc2:
 #endif							/* BB_FEATURE_VI_SET */
 		Hit_Return();
+	} else if (strncasecmp(cmd, "page", i) == 0) {	// move the window of a paged file
+		FSIZE_t pos;
+
+		if (page_total == 0) {
+			psbs("\"%s\" is not paged", (cfn != 0 ? cfn : "No file"));
+			goto vc1;
+		}
+		if (file_modified == TRUE && useforce != TRUE) {
+			psbs("No write since last change (:page! overrides)");
+			goto vc1;
+		}
+		if (*args == '-') {
+			if (page_start == 0) {
+				psbs("Already at the first page");
+				goto vc1;
+			}
+			pos = page_prev(cfn);
+			ch = page_load(cfn, pos, page_start);
+		} else {
+			pos = page_start + page_len;
+			if (pos >= page_total) {
+				psbs("Already at the last page");
+				goto vc1;
+			}
+			ch = page_load(cfn, pos, page_total);
+		}
+		if (ch < 1) {
+			// start empty buf with dummy line
+			(void) char_insert(text, '\n');
+		}
+		file_modified = FALSE;
+#ifdef BB_FEATURE_VI_YANKMARK
+		for (li = 0; li < 28; li++) {
+			mark[li] = 0;
+		}				// init the marks
+#endif							/* BB_FEATURE_VI_YANKMARK */
+		edit_status();
 	} else if ((strncasecmp(cmd, "quit", i) == 0) ||	// Quit
 			   (strncasecmp(cmd, "next", i) == 0)) {	// edit next file
 		if (useforce == TRUE) {
@@ -2220,6 +2297,24 @@ static int count_lines(char * start, char * stop) // count line from start to st
 	}
 	cnt = 0;
 	stop = end_line(stop);	// get to end of this line
+	if (start == text) {
+		// start at the nearest indexed line before stop
+		int lo, hi, mid;
+
+		line_index_extend(stop, LINE_INDEX_SIZE * LINE_INDEX_STEP);
+		lo = 0;
+		hi = line_index_cnt - 1;
+		while (lo <= hi) {
+			mid = (lo + hi) / 2;
+			if (line_index[mid] <= stop) {
+				start = line_index[mid];
+				cnt = (mid + 1) * LINE_INDEX_STEP;
+				lo = mid + 1;
+			} else {
+				hi = mid - 1;
+			}
+		}
+	}
 	for (q = start; q <= stop && q <= end - 1; q++) {
 		if (*q == '\n')
 			cnt++;
@@ -2230,13 +2325,59 @@ static int count_lines(char * start, char * stop) // count line from start to st
 static char *find_line(int li)	// find begining of line #li
 {
 	char *q;
-
-	for (q = text; li > 1; li--) {
+	int k;
+
+	q = text;
+	k = (li - 1) / LINE_INDEX_STEP;	// index entries before line #li
+	if (k > 0) {
+		line_index_extend(end, k * LINE_INDEX_STEP);
+		if (k > line_index_cnt)
+			k = line_index_cnt;
+		if (k > 0) {
+			q = line_index[k - 1];
+			li -= k * LINE_INDEX_STEP;
+		}
+	}
+	for (; li > 1; li--) {
 		q = next_line(q);
 	}
 	return (q);
 }
 
+//----- Line Index ---------------------------------------------
+// line_index[k] points to the beginning of line (k+1)*LINE_INDEX_STEP+1.
+// The index is built on demand and truncated when text[] changes, so
+// count_lines() and find_line() do not rescan text[] from the start.
+static void line_index_extend(char * stop, int lines) // index text[] up to "stop" or "lines"
+{
+	char *q;
+	int li;
+
+	if (line_index_cnt == 0) {
+		q = text;
+		li = 0;
+	} else {
+		q = line_index[line_index_cnt - 1];
+		li = line_index_cnt * LINE_INDEX_STEP;
+	}
+	while (q < stop && q < end - 1
+		   && line_index_cnt < LINE_INDEX_SIZE
+		   && line_index_cnt * LINE_INDEX_STEP < lines) {
+		if (*q++ == '\n') {
+			li++;
+			if ((li % LINE_INDEX_STEP) == 0) {
+				line_index[line_index_cnt++] = q;
+			}
+		}
+	}
+}
+
+static void line_index_invalidate(char * p) // text[] after "p" has changed
+{
+	while (line_index_cnt > 0 && line_index[line_index_cnt - 1] > p)
+		line_index_cnt--;
+}
+
 //----- Dot Movement Routines ----------------------------------
 static void dot_left(void)
 {
@@ -2381,6 +2522,7 @@ static char *new_text(int size)
 	else if (size > TEXT_SIZE)
 		size = TEXT_SIZE;
 	memset(text, '\0', TEXT_SIZE);	// clear new text[]
+	line_index_cnt = 0;
 	textend = text + size - 1;
 	end = text + size - 1;
 	return (text);
@@ -2727,6 +2869,7 @@ static void showmatching(char * p)
 		save_dot = dot;	// remember where we are
 		dot = q;		// go to new loc
 		refresh(FALSE);	// let the user see it
+		flush_term();
 		osDelay(40*10);	// give user some time
 		dot = save_dot;	// go back to old loc
 		refresh(FALSE);
@@ -2742,6 +2885,7 @@ static char *text_hole_make(char * p, int size)	// at "p", make a 'size' byte ho
 
 	if (size <= 0)
 		goto thm0;
+	line_index_invalidate(p);
 	src = p;
 	dest = p + size;
 	cnt = end - src;	// the rest of buffer
@@ -2775,6 +2919,7 @@ static char *text_hole_delete(char * p, char * q) // delete "p" thru "q", inclus
 		goto thd0;
 	if (dest < text || dest >= end)
 		goto thd0;
+	line_index_invalidate(dest);
 	if (src >= end)
 		goto thd_atend;	// just delete the end of the buffer
 	if (memmove(dest, src, cnt) != dest) {
@@ -2866,6 +3011,7 @@ static void show_help(void)
 #endif							/* BB_FEATURE_VI_WIN_RESIZE */
 	"\n"
 	);
+	flush_term();
 }
 
 static void print_literal(char * buf, char * s) // copy s to buf, convert unprintable
@@ -3083,7 +3229,8 @@ static char readit(void)	// read (maybe cursor) key from stdin
 	// get input from User- are there already input chars in Q?
 	bufsiz = strlen(readbuffer);
 	if (bufsiz <= 0) {
-		// the Q is empty, wait for a typed char
+		// the Q is empty, send the pending output and wait for a typed char
+		flush_term();
 		stack = TERMINAL_key(stack, &c);
 		readbuffer[0] = c;
 		bufsiz = 1;
@@ -3248,13 +3395,29 @@ static int file_size(char * fn) // what is the byte size of "fn"
 }
 
 
+//----- Load a file into an empty text[] -----------------------
+// Files larger than TEXT_PAGE are paged, the first window is loaded.
+static int file_load(char * fn)
+{
+	int size;
+
+	size = file_size(fn);
+	page_start = page_len = page_total = 0;
+	new_text(2 * size);		// get a text[] buffer
+	screenbegin = dot = end = text;
+	if (size > TEXT_PAGE) {
+		page_total = size;
+		return (page_load(fn, 0, page_total));
+	}
+	return (file_insert(fn, text, size));
+}
+
 static int file_insert(char * fn, char * p, int size)
 {
 	FRESULT fr;     /* FatFs return code */
 	FIL fil;        /* File object */
 	UINT cnt= 0;
-	UINT line_cnt= 0;
-	TCHAR* buffer;
+	int len;
 
 #ifdef BB_FEATURE_VI_READONLY
 	readonly = FALSE;
@@ -3276,7 +3439,7 @@ static int file_insert(char * fn, char * p, int size)
 		psbs("Trying to insert file outside of memory");
 		goto fi0;
 	}
-	if (p+size >= text+TEXT_SIZE-100) {
+	if (end+size >= text+TEXT_SIZE-100) {
 		psbs("Trying to insert a to large file");
 		goto fi0;
 	}
@@ -3303,34 +3466,27 @@ static int file_insert(char * fn, char * p, int size)
 #endif							/* BB_FEATURE_VI_READONLY */
 	}
 	p = text_hole_make(p, size);
-	cnt = 0;
-
-	//	fr = f_read(&fil, p, size, &cnt);
-	buffer = p;
-	while (buffer != NULL) {
-		buffer = f_gets(line, MAX_INPUT_LEN, &fil); // removes carriage returns
-		if (buffer != NULL) {
-			memcpy(p+cnt, line, strlen(line));
-			cnt += strlen(line);
-			line_cnt++;
-		}
-	}
 
-	if (f_error(&fil)) {
+	// read the whole file in one go, f_read transfers complete
+	// sectors directly into text[]
+	fr = f_read(&fil, p, size, &cnt);
+	if (fr != FR_OK) {
 		cnt = 0;
 		p = text_hole_delete(p, p + size - 1);	// un-do buffer insert
 		psbs("could not read file \"%s\"", fn);
-	} else if (cnt < size) {
-		// There was a partial read, shrink unused space text[]
-		// or a DOS file with removed carriage returns \r
-		DOS_file = FALSE;
-		if (size - cnt == line_cnt) {
-			DOS_file = TRUE;
-			psbs("DOS file", fn);
-		} else {
-			p = text_hole_delete(p + cnt, p + (size - cnt) - 1);	// un-do buffer insert
+	} else {
+		len = strip_cr(p, cnt);
+		if (len < size) {
+			// There was a partial read, shrink unused space text[]
+			// or a DOS file with removed carriage returns \r
+			p = text_hole_delete(p + len, p + size - 1);	// un-do buffer insert
+		}
+		if (cnt < size) {
 			psbs("could not read all of file \"%s\"", fn);
+		} else if (DOS_file) {
+			psbs("DOS file", fn);
 		}
+		cnt = len;
 	}
 	if (cnt >= size)
 		file_modified = TRUE;
@@ -3342,6 +3498,222 @@ fi0:
 	return (cnt);
 }
 
+//----- Remove the carriage returns from a DOS file ------------
+static int strip_cr(char * p, int size)
+{
+	char *src, *dest;
+
+	dest = memchr(p, '\r', size);
+	if (dest == NULL) {
+		DOS_file = FALSE;
+		return (size);
+	}
+	DOS_file = TRUE;
+	for (src = dest; src < p + size; src++) {
+		if (*src != '\r')
+			*dest++ = *src;
+	}
+	return (dest - p);
+}
+
+//----- Paged Files --------------------------------------------
+// A file larger than TEXT_PAGE is edited through a window. The window
+// covers the complete lines of the file from page_start to
+// page_start + page_len. Writing the file splices text[] into the file.
+
+// load the complete lines of "fn" from pos (at most up to limit)
+static int page_load(char * fn, FSIZE_t pos, FSIZE_t limit)
+{
+	FRESULT fr;     /* FatFs return code */
+	FIL fil;        /* File object */
+	UINT cnt = 0;
+	UINT size;
+
+	new_text(TEXT_SIZE);
+	screenbegin = dot = end = text;
+	page_start = pos;
+	page_len = 0;
+
+#ifdef BB_FEATURE_VI_READONLY
+	readonly = FALSE;
+	if (vi_readonly == TRUE) goto pl1; 	// do not try write-mode
+#endif
+	fr = f_open(&fil, fn, FA_READ | FA_WRITE); // assume read & write
+	if (fr != FR_OK) {
+		// could not open for writing- maybe file is read only
+#ifdef BB_FEATURE_VI_READONLY
+  pl1:
+#endif
+		fr = f_open(&fil, fn, FA_READ); // try read-only
+		if (fr != FR_OK) {
+			psbs("\"%s\" %s", fn, "could not open file");
+			return (0);
+		}
+#ifdef BB_FEATURE_VI_READONLY
+		readonly = TRUE;
+#endif							/* BB_FEATURE_VI_READONLY */
+	}
+	size = limit - pos;
+	if (size > TEXT_PAGE)
+		size = TEXT_PAGE;
+	fr = f_lseek(&fil, pos);
+	if (fr == FR_OK)
+		fr = f_read(&fil, text, size, &cnt);
+	f_close(&fil);
+	if (fr != FR_OK) {
+		psbs("could not read file \"%s\"", fn);
+		return (0);
+	}
+	if (pos + cnt < limit) {
+		// the window ends with the last complete line
+		while (cnt > 0 && text[cnt - 1] != '\n')
+			cnt--;
+		if (cnt == 0) {
+			psbs("line too long in \"%s\"", fn);
+			return (0);
+		}
+	}
+	page_len = cnt;
+	end = text + strip_cr(text, cnt);
+	return (end - text);
+}
+
+// find the file offset of the window before the current window
+static FSIZE_t page_prev(char * fn)
+{
+	FIL fil;        /* File object */
+	FSIZE_t pos;
+	UINT cnt, i;
+
+	if (page_start <= TEXT_PAGE)
+		return (0);
+	pos = page_start - TEXT_PAGE;
+	if (f_open(&fil, fn, FA_READ) != FR_OK)
+		return (0);
+	// skip the partial line at pos
+	f_lseek(&fil, pos);
+	while (pos < page_start) {
+		if (f_read(&fil, readbuffer, MAX_INPUT_LEN, &cnt) != FR_OK || cnt == 0)
+			break;
+		for (i = 0; i < cnt; i++) {
+			if (readbuffer[i] == '\n')
+				break;
+		}
+		pos += i;
+		if (i < cnt) {
+			pos++;	// first char after NL
+			break;
+		}
+	}
+	f_close(&fil);
+	if (pos >= page_start)
+		pos = 0;	// line longer than a page
+	return (pos);
+}
+
+// write the paged file src_fn with text[] instead of the current window
+// to fn. The new file is written to fn~ first, the old fn is kept as
+// fn.bak till fn~ is renamed, a power loss does not lose the file.
+static int page_write(char * src_fn, char * fn)
+{
+	FRESULT fr;     /* FatFs return code */
+	FIL src, dest;  /* File objects */
+	char *buf;
+	char bak[MAX_INPUT_LEN];
+	UINT bufsize, cnt, charcnt;
+	FSIZE_t pos, win_end;
+
+	// use the unused part of text[] as copy buffer
+	buf = end + 1;
+	bufsize = (text + TEXT_SIZE) - buf;
+	if (bufsize < MAX_INPUT_LEN) {
+		buf = readbuffer;
+		bufsize = MAX_INPUT_LEN;
+	}
+	if (strlen(fn) + 5 > MAX_INPUT_LEN) {
+		return (0);
+	}
+	strcpy(line, fn);
+	strcat(line, "~");
+	strcpy(bak, fn);
+	strcat(bak, ".bak");
+
+	if (f_open(&src, src_fn, FA_READ) != FR_OK) {
+		return (0);
+	}
+	if (f_open(&dest, line, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK) {
+		f_close(&src);
+		return (0);
+	}
+	// lines before the window
+	fr = FR_OK;
+	for (pos = 0; pos < page_start && fr == FR_OK; pos += cnt) {
+		cnt = page_start - pos;
+		if (cnt > bufsize)
+			cnt = bufsize;
+		fr = f_read(&src, buf, cnt, &cnt);
+		if (fr == FR_OK && cnt == 0)
+			fr = FR_INT_ERR;
+		if (fr == FR_OK)
+			fr = f_write(&dest, buf, cnt, &cnt);
+	}
+	// the window, keep the line endings of a DOS file
+	charcnt = 0;
+	if (fr == FR_OK && DOS_file) {
+		char *q, *r;
+
+		for (q = text; q < end && fr == FR_OK; q = r + 1) {
+			r = memchr(q, '\n', end - q);
+			if (r == NULL)
+				r = end;
+			fr = f_write(&dest, q, r - q, &cnt);
+			charcnt += cnt;
+			if (fr == FR_OK && r < end) {
+				fr = f_write(&dest, "\r\n", 2, &cnt);
+				charcnt++;
+			}
+		}
+	} else if (fr == FR_OK) {
+		fr = f_write(&dest, text, end - text, &charcnt);
+	}
+	win_end = f_tell(&dest);
+	// lines after the window
+	if (fr == FR_OK)
+		fr = f_lseek(&src, page_start + page_len);
+	while (fr == FR_OK) {
+		fr = f_read(&src, buf, bufsize, &cnt);
+		if (fr != FR_OK || cnt == 0)
+			break;
+		fr = f_write(&dest, buf, cnt, &cnt);
+	}
+	pos = f_size(&dest);
+	f_close(&src);
+	f_close(&dest);
+
+	if (fr != FR_OK || charcnt != end - text) {
+		f_unlink(line);
+		return (0);
+	}
+	// fn -> fn.bak, fn~ -> fn, there is always a complete file
+	f_unlink(bak);
+	fr = f_rename(fn, bak);
+	if (fr != FR_OK && fr != FR_NO_FILE) {
+		f_unlink(line);
+		return (0);
+	}
+	if (f_rename(line, fn) != FR_OK) {
+		if (fr == FR_OK)
+			f_rename(bak, fn);
+		return (0);
+	}
+	f_unlink(bak);
+	if (strcmp(fn, src_fn) == 0) {
+		page_len = win_end - page_start;
+		page_total = pos;
+	}
+	return (charcnt);
+}
+
 static int file_write(char * fn, char * first, char * last)
 {
 	FRESULT fr;     /* FatFs return code */
@@ -3354,6 +3726,16 @@ static int file_write(char * fn, char * first, char * last)
 		return (-1);
 	}
 	charcnt = 0;
+	if (page_total > 0 && cfn != 0) {
+		// the whole paged file, also to another file name
+		if (first == text && last == end - 1) {
+			return (page_write(cfn, fn));
+		}
+		if (strcmp(fn, cfn) == 0) {
+			psbs("Partial write of a paged file");
+			return (0);
+		}
+	}
 	// FIXIT- use the correct umask()
 
 	fr = f_open(&fil, fn, FA_CREATE_ALWAYS | FA_WRITE);
@@ -3446,6 +3828,9 @@ static void place_cursor(int row, int col, int opti)
   pc0:
 	l= strlen(cm);
 	if (l) write_term(cm, l);			// move the cursor
+#ifdef BB_FEATURE_VI_OPTIMIZE_CURSOR
+	last_row = row;
+#endif							/* BB_FEATURE_VI_OPTIMIZE_CURSOR */
 }
 
 //----- Erase from cursor to end of line -----------------------
@@ -3477,6 +3862,7 @@ static void flash(int h)
 {
 	standout_start();	// send "start reverse video" sequence
 	redraw(TRUE);
+	flush_term();
 	osDelay(10*h);
 	standout_end();		// send "end reverse video" sequence
 	redraw(TRUE);
@@ -3582,6 +3968,11 @@ static void edit_status(void)	// show file status on status line
 #endif							/* BB_FEATURE_VI_READONLY */
 		(file_modified == TRUE ? " [modified]" : ""),
 		cur, tot, percent);
+	if (page_total > 0) {
+		sprintf(status_buffer + strlen(status_buffer), " [bytes %lu-%lu of %lu]",
+			(unsigned long) page_start, (unsigned long) (page_start + page_len),
+			(unsigned long) page_total);
+	}
 }
 
 //----- Force refresh of all Lines -----------------------------
@@ -3633,17 +4024,87 @@ static void format_line(char *dest, char *src, int li)
 	}
 }
 
+//----- Scroll the terminal and screen[] -----------------------
+// The text lines 0 .. rows-2 are a VT100 scroll region, the status line
+// is not touched. cnt > 0 scrolls up (text moves up), cnt < 0 down.
+#ifdef BB_FEATURE_VI_SCROLL_REGION
+static void scroll_screen(int cnt)
+{
+	char cm[16];
+	int n, lines;
+
+	lines = rows - 1;
+	sprintf(cm, CSsr, lines);
+	write_term(cm, strlen(cm));
+	if (cnt > 0) {
+		// new lines at the bottom
+		place_cursor(lines - 1, 0, FALSE);
+		for (n = 0; n < cnt; n++)
+			write_term("\n", 1);
+		memmove(screen, screen + cnt * columns, (lines - cnt) * columns);
+		memset(screen + (lines - cnt) * columns, ' ', cnt * columns);
+	} else {
+		// new lines at the top
+		cnt = -cnt;
+		place_cursor(0, 0, FALSE);
+		for (n = 0; n < cnt; n++)
+			write_term(CSri, strlen(CSri));
+		memmove(screen + cnt * columns, screen, (lines - cnt) * columns);
+		memset(screen, ' ', cnt * columns);
+	}
+	write_term(CSrs, strlen(CSrs));	// cursor is at home after reset
+#ifdef BB_FEATURE_VI_OPTIMIZE_CURSOR
+	last_row = 0;
+#endif							/* BB_FEATURE_VI_OPTIMIZE_CURSOR */
+}
+
+//----- How many lines has the screen scrolled -----------------
+// Compare the new lines with the virtual screen shifted by cnt lines,
+// a shift pays off if most of the shifted lines are unchanged.
+static int scroll_lines(void)
+{
+	int cnt, li, same, best, best_same, lines;
+
+	lines = rows - 1;
+	best = 0;
+	best_same = lines / 2;	// at least half of the screen
+	for (cnt = 1; cnt < lines - best_same; cnt++) {
+		// text moved up by cnt lines
+		same = 0;
+		for (li = 0; li < lines - cnt; li++) {
+			if (memcmp(&new_scr[li * columns], &screen[(li + cnt) * columns], columns) == 0)
+				same++;
+		}
+		if (same > best_same) {
+			best_same = same;
+			best = cnt;
+		}
+		// text moved down by cnt lines
+		same = 0;
+		for (li = cnt; li < lines; li++) {
+			if (memcmp(&new_scr[li * columns], &screen[(li - cnt) * columns], columns) == 0)
+				same++;
+		}
+		if (same > best_same) {
+			best_same = same;
+			best = -cnt;
+		}
+	}
+	return (best);
+}
+#endif							/* BB_FEATURE_VI_SCROLL_REGION */
+
 //----- Refresh the changed screen lines -----------------------
-// Copy the source line from text[] into the buffer and note
-// if the current screenline is different from the new buffer.
-// If they differ then that line needs redrawing on the terminal.
+// Format the text[] lines into new_scr[] and compare them with the
+// virtual screen[]. Scroll the terminal if the screen has moved and
+// redraw only the changed part of the lines that differ.
 //
 static void refresh(int full_screen)
 {
 	static int old_offset;
 	int li, changed;
 	char buf[MAX_SCR_COLS];
-	char *tp, *sp;		// pointer into text[] and screen[]
+	char *tp, *sp, *np;		// pointer into text[], screen[] and new_scr[]
 #ifdef BB_FEATURE_VI_OPTIMIZE_CURSOR
 	int last_li= -2;				// last line that changed- for optimizing cursor movement
 #endif							/* BB_FEATURE_VI_OPTIMIZE_CURSOR */
@@ -3654,9 +4115,10 @@ static void refresh(int full_screen)
 	sync_cursor(dot, &crow, &ccol);	// where cursor will be (on "dot")
 	tp = screenbegin;	// index into text[] of top line
 
-	// compare text[] to screen[] and mark screen[] lines that need updating
+	// format all text[] lines on the screen into new_scr[]
 	for (li = 0; li < rows - 1; li++) {
-		int cs, ce;				// column start & end
+		int co;
+
 		memset(buf, ' ', MAX_SCR_COLS);		// blank-out the buffer
 		buf[MAX_SCR_COLS-1] = 0;		// NULL terminate the buffer
 		// format current text line into buf
@@ -3665,27 +4127,47 @@ static void refresh(int full_screen)
 		// skip to the end of the current text[] line
 		while (tp < end && *tp++ != '\n') /*no-op*/ ;
 
-		// see if there are any changes between vitual screen and buf
+		np = &new_scr[li * columns];
+		for (co = 0; co < columns; co++) {
+			np[co] = (co + offset < MAX_SCR_COLS - 1) ? buf[co + offset] : ' ';
+		}
+	}
+
+#ifdef BB_FEATURE_VI_SCROLL_REGION
+	if (full_screen == FALSE && offset == old_offset) {
+		li = scroll_lines();
+		if (li != 0) {
+			scroll_screen(li);
+		}
+	}
+#endif							/* BB_FEATURE_VI_SCROLL_REGION */
+
+	// compare new_scr[] to screen[] and update the changed lines
+	for (li = 0; li < rows - 1; li++) {
+		int cs, ce;				// column start & end
+
+		// see if there are any changes between vitual screen and new line
 		changed = FALSE;	// assume no change
 		cs= 0;
 		ce= columns-1;
 		sp = &screen[li * columns];	// start of screen line
+		np = &new_scr[li * columns];	// start of new line
 		if (full_screen == TRUE) {
 			// force re-draw of every single column from 0 - columns-1
 			goto re0;
 		}
-		// compare newly formatted buffer with virtual screen
-		// look forward for first difference between buf and screen
+		// compare newly formatted line with virtual screen
+		// look forward for first difference between new line and screen
 		for ( ; cs <= ce; cs++) {
-			if (buf[cs + offset] != sp[cs]) {
+			if (np[cs] != sp[cs]) {
 				changed = TRUE;	// mark for redraw
 				break;
 			}
 		}
 
-		// look backward for last difference between buf and screen
+		// look backward for last difference between new line and screen
 		for ( ; ce >= cs; ce--) {
-			if (buf[ce + offset] != sp[ce]) {
+			if (np[ce] != sp[ce]) {
 				changed = TRUE;	// mark for redraw
 				break;
 			}
@@ -3702,10 +4184,10 @@ static void refresh(int full_screen)
 		if (cs < 0) cs= 0;
 		if (ce > columns-1) ce= columns-1;
 		if (cs > ce) {  cs= 0;  ce= columns-1;  }
-		// is there a change between vitual screen and buf
+		// is there a change between vitual screen and new line
 		if (changed == TRUE) {
-			//  copy changed part of buffer to virtual screen
-			memmove(sp+cs, buf+(cs+offset), ce-cs+1);
+			//  copy changed part of new line to virtual screen
+			memmove(sp+cs, np+cs, ce-cs+1);
 
 			// move cursor to column of first change
 			if (offset != old_offset) {
@@ -3747,23 +4229,41 @@ static void refresh(int full_screen)
 // Terminal I/O
 // ************
 
+// The output is collected in outbuf and sent with one FS_type() per
+// flush. type still emits character by character through the terminal
+// hooks (redirection, UART or CDC), the buffer saves the per call overhead
+// and keeps an update together. flush_term() has to be called before
+// waiting for input, for the user or before Forth writes to the terminal.
 static ssize_t write_term(const void *buf, size_t nbyte) {
 	const char *buf_p;
-	int i;
+	size_t n, i;
 
 	buf_p = buf;
-	for (i=0; i<nbyte; i++) {
-		stack = TERMINAL_emit(stack, *(buf_p+i));
+	for (i=0; i<nbyte; i+=n) {
+		if (outbuf_len == OUTBUF_SIZE) {
+			flush_term();
+		}
+		n = nbyte - i;
+		if (n > OUTBUF_SIZE - outbuf_len) {
+			n = OUTBUF_SIZE - outbuf_len;
+		}
+		memcpy(outbuf + outbuf_len, buf_p + i, n);
+		outbuf_len += n;
 	}
 	return nbyte;
 }
 
 
-static int puts_term(const char *s) {
-	int i;
-	for (i=0; i < strlen(s); i++) {
-		stack = TERMINAL_emit(stack, *(s+i));
+static void flush_term(void) {
+	if (outbuf_len > 0) {
+		stack = FS_type(stack, (uint8_t*)outbuf, outbuf_len);
+		outbuf_len = 0;
 	}
+}
+
+
+static int puts_term(const char *s) {
+	write_term(s, strlen(s));
 	return 0;
 }
 